@@ -2,24 +2,37 @@
 
 in float color;
 
+/* Palette or stops of a colormap, see EdgeStyle */
+uniform sampler1D style_tx1D;
+uniform int mode;
+uniform vec2 range;
+uniform vec2 threshold;
+uniform vec4 out_of_range_color;
+
 out vec4 fragColor;
 
 void main()
 {
-	vec3 out_color = vec3(0.0);
+	int colors = textureSize(style_tx1D, 0);
+
+	vec4 out_color;
+	if(color < threshold.x || color > threshold.y)
+	{
+		out_color = out_of_range_color;
+	}
+	else if(mode == 0)
+	{
+		out_color = texelFetch(style_tx1D, clamp(int(color + 0.5), 0, colors - 1), 0);
+	}
+	else
+	{
+		float t = (mode == 1) ? clamp((color - range.x) / (range.y - range.x), 0.0, 1.0) : fract(color * 0.618034);
+		// Texel centres of the first and last stop at 0 and 1
+		out_color = texture(style_tx1D, (t * float(colors - 1) + 0.5) / float(colors));
+	}
+
+	if(out_color.a == 0.0)
+		discard;
 
-	if(color < 0.5)
-		out_color = vec3(0.0,0.0,0.0);
-	else if(color < 1.5)
-		out_color = vec3(0.3,0.55,0.95);
-	else if(color < 2.5)
-		out_color = vec3(0.95,0.4,0.4);
-	else if(color < 3.5)
-		out_color = vec3(0.95,0.75,0.45);
-	else if(color < 4.5)
-		out_color = vec3(0.95,0.9,0.55);
-	else if(color < 5.5)
-		out_color = vec3(1.0,1.0,1.0);
-		
-	fragColor = vec4(out_color,1.0);
-}
\ No newline at end of file
+	fragColor = out_color;
+}
@@ -0,0 +1,49 @@
+#version 430
+
+layout(local_size_x = 256) in;
+
+struct DrawCommand
+{
+	uint count;
+	uint instance_count;
+	uint first_index;
+	uint base_vertex;
+	uint base_instance;
+};
+
+/* Index buffer of the subgraph, two indices per line */
+layout(std430, binding = 0) readonly buffer Lines { uint lines[]; };
+/* Width, colour and segment (lines of the same width) of each line in bits 0-7, 8-15 and 16-31 */
+layout(std430, binding = 1) readonly buffer LineAttributes { uint line_attributes[]; };
+layout(std430, binding = 2) writeonly buffer VisibleLines { uint visible_lines[]; };
+/* One indirect draw per segment, the count starts at zero */
+layout(std430, binding = 3) buffer DrawCommands { DrawCommand commands[]; };
+
+uniform uint line_cnt;
+uniform uint width_mask[8];
+uniform uint color_mask[8];
+
+bool contains(uint mask_word, uint value)
+{
+	return (mask_word & (1u << (value & 31u))) != 0u;
+}
+
+void main()
+{
+	uint line = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	if(line >= line_cnt)
+		return;
+
+	uint attributes = line_attributes[line];
+	uint width = attributes & 0xFFu;
+	uint color = (attributes >> 8) & 0xFFu;
+	uint segment = attributes >> 16;
+
+	if(!contains(width_mask[width >> 5], width) || !contains(color_mask[color >> 5], color))
+		return;
+
+	// Visible lines of a segment are packed at the start of the segment's range of the index buffer
+	uint slot = commands[segment].first_index + atomicAdd(commands[segment].count, 2u);
+	visible_lines[slot] = lines[2u * line];
+	visible_lines[slot + 1u] = lines[2u * line + 1u];
+}
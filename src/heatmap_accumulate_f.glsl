@@ -0,0 +1,9 @@
+#version 150
+
+out float density;
+
+void main()
+{
+	// Added up per texel, a line contributes about its length in texels
+	density = 1.0;
+}
@@ -0,0 +1,37 @@
+#version 150
+
+layout(lines) in;
+layout(line_strip, max_vertices = 4) out;
+
+in vec2 g_geoCoords[];
+
+void emitLine(vec2 a, vec2 b)
+{
+	// Equirectangular projection onto the whole density texture
+	gl_Position = vec4(a.x / 180.0, a.y / 90.0, 0.0, 1.0);
+	EmitVertex();
+	gl_Position = vec4(b.x / 180.0, b.y / 90.0, 0.0, 1.0);
+	EmitVertex();
+	EndPrimitive();
+}
+
+void main()
+{
+	vec2 a = g_geoCoords[0];
+	vec2 b = g_geoCoords[1];
+
+	if (abs(b.x - a.x) <= 180.0)
+	{
+		emitLine(a, b);
+		return;
+	}
+
+	// The shorter way crosses the antimeridian: move the western end around by 360 degrees and draw the line at
+	// both ends of the texture, each copy is clipped where it leaves the texture
+	if (a.x < b.x)
+		a.x += 360.0;
+	else
+		b.x += 360.0;
+	emitLine(a, b);
+	emitLine(a - vec2(360.0, 0.0), b - vec2(360.0, 0.0));
+}
@@ -0,0 +1,11 @@
+#version 150
+
+in vec2 v_geoCoords;
+
+out vec2 g_geoCoords;
+
+void main()
+{
+	// Projected by the geometry shader, which sees both ends of a line
+	g_geoCoords = v_geoCoords;
+}
@@ -0,0 +1,34 @@
+#version 130
+
+#define PI 3.141592653589793238462643383279502884197169399375105820
+
+uniform sampler2D density_tx2D;
+/* Stops of the colormap, evenly spaced */
+uniform sampler1D colormap_tx1D;
+uniform float max_density;
+
+in vec3 position;
+
+out vec4 fragColor;
+
+void main()
+{
+	vec3 p = normalize(position);
+	vec2 uv = vec2(atan(p.x, p.z) / (2.0 * PI) + 0.5, asin(p.y) / PI + 0.5);
+
+	// u jumps at the antimeridian, where the derivatives are taken from u shifted by half a turn instead
+	vec2 du = vec2(dFdx(uv.x), dFdy(uv.x));
+	float u_shifted = fract(uv.x + 0.5);
+	vec2 du_shifted = vec2(dFdx(u_shifted), dFdy(u_shifted));
+	if(dot(du_shifted, du_shifted) < dot(du, du))
+		du = du_shifted;
+
+	float density = textureGrad(density_tx2D, uv, vec2(du.x, dFdx(uv.y)), vec2(du.y, dFdy(uv.y))).r;
+
+	float t = clamp(log(1.0 + density) / log(1.0 + max_density), 0.0, 1.0);
+
+	float stops = float(textureSize(colormap_tx1D, 0));
+	vec3 color = texture(colormap_tx1D, (t * (stops - 1.0) + 0.5) / stops).rgb;
+
+	fragColor = vec4(color, smoothstep(0.0, 0.1, t));
+}
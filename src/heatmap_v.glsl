@@ -0,0 +1,15 @@
+#version 130
+
+in vec3 v_position;
+
+uniform mat4 view_matrix;
+uniform mat4 projection_matrix;
+
+out vec3 position;
+
+void main()
+{
+	position = v_position;
+
+	gl_Position = projection_matrix * view_matrix * vec4(v_position,1.0);
+}
@@ -5,24 +5,25 @@
 uniform mat4 view_matrix;
 uniform mat4 projection_matrix;
 
-uniform vec2 icon_geoCoords;
-uniform float icon_scale;
-uniform vec2 icon_atlasUV;
-
 in vec2 v_position;
 in vec2 v_uv;
 
+// per icon instance attributes
+in vec2 i_anchor;
+in vec2 i_atlasUV;
+in float i_scale;
+
 out vec2 uv;
 out vec2 atlasUV;
 
 void main()
 {	
 	// compute icon position on unit sphere
-	float lat_sin = sin( (PI/180.0) * icon_geoCoords.y);
-	float lon_sin = sin( (PI/180.0) * icon_geoCoords.x);
+	float lat_sin = sin( (PI/180.0) * i_anchor.y);
+	float lon_sin = sin( (PI/180.0) * i_anchor.x);
 	
-	float lat_cos = cos( (PI/180.0) * icon_geoCoords.y);
-	float lon_cos = cos( (PI/180.0) * icon_geoCoords.x);
+	float lat_cos = cos( (PI/180.0) * i_anchor.y);
+	float lon_cos = cos( (PI/180.0) * i_anchor.x);
 	
 	float r = 1.0; //6378137.0;
 	
@@ -46,12 +47,12 @@ void main()
 	
 	vec4 ccs_position = view_matrix * vec4(world_position,1.0);
 	// build base quad for each character in NDCS and add horizontal offset of char position in string
-	ccs_position += vec4(v_position*icon_scale*ccs_scale,0.0,0.0);
+	ccs_position += vec4(v_position*i_scale*ccs_scale,0.0,0.0);
 	
 	vec4 dcs_position = projection_matrix * ccs_position;
 	
 	uv = v_uv;
-	atlasUV = icon_atlasUV;
+	atlasUV = i_atlasUV;
 	
 	gl_Position = dcs_position;
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#version 430
+
+#define PI 3.1415926535897932384
+
+layout(local_size_x = 256) in;
+
+struct DrawCommand
+{
+	uint count;
+	uint instance_count;
+	uint first_index;
+	uint base_vertex;
+	uint base_instance;
+};
+
+/* Per instance data of labels or icons, each instance starts with its geo coordinates (lon, lat) */
+layout(std430, binding = 0) readonly buffer Instances { float instances[]; };
+layout(std430, binding = 1) writeonly buffer VisibleInstances { float visible_instances[]; };
+/* Indirect draw of the visible instances, the instance count starts at zero */
+layout(std430, binding = 2) buffer DrawCommands { DrawCommand command; };
+
+uniform uint instance_cnt;
+/* Size of an instance and offsets of its scale and half width, all in floats */
+uniform uint instance_stride;
+uniform uint scale_offset;
+/* Negative if all instances have the same half width given by half_width */
+uniform int half_width_offset;
+uniform float half_width;
+
+/* Left, right, bottom, top, near and far plane, with normals of unit length pointing inwards */
+uniform vec4 frustum_planes[6];
+uniform vec3 camera_position;
+
+void main()
+{
+	uint instance = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	if(instance >= instance_cnt)
+		return;
+
+	uint base = instance * instance_stride;
+	vec2 geo_coords = vec2(instances[base], instances[base + 1u]) * (PI / 180.0);
+	vec3 anchor = vec3( sin(geo_coords.x) * cos(geo_coords.y),
+						sin(geo_coords.y),
+						cos(geo_coords.y) * cos(geo_coords.x) );
+
+	// The globe hides anchors whose surface normal faces away from the camera
+	if(dot(anchor, camera_position - anchor) <= 0.0)
+		return;
+
+	// Bounding sphere of the quad built by the vertex shaders around the anchor in camera space
+	float scale = instances[base + scale_offset] * 0.25;
+	float extent = (half_width_offset < 0) ? half_width : instances[base + uint(half_width_offset)];
+	float radius = scale * (2.0 * extent + 0.1);
+
+	for(int i = 0; i < 6; i++)
+	{
+		if(dot(frustum_planes[i].xyz, anchor) + frustum_planes[i].w < -radius)
+			return;
+	}
+
+	uint slot = atomicAdd(command.instance_count, 1u) * instance_stride;
+	for(uint i = 0u; i < instance_stride; i++)
+		visible_instances[slot + i] = instances[base + i];
+}
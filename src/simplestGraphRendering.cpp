@@ -13,12 +13,19 @@
 #include <cstring>
 
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <iomanip>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <list>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <bitset>
 
 typedef unsigned int uint;
 
@@ -232,10 +239,69 @@ namespace Math
 
         return (v / l);
     }
+
+    /**
+     * Great-circle distance in meters between two geo coordinates given in degrees, on a sphere of mean earth radius.
+     */
+    double haversine(double lat_a, double lon_a, double lat_b, double lon_b)
+    {
+        const double deg_to_rad = 0.017453292519943295769236907684886;
+        const double earth_radius = 6371008.8;
+
+        double lat_h = std::sin((lat_b - lat_a) * deg_to_rad * 0.5);
+        double lon_h = std::sin((lon_b - lon_a) * deg_to_rad * 0.5);
+        double h = lat_h * lat_h + std::cos(lat_a * deg_to_rad) * std::cos(lat_b * deg_to_rad) * lon_h * lon_h;
+
+        return 2.0 * earth_radius * std::asin(std::sqrt(std::min(1.0, h)));
+    }
+
+    /**
+     * Interleave the bits of two 16 bit grid coordinates, cells close on the resulting Z-order curve are close in the grid.
+     */
+    uint32_t mortonCode(uint16_t x, uint16_t y)
+    {
+        uint32_t code = 0;
+        for (uint bit = 0; bit < 16; bit++)
+            code |= ((uint32_t)((x >> bit) & 1u) << (2 * bit)) | ((uint32_t)((y >> bit) & 1u) << (2 * bit + 1));
+
+        return code;
+    }
+
+    /**
+     * Distance along the Hilbert curve filling a 2^16 x 2^16 grid. Unlike the Z-order curve,
+     * consecutive cells on the Hilbert curve are always adjacent in the grid.
+     */
+    uint32_t hilbertCode(uint16_t grid_x, uint16_t grid_y)
+    {
+        const uint32_t n = 1u << 16;
+
+        uint32_t x = grid_x;
+        uint32_t y = grid_y;
+        uint32_t code = 0;
+        for (uint32_t s = n / 2; s > 0; s /= 2)
+        {
+            uint32_t rx = (x & s) > 0 ? 1 : 0;
+            uint32_t ry = (y & s) > 0 ? 1 : 0;
+            code += s * s * ((3 * rx) ^ ry);
+
+            // Rotate the quadrant, so that the curve of the next level starts and ends at the right corners
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+
+        return code;
+    }
 }
 
 /**
- * Node struct for parsing preprocessed osm graph from file
+ * Node struct, e.g. for the corners of polygons. Graphs loaded from file are stored in a GraphStore.
  */
 struct Node
 {
@@ -246,20 +312,6 @@ struct Node
     double lon;
 };
 
-/**
- * Edge struct for parsing preprocessed osm graph from file
- */
-struct Edge
-{
-    Edge() : source(0), target(0), width(0), color(0) {}
-    Edge(uint s, uint t, uint w, uint c) : source(s), target(t), width(w), color(c) {}
-
-    uint source;
-    uint target;
-    uint width;
-    int color;
-};
-
 /**
  * Each vertex contains the geo coordinates of a node and the color properties of adjacent edges.
  * Thus, for each node with adjacent egdes of different color multiple vertices are constructed.
@@ -274,34 +326,6 @@ struct Vertex
     float color;
 };
 
-struct Node_RGB
-{
-    Node_RGB() : lat(0), lon(0), r(0), g(0), b(0), a((char)255) {}
-    Node_RGB(double la, double lo, char r, char g, char b, char a = (char)255) : lat(la), lon(lo), r(r), g(g), b(b), a(a) {}
-
-    double lat;
-    double lon;
-
-    char r;
-    char g;
-    char b;
-    char a;
-};
-
-struct Edge_RGB
-{
-    Edge_RGB() : source(0), target(0), r(0), g(0), b(0), a((char)255) {}
-    Edge_RGB(uint s, uint t, char r, char g, char b, char a = (char)255)
-        : source(s), target(t), r(r), g(g), b(b), a(a) {}
-
-    uint source;
-    uint target;
-    char r;
-    char g;
-    char b;
-    char a;
-};
-
 struct Vertex_RGB
 {
     Vertex_RGB() : longitude(0.0), latitude(0.0), r(0), g(0), b(0), a((char)255) {}
@@ -316,15 +340,15 @@ struct Vertex_RGB
     char a;
 };
 
-struct Vertex_ID_RGB
+/**
+ * Colour of a single primitive, e.g. a triangle whose vertices are shared with its neighbours
+ */
+struct Colour_RGBA
 {
-    Vertex_ID_RGB() : longitude(0.0), latitude(0.0), id(-1), r(0), g(0), b(0), a((char)255) {}
-    Vertex_ID_RGB(float lon, float lat, char r, char g, char b, int id, char a = (char)255)
-        : longitude(lon), latitude(lat), id(id), r(r), g(g), b(b), a(a) {}
+    Colour_RGBA() : r(0), g(0), b(0), a((char)255) {}
+    Colour_RGBA(char r, char g, char b, char a = (char)255)
+        : r(r), g(g), b(b), a(a) {}
 
-    float longitude;
-    float latitude;
-    int id;
     char r;
     char g;
     char b;
@@ -342,21 +366,6 @@ struct Vertex_XYZ
     float z;
 };
 
-struct Triangle_RGB
-{
-    Triangle_RGB() : v1(0), v2(0), v3(0), r(0), g(0), b(0), a((char)255) {}
-    Triangle_RGB(uint v1, uint v2, uint v3, char r, char g, char b, char a = (char)255)
-        : v1(v1), v2(v2), v3(v3), r(r), g(g), b(b), a(a) {}
-
-    uint v1;
-    uint v2;
-    uint v3;
-    char r;
-    char g;
-    char b;
-    char a;
-};
-
 struct CollisionSphere
 {
     CollisionSphere() : lat(0), lon(0) {}
@@ -393,6 +402,477 @@ namespace Controls
     int collisionSphere_mode = 0;
 }
 
+/**
+ * Split the range [0, count) into one contiguous chunk per thread and call function(begin, end) for each chunk.
+ * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+ */
+template <typename Function>
+void parallelFor(size_t count, Function function, uint num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t chunk_size = std::max<size_t>(1, (count + num_threads - 1) / num_threads);
+
+    // A single chunk isn't worth starting a thread
+    if (chunk_size >= count)
+    {
+        if (count > 0)
+            function(0, count);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t begin = 0; begin < count; begin += chunk_size)
+        threads.push_back(std::thread(function, begin, std::min(begin + chunk_size, count)));
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/**
+ * Sort [first, last) by sorting one contiguous chunk per thread, then merging neighbouring chunks pairwise in parallel.
+ * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+ */
+template <typename Iterator, typename Compare>
+void parallelSort(Iterator first, Iterator last, Compare compare, uint num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t count = last - first;
+
+    // Same chunks as created by parallelFor
+    size_t chunk_size = std::max<size_t>(1, (count + num_threads - 1) / num_threads);
+
+    auto sortRange = [first, compare](size_t begin, size_t end) {
+        std::sort(first + begin, first + end, compare);
+    };
+    parallelFor(count, sortRange, num_threads);
+
+    for (size_t width = chunk_size; width < count; width *= 2)
+    {
+        size_t num_merges = (count + 2 * width - 1) / (2 * width);
+
+        auto mergeRange = [first, count, width, compare](size_t begin, size_t end) {
+            for (size_t merge = begin; merge < end; merge++)
+            {
+                size_t lower = merge * 2 * width;
+                size_t middle = std::min(lower + width, count);
+                size_t upper = std::min(lower + 2 * width, count);
+                if (middle < upper)
+                    std::inplace_merge(first + lower, first + middle, first + upper, compare);
+            }
+        };
+        parallelFor(num_merges, mergeRange, num_threads);
+    }
+}
+
+/**
+ * Graph loaded from file, stored as structure of arrays. Geo coordinates are kept in single precision, which is
+ * what the GPU receives anyway, and each attribute lives in its own array, so that a pass over one attribute only
+ * touches the memory of that attribute. Arrays of attributes a graph file format doesn't provide stay empty,
+ * i.e. .gl graphs come with edge widths and colour classes, .sg graphs with RGBA colours and triangles.
+ */
+struct GraphStore
+{
+    /* Nodes */
+    std::vector<float> latitudes;
+    std::vector<float> longitudes;
+    std::vector<Colour_RGBA> node_colours;
+
+    /* Edges, given by the indices of their two nodes */
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> targets;
+    std::vector<uint8_t> widths;
+    std::vector<uint8_t> colors;
+    std::vector<Colour_RGBA> edge_colours;
+
+    /* Triangles, given by three consecutive node indices each */
+    std::vector<uint32_t> triangle_corners;
+    std::vector<Colour_RGBA> triangle_colours;
+
+    size_t nodeCount() const
+    {
+        return latitudes.size();
+    }
+
+    size_t edgeCount() const
+    {
+        return sources.size();
+    }
+
+    size_t triangleCount() const
+    {
+        return triangle_corners.size() / 3;
+    }
+
+    /**
+     * Reorder nodes and update all node indices of edges and triangles.
+     * \param order Previous index of each node
+     */
+    void permuteNodes(const std::vector<uint> &order)
+    {
+        gather(latitudes, order);
+        gather(longitudes, order);
+        gather(node_colours, order);
+
+        std::vector<uint32_t> new_index(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            new_index[order[i]] = (uint32_t)i;
+
+        for (std::vector<uint32_t> *indices : {&sources, &targets, &triangle_corners})
+        {
+            auto remapRange = [indices, &new_index](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    (*indices)[i] = new_index[(*indices)[i]];
+            };
+            parallelFor(indices->size(), remapRange);
+        }
+    }
+
+    /**
+     * Reorder edges.
+     * \param order Previous index of each edge
+     */
+    void permuteEdges(const std::vector<uint> &order)
+    {
+        gather(sources, order);
+        gather(targets, order);
+        gather(widths, order);
+        gather(colors, order);
+        gather(edge_colours, order);
+    }
+
+    /**
+     * Reorder triangles.
+     * \param order Previous index of each triangle
+     */
+    void permuteTriangles(const std::vector<uint> &order)
+    {
+        std::vector<uint32_t> reordered_corners(triangle_corners.size());
+        for (size_t t = 0; t < order.size(); t++)
+        {
+            reordered_corners[3 * t] = triangle_corners[3 * order[t]];
+            reordered_corners[3 * t + 1] = triangle_corners[3 * order[t] + 1];
+            reordered_corners[3 * t + 2] = triangle_corners[3 * order[t] + 2];
+        }
+        triangle_corners.swap(reordered_corners);
+
+        gather(triangle_colours, order);
+    }
+
+private:
+    template <typename T>
+    static void gather(std::vector<T> &values, const std::vector<uint> &order)
+    {
+        if (values.empty())
+            return;
+
+        std::vector<T> reordered(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            reordered[i] = values[order[i]];
+        values.swap(reordered);
+    }
+};
+
+/**
+ * Points of interest as structure of arrays, each with an optional icon and an optional label.
+ */
+struct PoiStore
+{
+    /** Icon type of points without an icon */
+    static constexpr int8_t NO_ICON = -1;
+
+    std::vector<float> latitudes;
+    std::vector<float> longitudes;
+    /** Icons::Icon of each point, or NO_ICON */
+    std::vector<int8_t> icons;
+    /** Points of higher priority are kept when zoomed out and their labels are placed first */
+    std::vector<float> priorities;
+    /** The UTF-8 label of point i is label_chars[label_offsets[i], label_offsets[i + 1]) */
+    std::vector<uint64_t> label_offsets = std::vector<uint64_t>(1, 0);
+    std::string label_chars;
+
+    size_t size() const
+    {
+        return latitudes.size();
+    }
+
+    std::string label(size_t point) const
+    {
+        return label_chars.substr(label_offsets[point], label_offsets[point + 1] - label_offsets[point]);
+    }
+
+    /**
+     * Append all points of another store.
+     */
+    void append(const PoiStore &other)
+    {
+        latitudes.insert(latitudes.end(), other.latitudes.begin(), other.latitudes.end());
+        longitudes.insert(longitudes.end(), other.longitudes.begin(), other.longitudes.end());
+        icons.insert(icons.end(), other.icons.begin(), other.icons.end());
+        priorities.insert(priorities.end(), other.priorities.begin(), other.priorities.end());
+
+        uint64_t base = label_chars.size();
+        for (size_t i = 1; i < other.label_offsets.size(); i++)
+            label_offsets.push_back(base + other.label_offsets[i]);
+        label_chars.append(other.label_chars);
+    }
+};
+
+constexpr int8_t PoiStore::NO_ICON;
+
+/**
+ * Adjacency of the nodes of a GraphStore in compressed sparse row format. Either follows edges from source to
+ * target (forward) or backwards from target to source (reverse). Each entry references its edge by the index of
+ * the edge in the GraphStore.
+ */
+struct GraphAdjacency
+{
+    enum Direction
+    {
+        FORWARD,
+        REVERSE
+    };
+
+    /* Entries of node n are [offsets[n], offsets[n + 1]), sorted by edge index */
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> neighbours;
+    std::vector<uint32_t> edge_ids;
+
+    size_t nodeCount() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    uint32_t degree(uint32_t node) const
+    {
+        return offsets[node + 1] - offsets[node];
+    }
+
+    /**
+     * Build the adjacency with a parallel count of the node degrees, a parallel prefix sum into the offsets and
+     * a parallel scatter of the edges. Entries of each node are sorted afterwards, so that the result doesn't
+     * depend on the number of threads.
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+     */
+    void build(const GraphStore &graph, Direction direction, uint num_threads = 0)
+    {
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        const std::vector<uint32_t> &from = (direction == FORWARD) ? graph.sources : graph.targets;
+        const std::vector<uint32_t> &to = (direction == FORWARD) ? graph.targets : graph.sources;
+        size_t node_cnt = graph.nodeCount();
+        size_t edge_cnt = graph.edgeCount();
+
+        // Count the degree of each node
+        std::vector<std::atomic<uint32_t>> counts(node_cnt);
+        auto countRange = [&from, &counts](size_t begin, size_t end) {
+            for (size_t e = begin; e < end; e++)
+                counts[from[e]].fetch_add(1, std::memory_order_relaxed);
+        };
+        parallelFor(edge_cnt, countRange, num_threads);
+
+        // Exclusive prefix sum, each chunk of nodes is summed up before the chunk offsets are known
+        offsets.assign(node_cnt + 1, 0);
+        size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, node_cnt));
+        std::vector<uint32_t> chunk_offsets(num_chunks + 1, 0);
+
+        auto sumRange = [&counts, &chunk_offsets, node_cnt, num_chunks](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t sum = 0;
+                for (size_t n = (node_cnt * chunk) / num_chunks; n < (node_cnt * (chunk + 1)) / num_chunks; n++)
+                    sum += counts[n].load(std::memory_order_relaxed);
+                chunk_offsets[chunk + 1] = sum;
+            }
+        };
+        parallelFor(num_chunks, sumRange, (uint)num_chunks);
+
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            chunk_offsets[chunk + 1] += chunk_offsets[chunk];
+
+        auto scanRange = [this, &counts, &chunk_offsets, node_cnt, num_chunks](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t offset = chunk_offsets[chunk];
+                for (size_t n = (node_cnt * chunk) / num_chunks; n < (node_cnt * (chunk + 1)) / num_chunks; n++)
+                {
+                    offsets[n] = offset;
+                    offset += counts[n].load(std::memory_order_relaxed);
+                    counts[n].store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+        parallelFor(num_chunks, scanRange, (uint)num_chunks);
+        offsets[node_cnt] = (uint32_t)edge_cnt;
+
+        // Scatter the edges, counts are reused as insertion cursor of each node
+        edge_ids.resize(edge_cnt);
+        auto scatterRange = [this, &from, &counts](size_t begin, size_t end) {
+            for (size_t e = begin; e < end; e++)
+            {
+                uint32_t node = from[e];
+                edge_ids[offsets[node] + counts[node].fetch_add(1, std::memory_order_relaxed)] = (uint32_t)e;
+            }
+        };
+        parallelFor(edge_cnt, scatterRange, num_threads);
+
+        neighbours.resize(edge_cnt);
+        auto sortRange = [this, &to](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
+            {
+                std::sort(edge_ids.begin() + offsets[n], edge_ids.begin() + offsets[n + 1]);
+                for (uint32_t i = offsets[n]; i < offsets[n + 1]; i++)
+                    neighbours[i] = to[edge_ids[i]];
+            }
+        };
+        parallelFor(node_cnt, sortRange, num_threads);
+    }
+};
+
+/**
+ * Uniform grid over the bounding box of the nodes of a GraphStore, each cell lists the nodes inside in compressed
+ * sparse row format. Finds the node under the cursor by searching the cells in rings around it, rather than by
+ * scanning all nodes.
+ */
+struct NodeGrid
+{
+    NodeGrid() : graph(nullptr), min_lon(0.0f), min_lat(0.0f), cell_lon(1.0f), cell_lat(1.0f), grid_width(0), grid_height(0) {}
+
+    /* Nodes of cell c are [offsets[c], offsets[c + 1]) */
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> nodes;
+
+    /**
+     * Build the grid with about NODES_PER_CELL nodes per cell, keeping the cells roughly square in degrees.
+     */
+    void build(const GraphStore &graph)
+    {
+        size_t node_cnt = graph.nodeCount();
+        this->graph = &graph;
+        offsets.assign(1, 0);
+        nodes.clear();
+        if (node_cnt == 0)
+            return;
+
+        auto lon_range = std::minmax_element(graph.longitudes.begin(), graph.longitudes.end());
+        auto lat_range = std::minmax_element(graph.latitudes.begin(), graph.latitudes.end());
+        min_lon = *lon_range.first;
+        min_lat = *lat_range.first;
+        float lon_span = std::max(*lon_range.second - min_lon, 1e-6f);
+        float lat_span = std::max(*lat_range.second - min_lat, 1e-6f);
+
+        double cell_cnt = std::max(1.0, (double)node_cnt / NODES_PER_CELL);
+        double aspect = (double)lon_span / lat_span;
+        grid_width = (uint32_t)std::min<double>(node_cnt, std::max(1.0, std::round(std::sqrt(cell_cnt * aspect))));
+        grid_height = (uint32_t)std::min<double>(node_cnt, std::max(1.0, std::round(cell_cnt / grid_width)));
+        cell_lon = lon_span / grid_width;
+        cell_lat = lat_span / grid_height;
+
+        // Counting sort of the nodes by cell
+        std::vector<uint32_t> node_cells(node_cnt);
+        offsets.assign((size_t)grid_width * grid_height + 1, 0);
+        for (uint32_t n = 0; n < node_cnt; n++)
+        {
+            node_cells[n] = cellY(graph.latitudes[n]) * grid_width + cellX(graph.longitudes[n]);
+            offsets[node_cells[n] + 1]++;
+        }
+        for (size_t c = 1; c < offsets.size(); c++)
+            offsets[c] += offsets[c - 1];
+
+        nodes.resize(node_cnt);
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (uint32_t n = 0; n < node_cnt; n++)
+            nodes[cursor[node_cells[n]]++] = n;
+    }
+
+    /**
+     * Find the node closest to the given geo coordinates, by local equirectangular distance, which is close enough
+     * to pick the node under the cursor.
+     * \return Index of the closest node, the node count if there are no nodes
+     */
+    uint32_t closestNode(float lon, float lat) const
+    {
+        uint32_t closest = (uint32_t)nodes.size();
+        if (nodes.empty())
+            return closest;
+
+        float lon_scale = std::abs(std::cos(lat * PI / 180.0f));
+        float closest_distance = std::numeric_limits<float>::max();
+        int x = (int)cellX(lon);
+        int y = (int)cellY(lat);
+        for (int ring = 0;; ring++)
+        {
+            for (int cy = std::max(0, y - ring); cy <= std::min((int)grid_height - 1, y + ring); cy++)
+            {
+                // Inner rows of the ring only have their first and last cell
+                int step = (cy == y - ring || cy == y + ring) ? 1 : 2 * ring;
+                for (int cx = x - ring; cx <= x + ring; cx += std::max(step, 1))
+                {
+                    if (cx < 0 || cx >= (int)grid_width)
+                        continue;
+                    uint32_t cell = (uint32_t)cy * grid_width + (uint32_t)cx;
+                    for (uint32_t i = offsets[cell]; i < offsets[cell + 1]; i++)
+                    {
+                        uint32_t n = nodes[i];
+                        float d_lon = (graph->longitudes[n] - lon) * lon_scale;
+                        float d_lat = graph->latitudes[n] - lat;
+                        float distance = d_lon * d_lon + d_lat * d_lat;
+                        if (distance < closest_distance || (distance == closest_distance && n < closest))
+                        {
+                            closest_distance = distance;
+                            closest = n;
+                        }
+                    }
+                }
+            }
+
+            // Nodes in cells outside of this ring are at least as far away as the nearest side of the ring, which
+            // is measured from the coordinates rather than from their cell, as those may lie outside of the grid
+            float inf = std::numeric_limits<float>::infinity();
+            float x_in_cells = (lon - min_lon) / cell_lon;
+            float y_in_cells = (lat - min_lat) / cell_lat;
+            float bound = std::min(std::min(x + ring + 1 < (int)grid_width ? (x + ring + 1 - x_in_cells) * cell_lon * lon_scale : inf,
+                                            x - ring > 0 ? (x_in_cells - (x - ring)) * cell_lon * lon_scale : inf),
+                                   std::min(y + ring + 1 < (int)grid_height ? (y + ring + 1 - y_in_cells) * cell_lat : inf,
+                                            y - ring > 0 ? (y_in_cells - (y - ring)) * cell_lat : inf));
+            if (std::isinf(bound) || (closest != nodes.size() && bound * bound > closest_distance))
+                break;
+        }
+        return closest;
+    }
+
+private:
+    /* Mean number of nodes per cell */
+    static constexpr double NODES_PER_CELL = 2.0;
+
+    const GraphStore *graph;
+    float min_lon;
+    float min_lat;
+    float cell_lon;
+    float cell_lat;
+    uint32_t grid_width;
+    uint32_t grid_height;
+
+    /* Cell column and row of a coordinate, coordinates outside of the grid are clamped to the border cells */
+    uint32_t cellX(float lon) const
+    {
+        float x = (lon - min_lon) / cell_lon;
+        return x <= 0.0f ? 0 : std::min(grid_width - 1, (uint32_t)x);
+    }
+
+    uint32_t cellY(float lat) const
+    {
+        float y = (lat - min_lat) / cell_lat;
+        return y <= 0.0f ? 0 : std::min(grid_height - 1, (uint32_t)y);
+    }
+};
+
+constexpr double NodeGrid::NODES_PER_CELL;
+
 /**
  * Function to simply read the string of a shader source file from disk
  */
@@ -412,45 +892,87 @@ const std::string readShaderFile(const char *const path)
     return source.str();
 }
 
-std::vector<uint16_t> toUnicodePoints(const std::string &str)
+/** Code point substituted for malformed UTF-8 sequences */
+constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+/**
+ * Decode a UTF-8 string into unicode code points. Overlong encodings, surrogates, code points
+ * beyond U+10FFFF and truncated sequences are replaced by U+FFFD rather than rejected, so a single
+ * broken name cannot abort a bulk import. Runs of ASCII are tested and copied eight bytes at a time.
+ */
+std::vector<uint32_t> toUnicodePoints(const std::string &str)
 {
-    std::vector<uint16_t> result;
-    for (std::string::const_iterator it(str.begin()), end(str.end()); it != end; ++it)
+    std::vector<uint32_t> result;
+    result.reserve(str.size());
+
+    const uint8_t *it = reinterpret_cast<const uint8_t *>(str.data());
+    const uint8_t *const end = it + str.size();
+    while (it != end)
     {
-        if (static_cast<uint8_t>(*it) < 0x80)
+        // ASCII fast path, a word without any high bit set holds eight single byte code points
+        while (end - it >= 8)
         {
-            result.emplace_back(*it);
+            uint64_t word;
+            std::memcpy(&word, it, sizeof(word));
+            if (word & 0x8080808080808080ull)
+                break;
+            result.insert(result.end(), it, it + 8);
+            it += 8;
         }
-        else if ((static_cast<uint8_t>(*it) >> 5) == 0x6)
+        if (it == end)
+            break;
+
+        uint8_t lead = *it++;
+        if (lead < 0x80)
         {
-            // codepoints is encoded by 2
-            uint32_t code_point = *it;
-            ++it;
-            assert(it != end);
-            code_point = ((code_point << 6) & 0x7ff) + ((*it) & 0x3f);
-            result.emplace_back(code_point);
+            result.push_back(lead);
+            continue;
         }
-        else if ((static_cast<uint8_t>(*it) >> 3) == 0x1e)
-        {
-            uint32_t code_point = static_cast<uint8_t>(*it);
-            ++it;
-            assert(it != end);
-
-            code_point = ((code_point << 12) & 0xffff) + ((static_cast<uint8_t>(*it) << 6) & 0xfff);
-            ++it;
-            assert(it != end);
 
-            code_point += (*it) & 0x3f;
-            if (code_point > std::numeric_limits<uint16_t>::max())
-            {
-                throw std::range_error("Cannot encode unicode codepoint in 2 Bytes");
-            }
-            result.emplace_back(code_point);
+        // valid range of the first continuation byte depends on the lead byte (RFC 3629, section 4)
+        uint32_t code_point;
+        int continuation_cnt;
+        uint8_t lower = 0x80;
+        uint8_t upper = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            code_point = lead & 0x1F;
+            continuation_cnt = 1;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            code_point = lead & 0x0F;
+            continuation_cnt = 2;
+            lower = lead == 0xE0 ? 0xA0 : 0x80; // overlong
+            upper = lead == 0xED ? 0x9F : 0xBF; // surrogates
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            code_point = lead & 0x07;
+            continuation_cnt = 3;
+            lower = lead == 0xF0 ? 0x90 : 0x80; // overlong
+            upper = lead == 0xF4 ? 0x8F : 0xBF; // beyond U+10FFFF
         }
         else
         {
-            throw std::runtime_error("utf8 codepoints with more than 2 Bytes are not supported");
+            result.push_back(REPLACEMENT_CHARACTER);
+            continue;
+        }
+
+        bool valid = true;
+        for (; continuation_cnt > 0; continuation_cnt--)
+        {
+            // a malformed sequence ends before the offending byte, which is decoded on its own
+            if (it == end || *it < lower || *it > upper)
+            {
+                valid = false;
+                break;
+            }
+            code_point = (code_point << 6) | (*it++ & 0x3F);
+            lower = 0x80;
+            upper = 0xBF;
         }
+        result.push_back(valid ? code_point : REPLACEMENT_CHARACTER);
     }
     return result;
 }
@@ -503,13 +1025,14 @@ GLuint compileShader(const std::string *const source, GLenum shaderType)
 }
 
 /**
- * Load a shader program
+ * Load a shader program with a geometry shader
  * \attribute vs_path Path to vertex shader source file
+ * \attribute gs_path Path to geometry shader source file, nullptr for none
  * \attribute fs_path Path to fragement shader source file
  * \attribute attributes Vertex shader input attributes (i.e. vertex layout)
  * \return Returns the handle of the created GLSL program
  */
-GLuint createShaderProgram(const char *vs_path, const char *fs_path, std::vector<const char *> attributes)
+GLuint createShaderProgram(const char *vs_path, const char *gs_path, const char *fs_path, std::vector<const char *> attributes)
 {
     /* Create a shader program object */
     GLuint handle;
@@ -535,6 +1058,15 @@ GLuint createShaderProgram(const char *vs_path, const char *fs_path, std::vector
      */
     glDeleteShader(vertex_shader);
 
+    /* Load, compile and attach geometry shader */
+    if (gs_path != nullptr)
+    {
+        std::string gs_source = readShaderFile(gs_path);
+        GLuint geometry_shader = compileShader(&gs_source, GL_GEOMETRY_SHADER);
+        glAttachShader(handle, geometry_shader);
+        glDeleteShader(geometry_shader);
+    }
+
     /* Load, compile and attach fragment shader */
     std::string fs_source = readShaderFile(fs_path);
 
@@ -577,9 +1109,116 @@ GLuint createShaderProgram(const char *vs_path, const char *fs_path, std::vector
 }
 
 /**
- * Collection of functions for loading graphic resources
+ * Load a shader program
+ * \attribute vs_path Path to vertex shader source file
+ * \attribute fs_path Path to fragement shader source file
+ * \attribute attributes Vertex shader input attributes (i.e. vertex layout)
+ * \return Returns the handle of the created GLSL program
  */
-namespace ResourceLoader
+GLuint createShaderProgram(const char *vs_path, const char *fs_path, std::vector<const char *> attributes)
+{
+    return createShaderProgram(vs_path, nullptr, fs_path, attributes);
+}
+
+/**
+ * Load a compute shader program, requires OpenGL 4.3
+ * \attribute cs_path Path to compute shader source file
+ * \return Returns the handle of the created GLSL program
+ */
+GLuint createComputeProgram(const char *cs_path)
+{
+    GLuint handle = glCreateProgram();
+
+    std::string cs_source = readShaderFile(cs_path);
+
+    GLuint compute_shader = compileShader(&cs_source, GL_COMPUTE_SHADER);
+    glAttachShader(handle, compute_shader);
+    glDeleteShader(compute_shader);
+
+    glLinkProgram(handle);
+
+    /* Check if linking was successful */
+    GLint status = GL_FALSE;
+    glGetProgramiv(handle, GL_LINK_STATUS, &status);
+
+    GLint logLen = 0;
+    glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &logLen);
+    if (logLen > 0)
+    {
+        char *log = new char[logLen];
+        GLsizei written;
+        glGetProgramInfoLog(handle, logLen, &written, log);
+        std::cout << log << std::endl;
+        delete[] log;
+    }
+
+    if (status == GL_FALSE)
+        return -1;
+
+    return handle;
+}
+
+/**
+ * Collection of functions for loading graphic resources
+ */
+/**
+ * Resize a buffer object while keeping its handle and the first used_size bytes of its content.
+ * Vertex array objects referencing the buffer remain valid.
+ */
+void resizeBuffer(GLuint buffer_handle, GLsizeiptr used_size, GLsizeiptr new_size, GLenum usage)
+{
+    GLuint copy_handle = 0;
+
+    if (used_size > 0)
+    {
+        glGenBuffers(1, &copy_handle);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, copy_handle);
+        glBufferData(GL_COPY_WRITE_BUFFER, used_size, nullptr, GL_STREAM_COPY);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer_handle);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_size);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer_handle);
+    glBufferData(GL_COPY_READ_BUFFER, new_size, nullptr, usage);
+
+    if (used_size > 0)
+    {
+        glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, used_size);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &copy_handle);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+/**
+ * Make room for at least required elements of element_bytes each in a buffer object, at least doubling its
+ * capacity so that appending elements one by one costs amortized constant time.
+ */
+void reserveBuffer(GLuint buffer_handle, size_t &capacity, size_t used, size_t required, size_t element_bytes)
+{
+    if (required <= capacity)
+        return;
+
+    capacity = std::max(required, 2 * capacity);
+
+    resizeBuffer(buffer_handle, used * element_bytes, capacity * element_bytes, GL_DYNAMIC_DRAW);
+}
+
+/**
+ * (Re-)Load a 1D texture of RGBA colours, e.g. a palette (GL_NEAREST) or the stops of a colormap (GL_LINEAR).
+ */
+void loadColorTexture1D(GLuint tx_handle, const std::vector<std::array<float, 4>> &colors, GLint filter)
+{
+    glBindTexture(GL_TEXTURE_1D, tx_handle);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, (GLsizei)colors.size(), 0, GL_RGBA, GL_FLOAT, colors.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+namespace ResourceLoader
 {
 
     /**
@@ -768,40 +1407,43 @@ namespace Parser
     /**
      * Creates a new graph node
      * @param input_string Input string containing node data
-     * @param n Nodes vector to put the new node into.
+     * @param graph Graph to put the new node into.
      */
-    void createNode(const std::string &input_string, std::vector<Node> &n)
+    void createNode(const std::string &input_string, GraphStore &graph)
     {
         std::string lat, lon;
 
         std::stringstream ss(input_string);
         ss >> lat >> lon;
 
-        n.emplace_back(std::stof(lat), std::stof(lon));
+        graph.latitudes.push_back(std::stof(lat));
+        graph.longitudes.push_back(std::stof(lon));
     }
 
     /**
      * createEdge - create a new edge
      * @param input_string Input string containing edge data
-     * @param e Edges vector to put the new edge into.
+     * @param graph Graph to put the new edge into.
      */
-    void createEdge(const std::string &input_string, std::vector<Edge> &e)
+    void createEdge(const std::string &input_string, GraphStore &graph)
     {
         std::string source, target, width, color;
 
         std::stringstream ss(input_string);
         ss >> source >> target >> width >> color;
 
-        e.emplace_back(std::stoul(source), std::stoul(target), std::stoul(width), std::stoi(color));
+        graph.sources.push_back(std::stoul(source));
+        graph.targets.push_back(std::stoul(target));
+        graph.widths.push_back((uint8_t)std::min(std::stoul(width), 255ul));
+        graph.colors.push_back((uint8_t)std::max(0, std::min(std::stoi(color), 255)));
     }
 
     /**
      * Parse node and egde from input file
      * @param graphfile Path to the graphfile
-     * @param n Vector for storing the parsed nodes
-     * @param e Vector for storing the parsed edges
+     * @param graph Graph for storing the parsed nodes and edges
      */
-    bool parseTxtGraphFile(const std::string &graphfile, std::vector<Node> &n, std::vector<Edge> &e)
+    bool parseTxtGraphFile(const std::string &graphfile, GraphStore &graph)
     {
         std::string buffer;
         std::ifstream file;
@@ -817,18 +1459,22 @@ namespace Parser
             getline(file, buffer, '\n');
             uint edge_count = std::stoul(buffer);
 
-            n.reserve(node_count);
+            graph.latitudes.reserve(node_count);
+            graph.longitudes.reserve(node_count);
             for (uint i = 0; i < node_count; i++)
             {
                 getline(file, buffer, '\n');
-                createNode(buffer, n);
+                createNode(buffer, graph);
             }
 
-            e.reserve(edge_count);
+            graph.sources.reserve(edge_count);
+            graph.targets.reserve(edge_count);
+            graph.widths.reserve(edge_count);
+            graph.colors.reserve(edge_count);
             for (uint j = 0; j < edge_count; j++)
             {
                 getline(file, buffer, '\n');
-                createEdge(buffer, e);
+                createEdge(buffer, graph);
             }
             file.close();
             return true;
@@ -836,13 +1482,11 @@ namespace Parser
         return false;
     }
 
-    void createNodeRGB(const std::string &input_string, std::vector<Node_RGB> &n)
+    /**
+     * Parse the optional alpha value of a colour, which defaults to opaque
+     */
+    char parseAlpha(const std::string &a)
     {
-        std::string lat, lon, r, g, b, a;
-
-        std::stringstream ss(input_string);
-        ss >> lat >> lon >> r >> g >> b >> a;
-
         int av;
         try
         {
@@ -853,50 +1497,47 @@ namespace Parser
             av = 255;
         };
 
-        n.emplace_back(std::stof(lat), std::stof(lon), std::stoi(r), std::stoi(g), std::stoi(b), av);
+        return (char)av;
+    }
+
+    void createNodeRGB(const std::string &input_string, GraphStore &graph)
+    {
+        std::string lat, lon, r, g, b, a;
+
+        std::stringstream ss(input_string);
+        ss >> lat >> lon >> r >> g >> b >> a;
+
+        graph.latitudes.push_back(std::stof(lat));
+        graph.longitudes.push_back(std::stof(lon));
+        graph.node_colours.push_back(Colour_RGBA(std::stoi(r), std::stoi(g), std::stoi(b), parseAlpha(a)));
     }
 
-    void createEdgeRGB(const std::string &input_string, std::vector<Edge_RGB> &e)
+    void createEdgeRGB(const std::string &input_string, GraphStore &graph)
     {
         std::string source, target, r, g, b, a;
 
         std::stringstream ss(input_string);
         ss >> source >> target >> r >> g >> b >> a;
 
-        int av;
-        try
-        {
-            av = std::stoi(a);
-        }
-        catch (const std::invalid_argument &e)
-        {
-            av = 255;
-        };
-
-        e.emplace_back(std::stoul(source), std::stoul(target), std::stoi(r), std::stoi(g), std::stoi(b), av);
+        graph.sources.push_back(std::stoul(source));
+        graph.targets.push_back(std::stoul(target));
+        graph.edge_colours.push_back(Colour_RGBA(std::stoi(r), std::stoi(g), std::stoi(b), parseAlpha(a)));
     }
 
-    void createTriangleRGB(const std::string &input_string, std::vector<Triangle_RGB> &t)
+    void createTriangleRGB(const std::string &input_string, GraphStore &graph)
     {
         std::string v1, v2, v3, r, g, b, a;
 
         std::stringstream ss(input_string);
         ss >> v1 >> v2 >> v3 >> r >> g >> b >> a;
 
-        int av;
-        try
-        {
-            av = std::stoi(a);
-        }
-        catch (const std::invalid_argument &e)
-        {
-            av = 255;
-        };
-
-        t.emplace_back(std::stoul(v1), std::stoul(v2), std::stoul(v3), std::stoi(r), std::stoi(g), std::stoi(b), av);
+        graph.triangle_corners.push_back(std::stoul(v1));
+        graph.triangle_corners.push_back(std::stoul(v2));
+        graph.triangle_corners.push_back(std::stoul(v3));
+        graph.triangle_colours.push_back(Colour_RGBA(std::stoi(r), std::stoi(g), std::stoi(b), parseAlpha(a)));
     }
 
-    bool parseTxtTriangleGraphFile(const std::string &graphfile, std::vector<Node_RGB> &n, std::vector<Edge_RGB> &e, std::vector<Triangle_RGB> &t)
+    bool parseTxtTriangleGraphFile(const std::string &graphfile, GraphStore &graph)
     {
         std::string buffer;
         std::ifstream file;
@@ -914,25 +1555,30 @@ namespace Parser
             getline(file, buffer, '\n');
             uint triangle_count = std::stoul(buffer);
 
-            n.reserve(node_count);
+            graph.latitudes.reserve(node_count);
+            graph.longitudes.reserve(node_count);
+            graph.node_colours.reserve(node_count);
             for (uint i = 0; i < node_count; i++)
             {
                 getline(file, buffer, '\n');
-                createNodeRGB(buffer, n);
+                createNodeRGB(buffer, graph);
             }
 
-            e.reserve(edge_count);
+            graph.sources.reserve(edge_count);
+            graph.targets.reserve(edge_count);
+            graph.edge_colours.reserve(edge_count);
             for (uint j = 0; j < edge_count; j++)
             {
                 getline(file, buffer, '\n');
-                createEdgeRGB(buffer, e);
+                createEdgeRGB(buffer, graph);
             }
 
-            t.reserve(triangle_count);
+            graph.triangle_corners.reserve(triangle_count * 3);
+            graph.triangle_colours.reserve(triangle_count);
             for (uint k = 0; k < triangle_count; k++)
             {
                 getline(file, buffer, '\n');
-                createTriangleRGB(buffer, t);
+                createTriangleRGB(buffer, graph);
             }
 
             file.close();
@@ -999,694 +1645,4000 @@ namespace Parser
             }
         }
     }
-}
 
-/*
- * Camera (for OpenGL) orbiting a sphere that is centered on the origin
- */
-struct OrbitalCamera
-{
-    OrbitalCamera() : longitude(0.0f), latitude(0.0f), orbit(5.0f), near(0.01f), far(10.0f), fovy(1.0), aspect_ratio(1.0) {}
-    ~OrbitalCamera() {}
+    /**
+     * Change entries of a palette, given by lines "index r g b [a]" with colour components in [0,1]. Lines starting
+     * with // are skipped.
+     * @param palette_path Path to the palette file
+     * @param colors Palette, grows to hold the highest index
+     */
+    bool parsePaletteFile(const std::string &palette_path, std::vector<std::array<float, 4>> &colors)
+    {
+        std::ifstream file(palette_path.c_str(), std::ios::in);
+        if (!file.is_open())
+            return false;
 
-    float longitude;
-    float latitude;
-    float orbit;
+        std::string buffer;
+        while (getline(file, buffer, '\n'))
+        {
+            if (buffer.empty() || buffer.compare(0, 2, "//") == 0)
+                continue;
+
+            std::stringstream ss(buffer);
+            uint index;
+            std::array<float, 4> color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+            if (!(ss >> index >> color[0] >> color[1] >> color[2]) || index > 255)
+                return false;
+            ss >> color[3];
+
+            if (index >= colors.size())
+                colors.resize(index + 1, {{0.0f, 0.0f, 0.0f, 1.0f}});
+            colors[index] = color;
+        }
+        return true;
+    }
 
-    float near;
-    float far;
-    float fovy;
-    float aspect_ratio;
+    /**
+     * Parse one line "lat lon icon priority label" of a text POI file. The label is the rest of the line and may
+     * be empty, an icon below 0 means no icon.
+     * \return False if the line is malformed
+     */
+    bool createPoi(const char *line, const char *line_end, PoiStore &pois)
+    {
+        // tolerate Windows line endings
+        if (line_end != line && *(line_end - 1) == '\r')
+            line_end--;
 
-    void moveInOrbit(float delta_lat, float delta_lon, float delta_height)
+        const char *it = line;
+        float values[4];
+        for (float &value : values)
+        {
+            // strtof would skip line breaks as whitespace, so skip blanks here and require a number on this line
+            while (it != line_end && (*it == ' ' || *it == '\t'))
+                it++;
+            char *number_end;
+            value = std::strtof(it, &number_end);
+            if (number_end == it || number_end > line_end)
+                return false;
+            it = number_end;
+        }
+        if (it != line_end && *it != ' ' && *it != '\t')
+            return false;
+        if (it != line_end)
+            it++;
+
+        pois.latitudes.push_back(values[0]);
+        pois.longitudes.push_back(values[1]);
+        pois.icons.push_back((int8_t)std::max(-1.0f, std::min(127.0f, values[2])));
+        pois.priorities.push_back(values[3]);
+        pois.label_chars.append(it, line_end);
+        pois.label_offsets.push_back(pois.label_chars.size());
+        return true;
+    }
+
+    /**
+     * Parse a text POI file with one point "lat lon icon priority label" per line, lines that are empty or start
+     * with // are skipped. The file is split into blocks of whole lines that are parsed in parallel.
+     * @param poi_path Path to the POI file
+     * @param pois Store the points are appended to
+     */
+    bool parseTxtPoiFile(const std::string &poi_path, PoiStore &pois, uint num_threads = 0)
     {
-        latitude += delta_lat;
-        longitude += delta_lon;
+        std::ifstream file(poi_path.c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
 
-        if (longitude < -180.0f)
-            longitude = 360.0f + longitude;
+        std::string content;
+        file.seekg(0, std::ios::end);
+        content.resize((size_t)file.tellg());
+        file.seekg(0, std::ios::beg);
+        file.read(&content[0], content.size());
+        if (!file)
+            return false;
 
-        if (longitude > 180.0f)
-            longitude = -180.0f + (longitude - 180.0f);
+        // blocks start behind the first line break at or after a multiple of the block size
+        const size_t block_bytes = 1 << 22;
+        size_t block_cnt = content.size() / block_bytes + 1;
+        std::vector<size_t> block_starts(block_cnt + 1, content.size());
+        block_starts[0] = 0;
+        for (size_t b = 1; b < block_cnt; b++)
+        {
+            size_t line_break = content.find('\n', b * block_bytes - 1);
+            block_starts[b] = (line_break == std::string::npos) ? content.size() : line_break + 1;
+        }
 
-        // m_orbit += delta_height;
+        std::vector<PoiStore> blocks(block_cnt);
+        std::atomic<bool> valid(true);
+        auto parseRange = [&content, &block_starts, &blocks, &valid](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++)
+            {
+                const char *it = content.data() + block_starts[b];
+                const char *const block_end = content.data() + std::max(block_starts[b], block_starts[b + 1]);
+                while (it < block_end && valid)
+                {
+                    const char *line_end = std::find(it, block_end, '\n');
+                    bool blank = (it == line_end || *it == '\r' || (line_end - it >= 2 && it[0] == '/' && it[1] == '/'));
+                    if (!blank && !createPoi(it, line_end, blocks[b]))
+                        valid = false;
+                    it = line_end + 1;
+                }
+            }
+        };
+        parallelFor(block_cnt, parseRange, num_threads);
 
-        orbit = std::max(1.0f + 0.000025f, orbit + delta_height);
+        if (!valid)
+            return false;
 
-        updateViewMatrix();
+        for (auto &block : blocks)
+            pois.append(block);
+        return true;
     }
 
-    Math::Mat4x4 view_matrix;
-    Math::Mat4x4 projection_matrix;
+    /** Magic number at the start of binary POI files */
+    constexpr char POI_MAGIC[8] = {'S', 'G', 'R', 'P', 'O', 'I', '0', '1'};
 
-    void updateProjectionMatrix()
+    /**
+     * Write points in the binary POI format: magic, point count, label bytes, followed by the latitudes,
+     * longitudes, priorities, icons, label offsets and label characters as arrays.
+     */
+    bool writeBinPoiFile(const std::string &poi_path, const PoiStore &pois)
     {
-        float f = 1.0f / std::tan(fovy / 2.0f);
-        float nf = 1.0f / (near - far);
-        projection_matrix[0] = f / aspect_ratio;
-        projection_matrix[1] = 0.0f;
-        projection_matrix[2] = 0.0f;
-        projection_matrix[3] = 0.0f;
-        projection_matrix[4] = 0.0f;
-        projection_matrix[5] = f;
-        projection_matrix[6] = 0.0f;
-        projection_matrix[7] = 0.0f;
-        projection_matrix[8] = 0.0f;
-        projection_matrix[9] = 0.0f;
-        projection_matrix[10] = (far + near) * nf;
-        projection_matrix[11] = -1.0f;
-        projection_matrix[12] = 0.0f;
-        projection_matrix[13] = 0.0f;
-        projection_matrix[14] = (2.0f * far * near) * nf;
-        projection_matrix[15] = 0.0f;
+        std::ofstream file(poi_path.c_str(), std::ios::out | std::ios::binary);
+        if (!file.good())
+            return false;
+
+        uint64_t header[2] = {pois.size(), pois.label_chars.size()};
+        file.write(POI_MAGIC, sizeof(POI_MAGIC));
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(pois.latitudes.data()), pois.size() * sizeof(float));
+        file.write(reinterpret_cast<const char *>(pois.longitudes.data()), pois.size() * sizeof(float));
+        file.write(reinterpret_cast<const char *>(pois.priorities.data()), pois.size() * sizeof(float));
+        file.write(reinterpret_cast<const char *>(pois.icons.data()), pois.size() * sizeof(int8_t));
+        file.write(reinterpret_cast<const char *>(pois.label_offsets.data()), pois.label_offsets.size() * sizeof(uint64_t));
+        file.write(pois.label_chars.data(), pois.label_chars.size());
+
+        return file.good();
     }
 
-    void updateViewMatrix()
+    /**
+     * Read a binary POI file written by writeBinPoiFile, replacing the points of the store.
+     * \return False if the file doesn't exist, is not a binary POI file or is broken
+     */
+    bool parseBinPoiFile(const std::string &poi_path, PoiStore &pois)
     {
-        float lat_sin = sin((PI / 180.0f) * latitude);
-        float lon_sin = sin((PI / 180.0f) * longitude);
-
-        float lat_cos = cos((PI / 180.0f) * latitude);
-        float lon_cos = cos((PI / 180.0f) * longitude);
-
-        float camera_position[3];
-        camera_position[0] = (lon_sin * lat_cos * orbit);
-        camera_position[1] = (lat_sin * orbit);
-        camera_position[2] = (lat_cos * lon_cos * orbit);
+        std::ifstream file(poi_path.c_str(), std::ios::in | std::ios::binary);
+        if (!file.good())
+            return false;
 
-        Math::Mat4x4 lat_rotation(std::array<float, 16>({1.0, 0.0, 0.0, 0.0,
-                                                         0.0, lat_cos, -lat_sin, 0.0,
-                                                         0.0, lat_sin, lat_cos, 0.0,
-                                                         0.0, 0.0, 0.0, 1.0}));
+        file.seekg(0, std::ios::end);
+        uint64_t file_size = (uint64_t)file.tellg();
+        file.seekg(0, std::ios::beg);
 
-        Math::Mat4x4 lon_rotation(std::array<float, 16>({lon_cos, 0.0, -lon_sin, 0.0,
-                                                         0.0, 1.0, 0.0, 0.0,
-                                                         lon_sin, 0.0, lon_cos, 0.0,
-                                                         0.0, 0.0, 0.0, 1.0}));
+        char magic[sizeof(POI_MAGIC)];
+        uint64_t header[2];
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (!file.good() || std::memcmp(magic, POI_MAGIC, sizeof(magic)) != 0)
+            return false;
 
-        Math::Mat4x4 rotation_matrix = lon_rotation * lat_rotation;
+        // The header has to match the size of the file before anything is allocated, each point takes 21 bytes
+        // (three floats, the icon and its label offset) plus the leading label offset and the label characters
+        const uint64_t point_bytes = 3 * sizeof(float) + sizeof(int8_t) + sizeof(uint64_t);
+        uint64_t data_size = file_size - std::min(file_size, (uint64_t)(sizeof(POI_MAGIC) + sizeof(header)));
+        if (data_size < sizeof(uint64_t) || header[1] > data_size - sizeof(uint64_t) ||
+            header[0] != (data_size - sizeof(uint64_t) - header[1]) / point_bytes ||
+            (data_size - sizeof(uint64_t) - header[1]) % point_bytes != 0)
+            return false;
 
-        rotation_matrix = rotation_matrix.inverse();
+        pois.latitudes.resize(header[0]);
+        pois.longitudes.resize(header[0]);
+        pois.priorities.resize(header[0]);
+        pois.icons.resize(header[0]);
+        pois.label_offsets.resize(header[0] + 1);
+        pois.label_chars.resize(header[1]);
+        file.read(reinterpret_cast<char *>(pois.latitudes.data()), header[0] * sizeof(float));
+        file.read(reinterpret_cast<char *>(pois.longitudes.data()), header[0] * sizeof(float));
+        file.read(reinterpret_cast<char *>(pois.priorities.data()), header[0] * sizeof(float));
+        file.read(reinterpret_cast<char *>(pois.icons.data()), header[0] * sizeof(int8_t));
+        file.read(reinterpret_cast<char *>(pois.label_offsets.data()), (header[0] + 1) * sizeof(uint64_t));
+        file.read(&pois.label_chars[0], header[1]);
+
+        if (!file.good() || pois.label_offsets.front() != 0 || pois.label_offsets.back() != header[1] ||
+            !std::is_sorted(pois.label_offsets.begin(), pois.label_offsets.end()))
+        {
+            pois = PoiStore();
+            return false;
+        }
+        return true;
+    }
 
-        Math::Mat4x4 translation_matrix(std::array<float, 16>({1.0, 0.0, 0.0, 0.0,
-                                                               0.0, 1.0, 0.0, 0.0,
-                                                               0.0, 0.0, 1.0, 0.0,
-                                                               -camera_position[0], -camera_position[1], -camera_position[2], 1.0}));
+    /**
+     * Read a binary POI file, or parse a text POI file if the file doesn't start with the binary magic number.
+     */
+    bool parsePoiFile(const std::string &poi_path, PoiStore &pois, uint num_threads = 0)
+    {
+        std::ifstream file(poi_path.c_str(), std::ios::in | std::ios::binary);
+        char magic[sizeof(POI_MAGIC)] = {};
+        file.read(magic, sizeof(magic));
+        if (file.good() && std::memcmp(magic, POI_MAGIC, sizeof(magic)) == 0)
+            return parseBinPoiFile(poi_path, pois);
 
-        view_matrix = rotation_matrix * translation_matrix;
+        return parseTxtPoiFile(poi_path, pois, num_threads);
     }
+}
 
-    GeoBoundingBox computeVisibleArea()
+/**
+ * Optional load stage, which stores nodes along a space-filling curve over their geo coordinates, so that nodes
+ * close on the map are close in memory. Benefits vertex fetches of edges as well as CPU traversals of the graph.
+ */
+namespace SpatialOrder
+{
+    enum Curve
     {
-        GeoBoundingBox bbox;
+        NONE,
+        HILBERT,
+        MORTON
+    };
 
-        // computer euklid. position of camera
-        float lat_sin = sin((PI / 180.0f) * latitude);
-        float lon_sin = sin((PI / 180.0f) * longitude);
+    /**
+     * Sort nodes along a space-filling curve over their bounding box, remap the edge endpoints accordingly
+     * and sort edges by source and target node.
+     * \return The previous index of each node, i.e. the node ID used in the graph file
+     */
+    std::vector<uint> reorderNodes(GraphStore &graph, Curve curve, uint num_threads = 0)
+    {
+        std::vector<uint> permutation(graph.nodeCount());
+        for (size_t i = 0; i < permutation.size(); i++)
+            permutation[i] = (uint)i;
 
-        float lat_cos = cos((PI / 180.0f) * latitude);
-        float lon_cos = cos((PI / 180.0f) * longitude);
+        if (curve == NONE || permutation.empty())
+            return permutation;
 
-        float r = orbit;
+        auto lat_range = std::minmax_element(graph.latitudes.begin(), graph.latitudes.end());
+        auto lon_range = std::minmax_element(graph.longitudes.begin(), graph.longitudes.end());
+        float min_lat = *lat_range.first;
+        float min_lon = *lon_range.first;
 
-        Math::Vec3 world_position(lon_sin * lat_cos * r,
-                                  lat_sin * r,
-                                  lat_cos * lon_cos * r);
+        // Both axes are scaled to the full grid, the curve only needs to preserve locality
+        float scale_lat = 65535.0f / std::max(*lat_range.second - min_lat, 1e-6f);
+        float scale_lon = 65535.0f / std::max(*lon_range.second - min_lon, 1e-6f);
 
-        // Build camera vector space
-        Math::Vec3 front_vec = normalize(-1.0 * world_position);
-        Math::Vec3 right_vec = normalize(cross(front_vec, Math::Vec3(0.0f, 1.0f, 0.0f)));
-        Math::Vec3 up_vec = normalize(cross(right_vec, front_vec));
+        std::vector<std::pair<uint32_t, uint>> keys(permutation.size());
+        auto keyRange = [&graph, &keys, curve, min_lat, min_lon, scale_lat, scale_lon](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                uint16_t x = (uint16_t)std::min(65535.0f, (graph.longitudes[i] - min_lon) * scale_lon);
+                uint16_t y = (uint16_t)std::min(65535.0f, (graph.latitudes[i] - min_lat) * scale_lat);
+                uint32_t code = (curve == HILBERT) ? Math::hilbertCode(x, y) : Math::mortonCode(x, y);
+                keys[i] = std::make_pair(code, (uint)i);
+            }
+        };
+        parallelFor(keys.size(), keyRange, num_threads);
 
-        // generate rays from the camera position along the right and upper frustrum plane
-        Math::Vec3 upper_ray = normalize(front_vec + (std::tan(fovy * 0.5f) * up_vec));
-        Math::Vec3 right_ray = normalize(front_vec + (std::tan(fovy * 0.5f) * aspect_ratio * right_vec));
+        // Ties are broken by the previous index, which keeps the result deterministic
+        parallelSort(keys.begin(), keys.end(), std::less<std::pair<uint32_t, uint>>(), num_threads);
 
-        // intersect with unit sphere
+        for (size_t i = 0; i < keys.size(); i++)
+            permutation[i] = keys[i].second;
+        graph.permuteNodes(permutation);
 
-        Math::Vec3 upper_intersection;
-        float a = dot(upper_ray, upper_ray);
-        float b = 2.0f * dot(upper_ray, world_position);
-        float c = dot(world_position, world_position) - 1.0f * 1.0f;
-        float discr = b * b - 4.0f * a * c;
-        if (discr < 0.0f)
-        {
-            // no intersection, use tangent point from camera to sphere in up direction
-            upper_intersection = up_vec;
-        }
-        else
-        {
-            float lambda = (-b - sqrt(discr)) / (2.0f * a);
-            upper_intersection = world_position + (lambda * upper_ray);
-        }
-
-        Math::Vec3 right_intersection;
-        a = dot(right_ray, right_ray);
-        b = 2.0f * dot(right_ray, world_position);
-        c = dot(world_position, world_position) - 1.0f * 1.0f;
-        discr = b * b - 4.0f * a * c;
-        if (discr < 0.0f)
-        {
-            // no intersection, use tangent point from camera to sphere in right direction
-            right_intersection = right_vec;
-        }
-        else
-        {
-            float lambda = (-b - sqrt(discr)) / (2.0f * a);
-            right_intersection = world_position + (lambda * right_ray);
-        }
-
-        // using dot product suffers from nasty precision problems...
-        // compute angle between Vec(SphereCenter,Camera) and Vec(SphereCenter,RightIntersection)
-        // double longitude_angle = acos(dot64(normalize(world_position), normalize(right_intersection)));
-
-        // compute angle between Vec(SphereCenter,Camera) and Vec(SphereCenter,UpperIntersection)
-        // double latitude_angle = acos(dot64(normalize(world_position), normalize(upper_intersection)));
-
-        // convert from euklidean to geo coordinates
-        float upper_intersection_lat = (180.0f * std::asin(upper_intersection.y)) / PI;
+        std::vector<uint> edge_order(graph.edgeCount());
+        for (size_t i = 0; i < edge_order.size(); i++)
+            edge_order[i] = (uint)i;
 
-        float right_intersection_lat_cos = std::cos(std::asin(right_intersection.y));
-        float right_intersection_lon = (180.0f * std::asin(right_intersection.x / right_intersection_lat_cos)) / PI;
+        const std::vector<uint32_t> &sources = graph.sources;
+        const std::vector<uint32_t> &targets = graph.targets;
+        parallelSort(edge_order.begin(), edge_order.end(), [&sources, &targets](uint u, uint v) {
+            if (sources[u] != sources[v])
+                return sources[u] < sources[v];
+            return (targets[u] != targets[v]) ? (targets[u] < targets[v]) : (u < v);
+        }, num_threads);
+        graph.permuteEdges(edge_order);
 
-        if (dot(right_intersection, Math::Vec3(0.0, 0.0, -1.0)) > 0.0)
-        {
-            if (dot(right_intersection, Math::Vec3(1.0, 0.0, 0.0)) > 0.0)
-                right_intersection_lon = 180.0f - right_intersection_lon;
-            else
-                right_intersection_lon = -180.0f - right_intersection_lon;
-        }
+        return permutation;
+    }
+}
 
-        bbox.min_longitude = longitude - std::abs(right_intersection_lon - longitude);
-        bbox.min_longitude = (bbox.min_longitude < -180.0f) ? 360.0f + bbox.min_longitude : bbox.min_longitude;
+/**
+ * Contraction hierarchy for shortest path queries on a GraphStore, weighted by the geodesic length of the edges.
+ * Edges are treated as undirected, just like they are drawn. Nodes are contracted in rounds: each round selects
+ * the independent set of nodes with a lower priority than all of their neighbours and contracts these in parallel.
+ * Contracting a node removes it from the remaining graph and connects each pair of its neighbours by a shortcut,
+ * unless a witness search finds a path between them that avoids the node and is not longer than the shortcut.
+ * Each node keeps the arcs to the neighbours it had left when it was contracted, i.e. the arcs upwards in the
+ * hierarchy. Contraction stops once the remaining nodes are densely connected. These core nodes keep the arcs
+ * among each other in both directions. A query searches upwards from both ends and through the core, the
+ * shortest path meets in its highest node or within the core.
+ */
+struct ContractionHierarchy
+{
+    /* Arc to a higher node. Shortcuts skip a lower middle node, all other arcs stand for an edge of the GraphStore */
+    struct Arc
+    {
+        uint32_t target;
+        float weight;
+        uint32_t middle;
+        uint32_t edge;
+    };
 
-        bbox.max_longitude = right_intersection_lon;
+    static constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
 
-        bbox.min_latitude = latitude - std::abs(upper_intersection_lat - latitude);
-        bbox.max_latitude = upper_intersection_lat;
+    /* Upward arcs of node n are [offsets[n], offsets[n + 1]) */
+    std::vector<uint32_t> offsets;
+    std::vector<Arc> arcs;
 
-        return bbox;
+    size_t nodeCount() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
     }
-};
 
-struct IcoSphere
-{
-    IcoSphere(){
-        // TODO
-    };
-
-    IcoSphere(uint subdivision)
+    /**
+     * Contract the nodes of the graph.
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+     * \return Number of core nodes left uncontracted
+     */
+    size_t build(const GraphStore &graph, uint num_threads = 0)
     {
-        GLfloat x = 0.525731112119133606f;
-        GLfloat z = 0.850650808352039932f;
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
 
-        std::vector<Vertex_XYZ> sphere_vertices({Vertex_XYZ(-x, 0.0f, z),
-                                                 Vertex_XYZ(x, 0.0f, z),
-                                                 Vertex_XYZ(-x, 0.0f, -z),
-                                                 Vertex_XYZ(x, 0.0f, -z),
-                                                 Vertex_XYZ(0.0f, z, x),
-                                                 Vertex_XYZ(0.0f, z, -x),
-                                                 Vertex_XYZ(0.0f, -z, x),
-                                                 Vertex_XYZ(0.0f, -z, -x),
-                                                 Vertex_XYZ(z, x, 0.0f),
-                                                 Vertex_XYZ(-z, x, 0.0f),
-                                                 Vertex_XYZ(z, -x, 0.0f),
-                                                 Vertex_XYZ(-z, -x, 0.0f)});
-        std::vector<unsigned int> sphere_indices({0, 4, 1, 0, 9, 4, 9, 5, 4, 4, 5, 8, 4, 8, 1,
-                                                  8, 10, 1, 8, 3, 10, 5, 3, 8, 5, 2, 3, 2, 7, 3,
-                                                  7, 10, 3, 7, 6, 10, 7, 11, 6, 11, 0, 6, 0, 1, 6,
-                                                  6, 1, 10, 9, 0, 11, 9, 11, 2, 9, 2, 5, 7, 2, 11});
+        size_t node_cnt = graph.nodeCount();
 
-        // Subdivide icosahedron
-        for (uint subdivs = 0; subdivs < subdivision; subdivs++)
-        {
-            std::vector<unsigned int> refined_indices;
-            refined_indices.reserve(sphere_indices.size() * 3);
+        GraphAdjacency forward;
+        GraphAdjacency reverse;
+        forward.build(graph, GraphAdjacency::FORWARD, num_threads);
+        reverse.build(graph, GraphAdjacency::REVERSE, num_threads);
 
-            for (int i = 0; i < (int)sphere_indices.size(); i = i + 3)
+        // Both directions of each edge, parallel edges are merged into the shortest one and loops are dropped
+        std::vector<std::vector<Arc>> remaining(node_cnt);
+        auto initRange = [&graph, &forward, &reverse, &remaining](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
             {
-                unsigned int idx1 = sphere_indices[i];
-                unsigned int idx2 = sphere_indices[i + 1];
-                unsigned int idx3 = sphere_indices[i + 2];
+                for (const GraphAdjacency *adjacency : {&forward, &reverse})
+                {
+                    for (uint32_t i = adjacency->offsets[n]; i < adjacency->offsets[n + 1]; i++)
+                    {
+                        uint32_t neighbour = adjacency->neighbours[i];
+                        if (neighbour == n)
+                            continue;
+
+                        float weight = (float)Math::haversine(graph.latitudes[n], graph.longitudes[n],
+                                                              graph.latitudes[neighbour], graph.longitudes[neighbour]);
+                        addArc(remaining[n], Arc{neighbour, weight, NO_ID, adjacency->edge_ids[i]});
+                    }
+                }
+            }
+        };
+        parallelFor(node_cnt, initRange, num_threads);
 
-                Math::Vec3 newVtx1((sphere_vertices[idx1].x + sphere_vertices[idx2].x),
-                                   (sphere_vertices[idx1].y + sphere_vertices[idx2].y),
-                                   (sphere_vertices[idx1].z + sphere_vertices[idx2].z));
-                newVtx1 = Math::normalize(newVtx1);
+        std::vector<uint8_t> state(node_cnt, REMAINING);
+        std::vector<uint32_t> contracted_neighbours(node_cnt, 0);
+        std::vector<int> priorities(node_cnt, 0);
 
-                Math::Vec3 newVtx2((sphere_vertices[idx2].x + sphere_vertices[idx3].x),
-                                   (sphere_vertices[idx2].y + sphere_vertices[idx3].y),
-                                   (sphere_vertices[idx2].z + sphere_vertices[idx3].z));
-                newVtx2 = Math::normalize(newVtx2);
+        std::vector<uint32_t> remaining_nodes(node_cnt);
+        for (size_t n = 0; n < node_cnt; n++)
+            remaining_nodes[n] = (uint32_t)n;
 
-                Math::Vec3 newVtx3((sphere_vertices[idx3].x + sphere_vertices[idx1].x),
-                                   (sphere_vertices[idx3].y + sphere_vertices[idx1].y),
-                                   (sphere_vertices[idx3].z + sphere_vertices[idx1].z));
-                newVtx3 = Math::normalize(newVtx3);
+        auto priorityRange = [&remaining, &state, &contracted_neighbours, &priorities](const std::vector<uint32_t> &nodes, size_t begin, size_t end) {
+            WitnessSearch search(remaining.size());
+            std::vector<std::pair<uint32_t, Arc>> shortcuts;
+            for (size_t i = begin; i < end; i++)
+            {
+                uint32_t node = nodes[i];
+                shortcuts.clear();
+                findShortcuts(remaining, state, node, search, SIMULATION_SETTLE_LIMIT, shortcuts);
+                priorities[node] = 2 * (int)shortcuts.size() - (int)remaining[node].size() + (int)contracted_neighbours[node];
+            }
+        };
+        auto initialPriorityRange = [&priorityRange, &remaining_nodes](size_t begin, size_t end) {
+            priorityRange(remaining_nodes, begin, end);
+        };
+        parallelFor(remaining_nodes.size(), initialPriorityRange, num_threads);
 
-                unsigned int newIdx1 = sphere_vertices.size();
-                sphere_vertices.push_back(Vertex_XYZ(newVtx1.x, newVtx1.y, newVtx1.z));
+        while (!remaining_nodes.empty())
+        {
+            // Nodes ordered before all of their neighbours form an independent set
+            std::vector<uint8_t> is_selected(remaining_nodes.size(), 0);
+            auto selectRange = [&remaining, &remaining_nodes, &priorities, &is_selected](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    uint32_t node = remaining_nodes[i];
+                    is_selected[i] = 1;
+                    for (const Arc &arc : remaining[node])
+                    {
+                        if (isContractedBefore(arc.target, node, priorities))
+                        {
+                            is_selected[i] = 0;
+                            break;
+                        }
+                    }
+                }
+            };
+            parallelFor(remaining_nodes.size(), selectRange, num_threads);
+
+            std::vector<uint32_t> selected;
+            for (size_t i = 0; i < remaining_nodes.size(); i++)
+                if (is_selected[i])
+                    selected.push_back(remaining_nodes[i]);
+            for (uint32_t node : selected)
+                state[node] = SELECTED;
+
+            // Witness searches skip the selected nodes, which are replaced by their shortcuts in the same round
+            std::vector<std::vector<std::pair<uint32_t, Arc>>> node_shortcuts(selected.size());
+            auto contractRange = [&remaining, &state, &selected, &node_shortcuts](size_t begin, size_t end) {
+                WitnessSearch search(remaining.size());
+                for (size_t i = begin; i < end; i++)
+                    findShortcuts(remaining, state, selected[i], search, CONTRACTION_SETTLE_LIMIT, node_shortcuts[i]);
+            };
+            parallelFor(selected.size(), contractRange, num_threads);
+
+            // Shortcuts are inserted at both of their ends
+            std::vector<std::pair<uint32_t, Arc>> insertions;
+            for (const auto &shortcuts : node_shortcuts)
+            {
+                for (const auto &shortcut : shortcuts)
+                {
+                    insertions.push_back(shortcut);
+                    insertions.push_back(std::make_pair(shortcut.second.target,
+                                                        Arc{shortcut.first, shortcut.second.weight, shortcut.second.middle, NO_ID}));
+                }
+            }
+            parallelSort(insertions.begin(), insertions.end(), [](const std::pair<uint32_t, Arc> &u, const std::pair<uint32_t, Arc> &v) {
+                if (u.first != v.first)
+                    return u.first < v.first;
+                if (u.second.target != v.second.target)
+                    return u.second.target < v.second.target;
+                return (u.second.weight != v.second.weight) ? (u.second.weight < v.second.weight) : (u.second.middle < v.second.middle);
+            }, num_threads);
+
+            // Arcs of the contracted nodes stay as they are, i.e. pointing upwards
+            for (uint32_t node : selected)
+                state[node] = CONTRACTED;
+
+            std::vector<uint8_t> is_changed(remaining_nodes.size(), 0);
+            auto updateRange = [&remaining, &remaining_nodes, &state, &contracted_neighbours, &insertions, &is_changed](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    uint32_t node = remaining_nodes[i];
+                    if (state[node] != REMAINING)
+                        continue;
+
+                    std::vector<Arc> &node_arcs = remaining[node];
+                    size_t degree = node_arcs.size();
+                    node_arcs.erase(std::remove_if(node_arcs.begin(), node_arcs.end(), [&state](const Arc &arc) {
+                                        return state[arc.target] == CONTRACTED;
+                                    }),
+                                    node_arcs.end());
+                    contracted_neighbours[node] += (uint32_t)(degree - node_arcs.size());
+                    is_changed[i] = (degree != node_arcs.size());
+
+                    auto first = std::lower_bound(insertions.begin(), insertions.end(), node, [](const std::pair<uint32_t, Arc> &insertion, uint32_t n) {
+                        return insertion.first < n;
+                    });
+                    for (auto itr = first; itr != insertions.end() && itr->first == node; itr++)
+                        addArc(node_arcs, itr->second);
+                }
+            };
+            parallelFor(remaining_nodes.size(), updateRange, num_threads);
 
-                unsigned int newIdx2 = newIdx1 + 1;
-                sphere_vertices.push_back(Vertex_XYZ(newVtx2.x, newVtx2.y, newVtx2.z));
+            std::vector<uint32_t> changed_nodes;
+            size_t kept = 0;
+            for (size_t i = 0; i < remaining_nodes.size(); i++)
+            {
+                if (state[remaining_nodes[i]] != REMAINING)
+                    continue;
+                if (is_changed[i])
+                    changed_nodes.push_back(remaining_nodes[i]);
+                remaining_nodes[kept++] = remaining_nodes[i];
+            }
+            remaining_nodes.resize(kept);
+
+            // Contracting a dense core would add far more shortcuts than it saves, the core is searched as it is
+            size_t core_arc_cnt = 0;
+            for (uint32_t node : remaining_nodes)
+                core_arc_cnt += remaining[node].size();
+            if (core_arc_cnt > MAX_CORE_DEGREE * remaining_nodes.size())
+                break;
+
+            auto updatePriorityRange = [&priorityRange, &changed_nodes](size_t begin, size_t end) {
+                priorityRange(changed_nodes, begin, end);
+            };
+            parallelFor(changed_nodes.size(), updatePriorityRange, num_threads);
+        }
 
-                unsigned int newIdx3 = newIdx2 + 1;
-                sphere_vertices.push_back(Vertex_XYZ(newVtx3.x, newVtx3.y, newVtx3.z));
+        offsets.assign(node_cnt + 1, 0);
+        for (size_t n = 0; n < node_cnt; n++)
+            offsets[n + 1] = offsets[n] + (uint32_t)remaining[n].size();
 
-                refined_indices.push_back(idx1);
-                refined_indices.push_back(newIdx1);
-                refined_indices.push_back(newIdx3);
+        arcs.resize(offsets[node_cnt]);
+        auto copyRange = [this, &remaining](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
+                std::copy(remaining[n].begin(), remaining[n].end(), arcs.begin() + offsets[n]);
+        };
+        parallelFor(node_cnt, copyRange, num_threads);
 
-                refined_indices.push_back(newIdx1);
-                refined_indices.push_back(idx2);
-                refined_indices.push_back(newIdx2);
+        return remaining_nodes.size();
+    }
 
-                refined_indices.push_back(newIdx3);
-                refined_indices.push_back(newIdx1);
-                refined_indices.push_back(newIdx2);
+    /**
+     * Shortest path query, runs Dijkstra's algorithm along the upward arcs from both nodes.
+     * \param edges Set to the GraphStore indices of the edges of the shortest path, in no particular order
+     * \return Length of the shortest path in meters, infinity if the nodes aren't connected or a shortcut on the path
+     *         can't be unpacked
+     */
+    float query(uint32_t source, uint32_t target, std::vector<uint32_t> &edges)
+    {
+        edges.clear();
 
-                refined_indices.push_back(newIdx3);
-                refined_indices.push_back(newIdx2);
-                refined_indices.push_back(idx3);
+        for (int side = 0; side < 2; side++)
+        {
+            if (distances[side].size() != nodeCount())
+            {
+                distances[side].assign(nodeCount(), std::numeric_limits<float>::infinity());
+                parent_arcs[side].assign(nodeCount(), NO_ID);
+                reached[side].clear();
             }
-
-            sphere_indices.clear();
-
-            sphere_indices = refined_indices;
+            for (uint32_t node : reached[side])
+            {
+                distances[side][node] = std::numeric_limits<float>::infinity();
+                parent_arcs[side][node] = NO_ID;
+            }
+            reached[side].clear();
+            queues[side].clear();
         }
 
-        index_cnt = sphere_indices.size();
+        distances[0][source] = 0.0f;
+        distances[1][target] = 0.0f;
+        reached[0].push_back(source);
+        reached[1].push_back(target);
+        queues[0].push_back(std::make_pair(0.0f, source));
+        queues[1].push_back(std::make_pair(0.0f, target));
 
-        auto va_size = sizeof(Vertex_XYZ) * sphere_vertices.size();
-        auto vi_size = sizeof(uint) * sphere_indices.size();
+        float shortest = std::numeric_limits<float>::infinity();
+        uint32_t meeting_node = NO_ID;
 
-        glGenVertexArrays(1, &va_handle);
-        glGenBuffers(1, &vbo_handle);
-        glGenBuffers(1, &ibo_handle);
+        std::greater<std::pair<float, uint32_t>> later;
+        while (!queues[0].empty() || !queues[1].empty())
+        {
+            for (int side = 0; side < 2; side++)
+            {
+                std::vector<std::pair<float, uint32_t>> &queue = queues[side];
+                if (queue.empty())
+                    continue;
 
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, va_size, sphere_vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, sphere_indices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+                // No path through nodes further away than the shortest one found so far can be shorter
+                if (queue.front().first >= shortest)
+                {
+                    queue.clear();
+                    continue;
+                }
 
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex_XYZ), 0);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    };
-    ~IcoSphere()
-    {
-        // delete mesh resources
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glDeleteBuffers(1, &ibo_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDeleteBuffers(1, &vbo_handle);
-        glBindVertexArray(0);
-        glDeleteVertexArrays(1, &va_handle);
-    }
+                std::pop_heap(queue.begin(), queue.end(), later);
+                float distance = queue.back().first;
+                uint32_t node = queue.back().second;
+                queue.pop_back();
 
-    GLuint va_handle;
-    GLuint vbo_handle;
-    GLuint ibo_handle;
+                if (distance > distances[side][node])
+                    continue;
 
-    uint index_cnt;
+                if (distance + distances[1 - side][node] < shortest)
+                {
+                    shortest = distance + distances[1 - side][node];
+                    meeting_node = node;
+                }
 
-    void draw(uint instance_cnt)
-    {
-        glBindVertexArray(va_handle);
-        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)index_cnt, GL_UNSIGNED_INT, nullptr, instance_cnt);
-    }
-};
+                for (uint32_t a = offsets[node]; a < offsets[node + 1]; a++)
+                {
+                    const Arc &arc = arcs[a];
+                    if (distance + arc.weight < distances[side][arc.target])
+                    {
+                        if (distances[side][arc.target] == std::numeric_limits<float>::infinity())
+                            reached[side].push_back(arc.target);
+                        distances[side][arc.target] = distance + arc.weight;
+                        parent_arcs[side][arc.target] = a;
+                        queue.push_back(std::make_pair(distance + arc.weight, arc.target));
+                        std::push_heap(queue.begin(), queue.end(), later);
+                    }
+                }
+            }
+        }
 
-/**
- * This struct essentially holds a renderable representation of a subgraph as a mesh, which is made up from
- * a set of vertices and a set of indices (the latter describing the mesh connectivity).
- * In this case the mesh uses line primitives, i.e. two succesive indices describe a single line segment.
- *
- * From a programming point of view, it makes sense to keep the three OpenGL handles required for a mesh obejct
- * organised together in a struct as most high level operations like "send the mesh data to the GPU" require
- * several OpenGL function calls and all of these handles.
- */
-struct Subgraph
-{
-    Subgraph() : va_handle(0), vbo_handle(0), ibo_handle(0), isVisible(true), index_offsets(), line_widths() {}
-    Subgraph(const Subgraph &) = delete;
-    ~Subgraph()
-    {
-        if (va_handle != 0)
+        if (meeting_node == NO_ID)
+            return shortest;
+
+        // Walk down from the meeting node to both ends and expand the shortcuts on the way
+        std::vector<uint32_t> stack;
+        for (int side = 0; side < 2; side++)
         {
-            // delete mesh resources
-            glBindVertexArray(va_handle);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &ibo_handle);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &vbo_handle);
-            glBindVertexArray(0);
-            glDeleteVertexArrays(1, &va_handle);
+            for (uint32_t node = meeting_node; parent_arcs[side][node] != NO_ID;)
+            {
+                uint32_t a = parent_arcs[side][node];
+                stack.push_back(a);
+                node = (uint32_t)(std::upper_bound(offsets.begin(), offsets.end(), a) - offsets.begin()) - 1;
+            }
         }
-    }
 
-    /* Handle for the vertex array object */
-    GLuint va_handle;
+        while (!stack.empty())
+        {
+            const Arc &arc = arcs[stack.back()];
+            stack.pop_back();
 
-    /* Handle for the vertex buffer object (allows access to vertex data in GPU memory) */
-    GLuint vbo_handle;
+            if (arc.middle == NO_ID)
+            {
+                edges.push_back(arc.edge);
+                continue;
+            }
 
-    /* Handle for the index buffer objects (allows access to index data in GPU memory) */
-    GLuint ibo_handle;
+            uint32_t lower = (uint32_t)(std::upper_bound(offsets.begin(), offsets.end(), (uint32_t)(&arc - arcs.data())) - offsets.begin()) - 1;
+            uint32_t to_lower = findArc(arc.middle, lower);
+            uint32_t to_target = findArc(arc.middle, arc.target);
+            if (to_lower == NO_ID || to_target == NO_ID)
+            {
+                edges.clear();
+                return std::numeric_limits<float>::infinity();
+            }
+            stack.push_back(to_lower);
+            stack.push_back(to_target);
+        }
 
-    bool isVisible;
+        return shortest;
+    }
 
-    /* To draw lines of different type, i.e of different width seperatly but still store them
-     * in the same index buffer object, offsets into the buffer are used to only draw a subset of the index buffer
-     * in each draw call.
+    /**
+     * Write the hierarchy to a binary cache file.
+     * \param graph Graph the hierarchy was built for, recognized again by load
      */
-    std::vector<uint> index_offsets;
-    /* Stores the width of each subset of lines */
-    std::vector<float> line_widths;
+    bool save(const std::string &path, const GraphStore &graph) const
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.good())
+            return false;
+
+        uint64_t header[3] = {fingerprint(graph), offsets.size(), arcs.size()};
+        file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint32_t));
+        file.write(reinterpret_cast<const char *>(arcs.data()), arcs.size() * sizeof(Arc));
 
-    void loadGraphData(std::vector<Node> &nodes, std::vector<Edge> &edges)
+        return file.good();
+    }
+
+    /**
+     * Read the hierarchy from a binary cache file.
+     * \return False if the file doesn't exist, is broken or has been built for a different graph
+     */
+    bool load(const std::string &path, const GraphStore &graph)
     {
-        index_offsets.clear();
-        line_widths.clear();
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.good())
+            return false;
 
-        std::vector<Vertex> vertices;
-        std::vector<uint> indices;
+        file.seekg(0, std::ios::end);
+        uint64_t file_size = (uint64_t)file.tellg();
+        file.seekg(0, std::ios::beg);
 
-        // At least as many vertices as there are nodes are required
-        vertices.reserve(nodes.size());
+        char magic[sizeof(CACHE_MAGIC)];
+        uint64_t header[3];
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (!file.good() || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+            header[0] != fingerprint(graph) || header[1] != graph.nodeCount() + 1)
+            return false;
 
-        // Each edge contributes two indices
-        indices.reserve(edges.size() * 2);
+        // The arc count is checked against the size of the file before anything is allocated
+        uint64_t offsets_end = sizeof(CACHE_MAGIC) + sizeof(header) + header[1] * sizeof(uint32_t);
+        if (file_size < offsets_end || header[2] != (file_size - offsets_end) / sizeof(Arc) ||
+            (file_size - offsets_end) % sizeof(Arc) != 0 || header[2] > std::numeric_limits<uint32_t>::max())
+            return false;
 
-        // Copy geo coordinates from input nodes to vertices
-        for (auto &node : nodes)
+        offsets.resize(header[1]);
+        arcs.resize(header[2]);
+        file.read(reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(uint32_t));
+        file.read(reinterpret_cast<char *>(arcs.data()), arcs.size() * sizeof(Arc));
+
+        bool valid = file.good() && offsets.front() == 0 && offsets.back() == arcs.size() &&
+                     std::is_sorted(offsets.begin(), offsets.end());
+        for (size_t a = 0; valid && a < arcs.size(); a++)
         {
-            vertices.push_back(Vertex((float)node.lon, (float)node.lat));
+            const Arc &arc = arcs[a];
+            valid = arc.target < graph.nodeCount() && (arc.middle == NO_ID ? arc.edge < graph.edgeCount() : arc.middle < graph.nodeCount());
         }
 
-        std::sort(edges.begin(), edges.end(), [](Edge u, Edge v) {
-            return u.width < v.width;
-        });
-
-        // Copy indices from edge array to index array
-        std::vector<bool> has_next(nodes.size(), false);
-        std::vector<uint> next(nodes.size(), 0);
-        uint width = 0;
-        uint counter = 0;
-        for (auto &edge : edges)
+        // Both halves of every shortcut have to exist, or queries couldn't unpack it
+        for (uint32_t node = 0; valid && node + 1 < offsets.size(); node++)
         {
-            uint src_id = edge.source;
-            uint tgt_id = edge.target;
-
-            while (has_next[src_id] && (vertices[src_id].color != edge.color))
+            for (uint32_t a = offsets[node]; valid && a < offsets[node + 1]; a++)
             {
-                src_id = next[src_id];
+                const Arc &arc = arcs[a];
+                valid = arc.middle == NO_ID || (findArc(arc.middle, node) != NO_ID && findArc(arc.middle, arc.target) != NO_ID);
             }
+        }
 
-            if (vertices[src_id].color == -1)
-            {
-                vertices[src_id].color = (float)edge.color;
-            }
+        if (!valid)
+        {
+            offsets.clear();
+            arcs.clear();
+            return false;
+        }
+        return true;
+    }
 
-            if (vertices[src_id].color != edge.color)
-            {
-                uint next_id = (uint)vertices.size();
-                vertices.push_back(Vertex(vertices[src_id].longitude, vertices[src_id].latitude));
-                vertices[next_id].color = (float)edge.color;
-                has_next.push_back(false);
-                next.push_back(0);
+private:
+    enum NodeState : uint8_t
+    {
+        REMAINING,
+        SELECTED,
+        CONTRACTED
+    };
 
-                next[src_id] = next_id;
-                has_next[src_id] = true;
-                src_id = next_id;
-            }
+    /* Witness searches give up after settling this many nodes, which at worst adds unnecessary shortcuts.
+     * Estimating the priorities takes most of the time, so that search is kept very short. */
+    static constexpr uint SIMULATION_SETTLE_LIMIT = 5;
+    static constexpr uint CONTRACTION_SETTLE_LIMIT = 500;
 
-            while (has_next[tgt_id] && (vertices[tgt_id].color != edge.color))
-            {
-                tgt_id = next[tgt_id];
-            }
+    /* Mean degree of the remaining nodes at which contraction stops */
+    static constexpr uint MAX_CORE_DEGREE = 24;
 
-            if (vertices[tgt_id].color == -1)
-            {
-                vertices[tgt_id].color = (float)edge.color;
-            }
+    static constexpr char CACHE_MAGIC[8] = {'S', 'G', 'R', 'C', 'H', '0', '0', '1'};
 
-            if (vertices[tgt_id].color != edge.color)
-            {
-                uint next_id = (uint)vertices.size();
-                vertices.push_back(Vertex(vertices[tgt_id].longitude, vertices[tgt_id].latitude));
-                vertices[next_id].color = (float)edge.color;
-                has_next.push_back(false);
-                next.push_back(0);
+    /**
+     * Dijkstra search on the remaining graph, limited in distance and number of settled nodes.
+     * Stops as soon as all nodes marked as target are settled.
+     */
+    struct WitnessSearch
+    {
+        WitnessSearch(size_t node_cnt) : distances(node_cnt, std::numeric_limits<float>::infinity()), is_target(node_cnt, 0) {}
 
-                next[tgt_id] = next_id;
-                has_next[tgt_id] = true;
-                tgt_id = next_id;
-            }
+        std::vector<float> distances;
+        std::vector<uint8_t> is_target;
+        std::vector<uint32_t> reached;
+        std::vector<std::pair<float, uint32_t>> queue;
 
-            // std::cout << "Edge color: " << edge.color << std::endl;
-            // std::cout << "Source color: " << vertices[src_id].color << std::endl;
-            // std::cout << "Target color: " << vertices[tgt_id].color << std::endl;
+        void run(const std::vector<std::vector<Arc>> &remaining, const std::vector<uint8_t> &state,
+                 uint32_t source, uint32_t avoid, size_t target_cnt, float max_distance, uint settle_limit)
+        {
+            for (uint32_t node : reached)
+                distances[node] = std::numeric_limits<float>::infinity();
+            reached.clear();
+            queue.clear();
 
-            if (width != edge.width)
+            std::greater<std::pair<float, uint32_t>> later;
+            distances[source] = 0.0f;
+            reached.push_back(source);
+            queue.push_back(std::make_pair(0.0f, source));
+
+            for (uint settled = 0; !queue.empty() && settled < settle_limit; settled++)
             {
-                index_offsets.push_back(counter);
-                line_widths.push_back((float)edge.width);
-                width = edge.width;
+                std::pop_heap(queue.begin(), queue.end(), later);
+                float distance = queue.back().first;
+                uint32_t node = queue.back().second;
+                queue.pop_back();
+
+                if (distance > distances[node])
+                    continue;
+                if (distance > max_distance)
+                    break;
+                if (is_target[node] && --target_cnt == 0)
+                    break;
+
+                for (const Arc &arc : remaining[node])
+                {
+                    if (arc.target == avoid || state[arc.target] != REMAINING)
+                        continue;
+
+                    if (distance + arc.weight < distances[arc.target])
+                    {
+                        if (distances[arc.target] == std::numeric_limits<float>::infinity())
+                            reached.push_back(arc.target);
+                        distances[arc.target] = distance + arc.weight;
+                        queue.push_back(std::make_pair(distance + arc.weight, arc.target));
+                        std::push_heap(queue.begin(), queue.end(), later);
+                    }
+                }
             }
-
-            indices.push_back(src_id);
-            indices.push_back(tgt_id);
-
-            counter += 2;
         }
-        index_offsets.push_back((uint)indices.size());
-
-        // Allocate GPU memory and send data
-        if (vertices.size() < 1 || indices.size() < 1)
-            return;
+    };
 
-        auto va_size = sizeof(Vertex) * vertices.size();
-        auto vi_size = sizeof(uint) * indices.size();
+    /* Query state of the search from the source (0) and from the target (1) */
+    std::array<std::vector<float>, 2> distances;
+    std::array<std::vector<uint32_t>, 2> parent_arcs;
+    std::array<std::vector<uint32_t>, 2> reached;
+    std::array<std::vector<std::pair<float, uint32_t>>, 2> queues;
 
-        if (va_handle == 0 || vbo_handle == 0 || ibo_handle == 0)
+    /**
+     * Add an arc, or shorten the existing arc to the same target.
+     */
+    static void addArc(std::vector<Arc> &node_arcs, const Arc &arc)
+    {
+        for (Arc &existing : node_arcs)
         {
-            glGenVertexArrays(1, &va_handle);
-            glGenBuffers(1, &vbo_handle);
-            glGenBuffers(1, &ibo_handle);
+            if (existing.target == arc.target)
+            {
+                if (arc.weight < existing.weight)
+                    existing = arc;
+                return;
+            }
         }
-
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, va_size, vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, indices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex), 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 1, GL_FLOAT, false, sizeof(Vertex), (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // std::cout << "GfxGraph consisting of " << vertices.size() << " vertices and " << indices.size() << " indices" << std::endl;
+        node_arcs.push_back(arc);
     }
 
-    void draw(float scale)
+    /**
+     * Collect the shortcuts required to contract a node, each as pair of one end and the arc to the other end.
+     */
+    static void findShortcuts(const std::vector<std::vector<Arc>> &remaining, const std::vector<uint8_t> &state, uint32_t node,
+                              WitnessSearch &search, uint settle_limit, std::vector<std::pair<uint32_t, Arc>> &shortcuts)
     {
-        // glBindVertexArray(va_handle);
-        // glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, 0);
+        const std::vector<Arc> &node_arcs = remaining[node];
+        for (size_t i = 0; i + 1 < node_arcs.size(); i++)
+        {
+            float max_weight = 0.0f;
+            for (size_t j = i + 1; j < node_arcs.size(); j++)
+            {
+                max_weight = std::max(max_weight, node_arcs[j].weight);
+                search.is_target[node_arcs[j].target] = 1;
+            }
 
-        glBindVertexArray(va_handle);
+            search.run(remaining, state, node_arcs[i].target, node, node_arcs.size() - i - 1, node_arcs[i].weight + max_weight, settle_limit);
 
-        for (size_t i = 0; i < index_offsets.size() - 1; i++)
-        {
-            glLineWidth(std::max(1.0f, line_widths[i] * scale));
-            // glLineWidth(line_widths[i]);
+            for (size_t j = i + 1; j < node_arcs.size(); j++)
+            {
+                search.is_target[node_arcs[j].target] = 0;
 
-            glDrawElements(GL_LINES, index_offsets[i + 1] - index_offsets[i], GL_UNSIGNED_INT, (void *)(index_offsets[i] * sizeof(GLuint)));
+                float weight = node_arcs[i].weight + node_arcs[j].weight;
+                if (search.distances[node_arcs[j].target] > weight)
+                    shortcuts.push_back(std::make_pair(node_arcs[i].target, Arc{node_arcs[j].target, weight, node, NO_ID}));
+            }
         }
     }
-};
 
-/**
- * A graph made up from subgraphs, that can be arranged on multiple layers. Limited to rendering edges.
- * This struct primarily holds a set of subgraphs and offers the neccessary functionality to add and change subgraphs.
- */
-struct Graph
-{
-    Graph()
-    {
-        prgm_handle = createShaderProgram("../src/edge_v.glsl", "../src/edge_f.glsl", {"v_geoCoords", "v_color"});
-    }
-    ~Graph()
+    /**
+     * Order of contraction, by priority and then by a hash of the node index that spreads ties over the graph.
+     */
+    static bool isContractedBefore(uint32_t u, uint32_t v, const std::vector<int> &priorities)
     {
-        // delete shader program
-        glDeleteProgram(prgm_handle);
+        if (priorities[u] != priorities[v])
+            return priorities[u] < priorities[v];
+        return (u * 2654435761u) < (v * 2654435761u);
     }
 
     /**
-     * Add a new subgraph. Defaults to layer 0.
-     * \param nodes Set of nodes of the new subgraph.
-     * \param edges Set of edges of the new subgraph.
+     * Index of the arc from one node to another, NO_ID if there is none.
      */
-    void addSubgraph(std::vector<Node> &nodes, std::vector<Edge> &edges)
+    uint32_t findArc(uint32_t from, uint32_t to) const
     {
-        std::unique_ptr<Subgraph> subgraph(new Subgraph);
-        subgraphs.push_back(std::move(subgraph));
+        for (uint32_t a = offsets[from]; a < offsets[from + 1]; a++)
+            if (arcs[a].target == to)
+                return a;
 
-        subgraphs.back()->loadGraphData(nodes, edges);
-
-        auto itr = layers.insert(std::pair<uint, std::list<uint>>(0, std::list<uint>()));
-        itr.first->second.push_back(subgraphs.size() - 1);
+        return NO_ID;
     }
 
     /**
-     * Add a new subgraph on a given layer. If the layer index doesn't exist, a new layer is created.
-     * \param nodes Set of nodes of the new subgraph.
-     * \param edges Set of edges of the new subgraph.
-     * \param layer Layer to place the new subgraph on. If layer doesn't exist yet, it is automatically created.
+     * FNV-1a hash over node positions and edges, which identifies the graph a cache file has been built for.
      */
-    void addSubgraph(std::vector<Node> &nodes, std::vector<Edge> &edges, uint layer)
+    static uint64_t fingerprint(const GraphStore &graph)
     {
-        std::unique_ptr<Subgraph> subgraph(new Subgraph);
-        subgraphs.push_back(std::move(subgraph));
+        uint64_t hash = 14695981039346656037ull;
+        auto combine = [&hash](const void *data, size_t size) {
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
 
-        subgraphs.back()->loadGraphData(nodes, edges);
+        uint64_t counts[2] = {graph.nodeCount(), graph.edgeCount()};
+        combine(counts, sizeof(counts));
+        combine(graph.latitudes.data(), graph.latitudes.size() * sizeof(float));
+        combine(graph.longitudes.data(), graph.longitudes.size() * sizeof(float));
+        combine(graph.sources.data(), graph.sources.size() * sizeof(uint32_t));
+        combine(graph.targets.data(), graph.targets.size() * sizeof(uint32_t));
 
-        auto itr = layers.insert(std::pair<uint, std::list<uint>>(layer, std::list<uint>()));
-        itr.first->second.push_back(subgraphs.size() - 1);
+        return hash;
     }
+};
 
-    /**
-     * Set visibily of a given subgraph.
-     * \param index Target subgraph index
-     * \param visibility If set to false, subgraph will not be rendered.
-     */
-    void setVisibilty(uint index, bool visibility)
-    {
-        if (index < subgraphs.size())
-            subgraphs[index]->isVisible = visibility;
-    }
+constexpr uint32_t ContractionHierarchy::NO_ID;
+constexpr uint ContractionHierarchy::SIMULATION_SETTLE_LIMIT;
+constexpr uint ContractionHierarchy::CONTRACTION_SETTLE_LIMIT;
+constexpr uint ContractionHierarchy::MAX_CORE_DEGREE;
+constexpr char ContractionHierarchy::CACHE_MAGIC[8];
 
+/**
+ * Single source shortest paths on a GraphStore by parallel delta-stepping, weighted by the geodesic length of the
+ * edges, which are treated as undirected. Nodes are kept in buckets of width delta by their tentative distance.
+ * The nodes of the first non-empty bucket are settled together: their light edges, not longer than delta, are relaxed
+ * in parallel until no node is left in the bucket, then the heavy edges of all nodes settled in the bucket are relaxed
+ * in parallel once. Tentative distances are lowered with atomic compare and swap. No tentative distance is more than
+ * the longest edge beyond the current bucket, so the buckets are reused cyclically and their number doesn't depend on
+ * the cutoff.
+ */
+struct DeltaStepping
+{
     /**
-     * Set layer of a given subgraph.
-     * \param index Target subgraph index
-     * \param layer Layer that the subgraph is assigned to.
+     * Build the adjacency and the edge weights. Delta is set to a multiple of the mean edge length.
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
      */
-    void setLayer(uint index, uint layer)
+    void build(const GraphStore &graph, uint num_threads = 0)
     {
-        // TODO find cleaner solution
-        for (auto &layer : layers)
-            for (auto itr = layer.second.begin(); itr != layer.second.end(); itr++)
-                if (*itr == index)
-                    layer.second.erase(itr);
+        forward.build(graph, GraphAdjacency::FORWARD, num_threads);
+        reverse.build(graph, GraphAdjacency::REVERSE, num_threads);
 
-        auto itr = layers.insert(std::pair<uint, std::list<uint>>(layer, std::list<uint>()));
-        itr.first->second.push_back(index);
+        std::vector<float> edge_weights(graph.edgeCount());
+        auto weightRange = [&graph, &edge_weights](size_t begin, size_t end) {
+            for (size_t e = begin; e < end; e++)
+            {
+                uint32_t s = graph.sources[e];
+                uint32_t t = graph.targets[e];
+                edge_weights[e] = (float)Math::haversine(graph.latitudes[s], graph.longitudes[s], graph.latitudes[t], graph.longitudes[t]);
+            }
+        };
+        parallelFor(graph.edgeCount(), weightRange, num_threads);
+
+        forward_weights.resize(forward.edge_ids.size());
+        reverse_weights.resize(reverse.edge_ids.size());
+        for (size_t i = 0; i < forward_weights.size(); i++)
+            forward_weights[i] = edge_weights[forward.edge_ids[i]];
+        for (size_t i = 0; i < reverse_weights.size(); i++)
+            reverse_weights[i] = edge_weights[reverse.edge_ids[i]];
+
+        double total_weight = 0.0;
+        max_weight = 0.0f;
+        for (float weight : edge_weights)
+        {
+            total_weight += weight;
+            max_weight = std::max(max_weight, weight);
+        }
+        delta = edge_weights.empty() ? 1.0f : std::max(1.0f, DELTA_FACTOR * (float)(total_weight / edge_weights.size()));
+
+        tentative = std::vector<std::atomic<uint32_t>>(graph.nodeCount());
+        for (auto &bits : tentative)
+            bits.store(INFINITE_BITS, std::memory_order_relaxed);
+        relaxed_at.assign(graph.nodeCount(), std::numeric_limits<float>::infinity());
+        reached.clear();
     }
 
     /**
-     * Draw all subgraphs, that are set to visible.
-     * The draw order depends on layers and -within each layer- on edge type.
-     * \param scale Additonal scale factor for edge widths.
+     * Compute the distances from the source node.
+     * \param cutoff Nodes further away than the cutoff in meters are left unreached
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
      */
-    void draw(OrbitalCamera &camera, float scale)
+    void run(uint32_t source, float cutoff, uint num_threads = 0)
     {
-        glUseProgram(prgm_handle);
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
 
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        for (uint32_t node : reached)
+        {
+            tentative[node].store(INFINITE_BITS, std::memory_order_relaxed);
+            relaxed_at[node] = std::numeric_limits<float>::infinity();
+        }
+        reached.clear();
 
-        for (auto &layer : layers)
+        if (source >= tentative.size())
+            return;
+
+        // Bucket b is kept at b modulo the number of buckets
+        std::vector<std::vector<uint32_t>> buckets((size_t)std::ceil(max_weight / delta) + 2);
+        size_t queued = 1;
+        tentative[source].store(toBits(0.0f), std::memory_order_relaxed);
+        reached.push_back(source);
+        buckets[0].push_back(source);
+
+        std::vector<uint32_t> frontier;
+        std::vector<uint32_t> settled;
+        std::vector<uint32_t> improved;
+        auto enqueue = [this, &buckets, &queued, &improved]() {
+            for (uint32_t node : improved)
+                buckets[(size_t)(distance(node) / delta) % buckets.size()].push_back(node);
+            queued += improved.size();
+        };
+        for (size_t b = 0; queued > 0; b++)
         {
-            for (auto &subgraph_idx : layer.second)
+            std::vector<uint32_t> &bucket = buckets[b % buckets.size()];
+            settled.clear();
+            while (!bucket.empty())
             {
-                if (subgraphs[subgraph_idx]->isVisible)
-                    subgraphs[subgraph_idx]->draw(scale);
+                // Skip nodes that moved on to a lower bucket or have already been relaxed at their current distance
+                frontier.clear();
+                for (uint32_t node : bucket)
+                {
+                    float node_distance = distance(node);
+                    if ((size_t)(node_distance / delta) == b && relaxed_at[node] != node_distance)
+                    {
+                        relaxed_at[node] = node_distance;
+                        frontier.push_back(node);
+                    }
+                }
+                queued -= bucket.size();
+                bucket.clear();
+
+                relax(frontier, true, cutoff, improved, num_threads);
+                enqueue();
+
+                settled.insert(settled.end(), frontier.begin(), frontier.end());
             }
+
+            relax(settled, false, cutoff, improved, num_threads);
+            enqueue();
         }
     }
 
-private:
     /**
-     * OpenGL handle to graph rendering shader program
+     * Distance of a node to the source of the last run in meters, infinity if not reached.
      */
-    GLuint prgm_handle;
+    float distance(uint32_t node) const
+    {
+        uint32_t bits = tentative[node].load(std::memory_order_relaxed);
+        float value;
+        std::memcpy(&value, &bits, sizeof(float));
+        return value;
+    }
 
     /**
-     * Actual (Linear) storage of all subgraphs.
+     * Nodes reached by the last run, in no particular order.
      */
-    std::vector<std::unique_ptr<Subgraph>> subgraphs;
+    const std::vector<uint32_t> &reachedNodes() const
+    {
+        return reached;
+    }
+
+private:
+    /* Delta relative to the mean edge length, smaller values take more but smaller steps */
+    static constexpr float DELTA_FACTOR = 4.0f;
+
+    /* Frontiers smaller than this are relaxed by the calling thread alone */
+    static constexpr size_t MIN_PARALLEL_FRONTIER = 1024;
+
+    /* Bit pattern of positive infinity. Non-negative floats compare like their bit patterns read as integers. */
+    static constexpr uint32_t INFINITE_BITS = 0x7f800000u;
+
+    GraphAdjacency forward;
+    GraphAdjacency reverse;
+    std::vector<float> forward_weights;
+    std::vector<float> reverse_weights;
+    float delta;
+    /* Length of the longest edge, which bounds how far ahead of the current bucket a node can be put */
+    float max_weight;
+
+    std::vector<std::atomic<uint32_t>> tentative;
+    std::vector<float> relaxed_at;
+    std::vector<uint32_t> reached;
+
+    static uint32_t toBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(float));
+        return bits;
+    }
 
     /**
-     * List of subgraphs (given by index) per layer.
+     * Relax either the light or the heavy edges of the given nodes.
+     * \param improved Set to the nodes whose distance has been lowered, possibly more than once each
      */
-    std::map<uint, std::list<uint>> layers;
+    void relax(const std::vector<uint32_t> &nodes, bool light, float cutoff, std::vector<uint32_t> &improved, uint num_threads)
+    {
+        improved.clear();
+
+        std::mutex result_mutex;
+        auto relaxRange = [this, &nodes, light, cutoff, &improved, &result_mutex](size_t begin, size_t end) {
+            std::vector<uint32_t> local_improved;
+            std::vector<uint32_t> local_reached;
+            for (size_t i = begin; i < end; i++)
+            {
+                uint32_t node = nodes[i];
+                float node_distance = distance(node);
+
+                for (int side = 0; side < 2; side++)
+                {
+                    const GraphAdjacency &adjacency = (side == 0) ? forward : reverse;
+                    const std::vector<float> &weights = (side == 0) ? forward_weights : reverse_weights;
+                    for (uint32_t a = adjacency.offsets[node]; a < adjacency.offsets[node + 1]; a++)
+                    {
+                        if ((weights[a] <= delta) != light || node_distance + weights[a] > cutoff)
+                            continue;
+
+                        uint32_t neighbour = adjacency.neighbours[a];
+                        uint32_t new_bits = toBits(node_distance + weights[a]);
+                        uint32_t old_bits = tentative[neighbour].load(std::memory_order_relaxed);
+                        while (new_bits < old_bits)
+                        {
+                            if (tentative[neighbour].compare_exchange_weak(old_bits, new_bits, std::memory_order_relaxed))
+                            {
+                                local_improved.push_back(neighbour);
+                                if (old_bits == INFINITE_BITS)
+                                    local_reached.push_back(neighbour);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            improved.insert(improved.end(), local_improved.begin(), local_improved.end());
+            reached.insert(reached.end(), local_reached.begin(), local_reached.end());
+        };
+        parallelFor(nodes.size(), relaxRange, (nodes.size() < MIN_PARALLEL_FRONTIER) ? 1 : num_threads);
+    }
 };
 
+constexpr float DeltaStepping::DELTA_FACTOR;
+constexpr size_t DeltaStepping::MIN_PARALLEL_FRONTIER;
+constexpr uint32_t DeltaStepping::INFINITE_BITS;
+
 /**
- * A graph specifically made to display nodes, edges and triangles of a triangulation of a sphere surface.
+ * Connected components of a GraphStore, found by a lock-free union-find over all edges in parallel. Each root
+ * links to the smaller of the two roots being united with a compare and swap, which fails and is retried if another
+ * thread has linked the root in the meantime. Finds halve the path to the root on the way up.
+ * Components are numbered by decreasing size, isolated nodes form components of their own.
  */
-struct TriangleGraph
+struct ConnectedComponents
 {
-    TriangleGraph()
-        : triangle_prgm_handle(0), nodeEdge_prgm_handle(0), num_nodes(0),
-          num_edges(0), num_triangles(0), node_va_handle(0), node_vbo_handle(0), node_ibo_handle(0),
-          edge_va_handle(0), edge_vbo_handle(0), edge_ibo_handle(0),
-          triangle_va_handle(0), triangle_vbo_handle(0), triangle_ibo_handle(0), show_sphere(false),
-          num_sphere_indices(0), sphere_world_position(1.0f, 0.0f, 0.0f), sphere_scale(1.0f), sphere_target_scale(1.0f),
-          sphere(4)
+    /* Component of each node */
+    std::vector<uint32_t> labels;
+    /* Number of nodes of each component */
+    std::vector<uint32_t> sizes;
+
+    size_t componentCount() const
     {
-        // Create shader programs
-        triangle_prgm_handle = createShaderProgram("../src/triangleGraph_triangle_v.glsl", "../src/triangleGraph_triangle_f.glsl", {"v_geoCoords", "v_id", "v_colour"});
-        nodeEdge_prgm_handle = createShaderProgram("../src/triangleGraph_nodeEdge_v.glsl", "../src/triangleGraph_nodeEdge_f.glsl", {"v_geoCoords", "v_colour"});
-        picking_prgm_handle = createShaderProgram("../src/triangleGraph_picking_v.glsl", "../src/triangleGraph_picking_f.glsl", {"v_geoCoords", "v_id", "v_colour"});
-        sphere_prgm_handle = createShaderProgram("../src/triangleGraph_sphere_v.glsl", "../src/triangleGraph_sphere_f.glsl", {"v_position"});
+        return sizes.size();
+    }
 
-        // Create framebuffer object for picking pass
-        glGenFramebuffers(1, &picking_fbo_handle);
-        glGenTextures(1, &picking_color_attachment_handle);
+    /**
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+     */
+    void build(const GraphStore &graph, uint num_threads = 0)
+    {
+        size_t node_cnt = graph.nodeCount();
 
-        glBindTexture(GL_TEXTURE_2D, picking_color_attachment_handle);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, 1600, 900, 0, GL_RED_INTEGER, GL_INT, nullptr);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        std::vector<std::atomic<uint32_t>> parents(node_cnt);
+        auto initRange = [&parents](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
+                parents[n].store((uint32_t)n, std::memory_order_relaxed);
+        };
+        parallelFor(node_cnt, initRange, num_threads);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, picking_fbo_handle);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, picking_color_attachment_handle, 0);
+        auto uniteRange = [&graph, &parents](size_t begin, size_t end) {
+            for (size_t e = begin; e < end; e++)
+            {
+                uint32_t u = graph.sources[e];
+                uint32_t v = graph.targets[e];
+                while (true)
+                {
+                    u = find(parents, u);
+                    v = find(parents, v);
+                    if (u == v)
+                        break;
+                    if (u < v)
+                        std::swap(u, v);
+
+                    // Linking the larger root below the smaller one can't create a cycle
+                    uint32_t expected = u;
+                    if (parents[u].compare_exchange_strong(expected, v, std::memory_order_acq_rel))
+                        break;
+                }
+            }
+        };
+        parallelFor(graph.edgeCount(), uniteRange, num_threads);
 
-        glGenRenderbuffers(1, &picking_depth_buffer_handle);
-        glBindRenderbuffer(GL_RENDERBUFFER, picking_depth_buffer_handle);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 1600, 900);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, picking_depth_buffer_handle);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        // Count the nodes of each root, then number the roots by decreasing count
+        labels.resize(node_cnt);
+        std::vector<std::atomic<uint32_t>> counts(node_cnt);
+        auto rootRange = [this, &parents, &counts](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
+            {
+                labels[n] = find(parents, (uint32_t)n);
+                counts[labels[n]].fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        parallelFor(node_cnt, rootRange, num_threads);
+
+        std::vector<uint32_t> roots;
+        for (size_t n = 0; n < node_cnt; n++)
+            if (labels[n] == n)
+                roots.push_back((uint32_t)n);
+
+        parallelSort(roots.begin(), roots.end(), [&counts](uint32_t u, uint32_t v) {
+            uint32_t count_u = counts[u].load(std::memory_order_relaxed);
+            uint32_t count_v = counts[v].load(std::memory_order_relaxed);
+            return (count_u != count_v) ? (count_u > count_v) : (u < v);
+        }, num_threads);
+
+        // Counts of the roots are replaced by their component, which is fine as each root is counted already
+        sizes.resize(roots.size());
+        for (size_t c = 0; c < roots.size(); c++)
+        {
+            sizes[c] = counts[roots[c]].load(std::memory_order_relaxed);
+            counts[roots[c]].store((uint32_t)c, std::memory_order_relaxed);
+        }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        auto labelRange = [this, &counts](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++)
+                labels[n] = counts[labels[n]].load(std::memory_order_relaxed);
+        };
+        parallelFor(node_cnt, labelRange, num_threads);
     }
-    TriangleGraph(const TriangleGraph &) = delete;
-    ~TriangleGraph()
+
+private:
+    static uint32_t find(std::vector<std::atomic<uint32_t>> &parents, uint32_t node)
     {
-        if (node_va_handle != 0)
+        while (true)
         {
-            // delete mesh resources
-            glBindVertexArray(node_va_handle);
+            uint32_t parent = parents[node].load(std::memory_order_relaxed);
+            if (parent == node)
+                return node;
+
+            uint32_t grandparent = parents[parent].load(std::memory_order_relaxed);
+            if (grandparent != parent)
+                parents[node].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            node = grandparent;
+        }
+    }
+};
+
+/*
+ * Camera (for OpenGL) orbiting a sphere that is centered on the origin
+ */
+struct OrbitalCamera
+{
+    OrbitalCamera() : longitude(0.0f), latitude(0.0f), orbit(5.0f), near(0.01f), far(10.0f), fovy(1.0), aspect_ratio(1.0) {}
+    ~OrbitalCamera() {}
+
+    float longitude;
+    float latitude;
+    float orbit;
+
+    float near;
+    float far;
+    float fovy;
+    float aspect_ratio;
+
+    void moveInOrbit(float delta_lat, float delta_lon, float delta_height)
+    {
+        latitude += delta_lat;
+        longitude += delta_lon;
+
+        if (longitude < -180.0f)
+            longitude = 360.0f + longitude;
+
+        if (longitude > 180.0f)
+            longitude = -180.0f + (longitude - 180.0f);
+
+        // m_orbit += delta_height;
+
+        orbit = std::max(1.0f + 0.000025f, orbit + delta_height);
+
+        updateViewMatrix();
+    }
+
+    Math::Mat4x4 view_matrix;
+    Math::Mat4x4 projection_matrix;
+
+    void updateProjectionMatrix()
+    {
+        float f = 1.0f / std::tan(fovy / 2.0f);
+        float nf = 1.0f / (near - far);
+        projection_matrix[0] = f / aspect_ratio;
+        projection_matrix[1] = 0.0f;
+        projection_matrix[2] = 0.0f;
+        projection_matrix[3] = 0.0f;
+        projection_matrix[4] = 0.0f;
+        projection_matrix[5] = f;
+        projection_matrix[6] = 0.0f;
+        projection_matrix[7] = 0.0f;
+        projection_matrix[8] = 0.0f;
+        projection_matrix[9] = 0.0f;
+        projection_matrix[10] = (far + near) * nf;
+        projection_matrix[11] = -1.0f;
+        projection_matrix[12] = 0.0f;
+        projection_matrix[13] = 0.0f;
+        projection_matrix[14] = (2.0f * far * near) * nf;
+        projection_matrix[15] = 0.0f;
+    }
+
+    void updateViewMatrix()
+    {
+        float lat_sin = sin((PI / 180.0f) * latitude);
+        float lon_sin = sin((PI / 180.0f) * longitude);
+
+        float lat_cos = cos((PI / 180.0f) * latitude);
+        float lon_cos = cos((PI / 180.0f) * longitude);
+
+        float camera_position[3];
+        camera_position[0] = (lon_sin * lat_cos * orbit);
+        camera_position[1] = (lat_sin * orbit);
+        camera_position[2] = (lat_cos * lon_cos * orbit);
+
+        Math::Mat4x4 lat_rotation(std::array<float, 16>({1.0, 0.0, 0.0, 0.0,
+                                                         0.0, lat_cos, -lat_sin, 0.0,
+                                                         0.0, lat_sin, lat_cos, 0.0,
+                                                         0.0, 0.0, 0.0, 1.0}));
+
+        Math::Mat4x4 lon_rotation(std::array<float, 16>({lon_cos, 0.0, -lon_sin, 0.0,
+                                                         0.0, 1.0, 0.0, 0.0,
+                                                         lon_sin, 0.0, lon_cos, 0.0,
+                                                         0.0, 0.0, 0.0, 1.0}));
+
+        Math::Mat4x4 rotation_matrix = lon_rotation * lat_rotation;
+
+        rotation_matrix = rotation_matrix.inverse();
+
+        Math::Mat4x4 translation_matrix(std::array<float, 16>({1.0, 0.0, 0.0, 0.0,
+                                                               0.0, 1.0, 0.0, 0.0,
+                                                               0.0, 0.0, 1.0, 0.0,
+                                                               -camera_position[0], -camera_position[1], -camera_position[2], 1.0}));
+
+        view_matrix = rotation_matrix * translation_matrix;
+    }
+
+    /**
+     * Intersect the view ray through a position given in normalized device coordinates with the unit sphere.
+     * \return False if the ray misses the sphere
+     */
+    bool screenToGeo(float ndc_x, float ndc_y, float &lon, float &lat)
+    {
+        Math::Mat4x4 inverse_view_projection = (projection_matrix * view_matrix).inverse();
+
+        // unproject the cursor position on the near and on the far plane
+        Math::Vec3 points[2];
+        for (int i = 0; i < 2; i++)
+        {
+            float ndc_z = (i == 0) ? -1.0f : 1.0f;
+            float p[4];
+            for (int row = 0; row < 4; row++)
+            {
+                p[row] = inverse_view_projection[row] * ndc_x + inverse_view_projection[4 + row] * ndc_y +
+                         inverse_view_projection[8 + row] * ndc_z + inverse_view_projection[12 + row];
+            }
+            points[i] = Math::Vec3(p[0] / p[3], p[1] / p[3], p[2] / p[3]);
+        }
+
+        Math::Vec3 origin = points[0];
+        Math::Vec3 ray = normalize(points[1] - points[0]);
+
+        float b = 2.0f * dot(ray, origin);
+        float c = dot(origin, origin) - 1.0f;
+        float discr = b * b - 4.0f * c;
+        if (discr < 0.0f)
+            return false;
+
+        Math::Vec3 intersection = origin + (((-b - std::sqrt(discr)) / 2.0f) * ray);
+
+        lat = (180.0f * std::asin(std::max(-1.0f, std::min(intersection.y, 1.0f)))) / PI;
+        lon = (180.0f * std::atan2(intersection.x, intersection.z)) / PI;
+
+        return true;
+    }
+
+    GeoBoundingBox computeVisibleArea()
+    {
+        GeoBoundingBox bbox;
+
+        // computer euklid. position of camera
+        float lat_sin = sin((PI / 180.0f) * latitude);
+        float lon_sin = sin((PI / 180.0f) * longitude);
+
+        float lat_cos = cos((PI / 180.0f) * latitude);
+        float lon_cos = cos((PI / 180.0f) * longitude);
+
+        float r = orbit;
+
+        Math::Vec3 world_position(lon_sin * lat_cos * r,
+                                  lat_sin * r,
+                                  lat_cos * lon_cos * r);
+
+        // Build camera vector space
+        Math::Vec3 front_vec = normalize(-1.0 * world_position);
+        Math::Vec3 right_vec = normalize(cross(front_vec, Math::Vec3(0.0f, 1.0f, 0.0f)));
+        Math::Vec3 up_vec = normalize(cross(right_vec, front_vec));
+
+        // generate rays from the camera position along the right and upper frustrum plane
+        Math::Vec3 upper_ray = normalize(front_vec + (std::tan(fovy * 0.5f) * up_vec));
+        Math::Vec3 right_ray = normalize(front_vec + (std::tan(fovy * 0.5f) * aspect_ratio * right_vec));
+
+        // intersect with unit sphere
+
+        Math::Vec3 upper_intersection;
+        float a = dot(upper_ray, upper_ray);
+        float b = 2.0f * dot(upper_ray, world_position);
+        float c = dot(world_position, world_position) - 1.0f * 1.0f;
+        float discr = b * b - 4.0f * a * c;
+        if (discr < 0.0f)
+        {
+            // no intersection, use tangent point from camera to sphere in up direction
+            upper_intersection = up_vec;
+        }
+        else
+        {
+            float lambda = (-b - sqrt(discr)) / (2.0f * a);
+            upper_intersection = world_position + (lambda * upper_ray);
+        }
+
+        Math::Vec3 right_intersection;
+        a = dot(right_ray, right_ray);
+        b = 2.0f * dot(right_ray, world_position);
+        c = dot(world_position, world_position) - 1.0f * 1.0f;
+        discr = b * b - 4.0f * a * c;
+        if (discr < 0.0f)
+        {
+            // no intersection, use tangent point from camera to sphere in right direction
+            right_intersection = right_vec;
+        }
+        else
+        {
+            float lambda = (-b - sqrt(discr)) / (2.0f * a);
+            right_intersection = world_position + (lambda * right_ray);
+        }
+
+        // using dot product suffers from nasty precision problems...
+        // compute angle between Vec(SphereCenter,Camera) and Vec(SphereCenter,RightIntersection)
+        // double longitude_angle = acos(dot64(normalize(world_position), normalize(right_intersection)));
+
+        // compute angle between Vec(SphereCenter,Camera) and Vec(SphereCenter,UpperIntersection)
+        // double latitude_angle = acos(dot64(normalize(world_position), normalize(upper_intersection)));
+
+        // convert from euklidean to geo coordinates
+        float upper_intersection_lat = (180.0f * std::asin(upper_intersection.y)) / PI;
+
+        float right_intersection_lat_cos = std::cos(std::asin(right_intersection.y));
+        float right_intersection_lon = (180.0f * std::asin(right_intersection.x / right_intersection_lat_cos)) / PI;
+
+        if (dot(right_intersection, Math::Vec3(0.0, 0.0, -1.0)) > 0.0)
+        {
+            if (dot(right_intersection, Math::Vec3(1.0, 0.0, 0.0)) > 0.0)
+                right_intersection_lon = 180.0f - right_intersection_lon;
+            else
+                right_intersection_lon = -180.0f - right_intersection_lon;
+        }
+
+        bbox.min_longitude = longitude - std::abs(right_intersection_lon - longitude);
+        bbox.min_longitude = (bbox.min_longitude < -180.0f) ? 360.0f + bbox.min_longitude : bbox.min_longitude;
+
+        bbox.max_longitude = right_intersection_lon;
+
+        bbox.min_latitude = latitude - std::abs(upper_intersection_lat - latitude);
+        bbox.max_latitude = upper_intersection_lat;
+
+        return bbox;
+    }
+
+    /**
+     * Conservative bounds of the part of the earth seen by the camera, i.e. of the spherical cap hit by the rays
+     * through the screen corners, or of the hemisphere facing the camera once the corners miss the earth.
+     * Longitudes are not wrapped to [-180, 180]. Caps containing a pole span all longitudes.
+     */
+    GeoBoundingBox computeVisibleBounds() const
+    {
+        // angle at the earth's center between the camera and where the ray through a screen corner hits the sphere
+        float corner_angle = std::atan(std::tan(fovy / 2.0f) * std::sqrt(1.0f + aspect_ratio * aspect_ratio));
+        float corner_sin = orbit * std::sin(corner_angle);
+        float cap_radius = (corner_sin < 1.0f) ? std::asin(corner_sin) - corner_angle : std::acos(1.0f / orbit);
+        cap_radius *= 180.0f / PI;
+
+        // the camera latitude is not limited to [-90, 90] when orbiting over a pole
+        float lat = latitude * (PI / 180.0f);
+        float lon = longitude * (PI / 180.0f);
+        float center_lat = (180.0f / PI) * std::asin(std::max(-1.0f, std::min(1.0f, std::sin(lat))));
+        float center_lon = (180.0f / PI) * std::atan2(std::sin(lon) * std::cos(lat), std::cos(lon) * std::cos(lat));
+
+        GeoBoundingBox bbox;
+        bbox.min_latitude = std::max(-90.0f, center_lat - cap_radius);
+        bbox.max_latitude = std::min(90.0f, center_lat + cap_radius);
+        bbox.min_longitude = -180.0f;
+        bbox.max_longitude = 180.0f;
+        if (std::abs(center_lat) + cap_radius < 90.0f)
+        {
+            float lon_radius = (180.0f / PI) * std::asin(std::sin(cap_radius * (PI / 180.0f)) / std::cos(center_lat * (PI / 180.0f)));
+            bbox.min_longitude = center_lon - lon_radius;
+            bbox.max_longitude = center_lon + lon_radius;
+        }
+        return bbox;
+    }
+};
+
+/**
+ * Reordering of indexed triangle meshes for the GPU. Triangles are reordered so that consecutive triangles share
+ * vertices still present in the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation"),
+ * afterwards vertices are renumbered in the order they are first used, so that vertex fetches walk through memory.
+ */
+namespace MeshOptimizer
+{
+    /* Size of the LRU cache assumed by the vertex scoring */
+    const uint CACHE_SIZE = 32;
+
+    /* Meshes are split into chunks of at least this many triangles which are optimized in parallel */
+    const size_t MIN_CHUNK_TRIANGLES = 16384;
+
+    /**
+     * Average cache miss ratio, i.e. transformed vertices per triangle, of a FIFO vertex cache.
+     * Ranges from 3.0 (no reuse) down to about 0.5 for large regular meshes.
+     */
+    float computeACMR(const std::vector<uint> &indices, size_t vertex_count, uint cache_size = 16)
+    {
+        if (indices.empty())
+            return 0.0f;
+
+        // A vertex is in the cache if at most cache_size misses happened since it was loaded
+        std::vector<size_t> load_time(vertex_count, 0);
+        size_t misses = 0;
+        for (uint index : indices)
+        {
+            if (load_time[index] == 0 || misses - load_time[index] >= cache_size)
+                load_time[index] = ++misses;
+        }
+
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    float vertexScore(int cache_position, uint remaining_triangles)
+    {
+        if (remaining_triangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cache_position >= 0)
+        {
+            // The vertices of the last triangle get a fixed score, so that the next triangle doesn't prefer them too much
+            if (cache_position < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cache_position - 3) / (float)(CACHE_SIZE - 3), 1.5f);
+        }
+
+        // Boost vertices with few remaining triangles, to get rid of them before they become lone triangles later on
+        return score + 2.0f * std::pow((float)remaining_triangles, -0.5f);
+    }
+
+    /**
+     * Reorder the triangles [first_triangle, end_triangle) of an index list, writing their new order into order.
+     */
+    void optimizeChunk(const std::vector<uint> &indices, size_t first_triangle, size_t end_triangle, uint *order)
+    {
+        size_t triangle_cnt = end_triangle - first_triangle;
+        const uint *chunk_indices = indices.data() + 3 * first_triangle;
+
+        // Local vertex numbering, so that memory only depends on the chunk size
+        std::vector<uint> vertices(chunk_indices, chunk_indices + 3 * triangle_cnt);
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+        std::vector<uint> local_indices(3 * triangle_cnt);
+        for (size_t i = 0; i < local_indices.size(); i++)
+            local_indices[i] = (uint)(std::lower_bound(vertices.begin(), vertices.end(), chunk_indices[i]) - vertices.begin());
+
+        // Triangles adjacent to each vertex, the remaining ones are kept at the front of each range
+        std::vector<uint> remaining(vertices.size(), 0);
+        for (uint v : local_indices)
+            remaining[v]++;
+
+        std::vector<uint> adjacency_offsets(vertices.size() + 1, 0);
+        for (size_t v = 0; v < vertices.size(); v++)
+            adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining[v];
+
+        std::vector<uint> adjacency(local_indices.size());
+        std::vector<uint> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < local_indices.size(); i++)
+            adjacency[fill[local_indices[i]]++] = (uint)(i / 3);
+
+        std::vector<int> cache_position(vertices.size(), -1);
+        std::vector<float> score(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++)
+            score[v] = vertexScore(-1, remaining[v]);
+
+        std::vector<bool> emitted(triangle_cnt, false);
+
+        std::array<uint, CACHE_SIZE + 3> cache;
+        std::array<uint, CACHE_SIZE + 3> new_cache;
+        size_t cache_cnt = 0;
+
+        size_t next_unemitted = 0;
+        int best_triangle = -1;
+
+        for (size_t emitted_cnt = 0; emitted_cnt < triangle_cnt; emitted_cnt++)
+        {
+            // Nothing in the cache has triangles left, continue with the next triangle in input order
+            if (best_triangle < 0)
+            {
+                while (emitted[next_unemitted])
+                    next_unemitted++;
+                best_triangle = (int)next_unemitted;
+            }
+
+            emitted[best_triangle] = true;
+            order[emitted_cnt] = (uint)(first_triangle + best_triangle);
+
+            // Put the vertices of the emitted triangle in front of the cache
+            size_t new_cache_cnt = 0;
+            for (uint i = 0; i < 3; i++)
+            {
+                uint v = local_indices[3 * best_triangle + i];
+                new_cache[new_cache_cnt++] = v;
+
+                uint *begin = adjacency.data() + adjacency_offsets[v];
+                uint *end = begin + remaining[v];
+                std::iter_swap(std::find(begin, end, (uint)best_triangle), end - 1);
+                remaining[v]--;
+            }
+
+            for (size_t i = 0; i < cache_cnt; i++)
+            {
+                uint v = cache[i];
+                if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2])
+                    new_cache[new_cache_cnt++] = v;
+            }
+
+            // Update vertex scores, vertices pushed out of the cache lose their position score
+            for (size_t i = 0; i < new_cache_cnt; i++)
+            {
+                uint v = new_cache[i];
+                cache_position[v] = (i < CACHE_SIZE) ? (int)i : -1;
+                score[v] = vertexScore(cache_position[v], remaining[v]);
+            }
+
+            // The next triangle is the best scoring one adjacent to the cache
+            best_triangle = -1;
+            float best_score = -1.0f;
+            cache_cnt = std::min<size_t>(new_cache_cnt, CACHE_SIZE);
+            for (size_t i = 0; i < cache_cnt; i++)
+            {
+                uint v = new_cache[i];
+                cache[i] = v;
+
+                for (uint a = adjacency_offsets[v]; a < adjacency_offsets[v] + remaining[v]; a++)
+                {
+                    uint t = adjacency[a];
+                    float triangle_score = score[local_indices[3 * t]] + score[local_indices[3 * t + 1]] + score[local_indices[3 * t + 2]];
+                    if (triangle_score > best_score)
+                    {
+                        best_score = triangle_score;
+                        best_triangle = (int)t;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Reorder the triangles of an index list for post-transform vertex cache reuse. The triangle list is split into
+     * contiguous chunks optimized in parallel, so the input order should already be roughly spatially coherent.
+     * \return The new triangle order, i.e. the previous index of each triangle
+     */
+    std::vector<uint> optimizeVertexCache(std::vector<uint> &indices, uint num_threads = 0)
+    {
+        size_t triangle_cnt = indices.size() / 3;
+        std::vector<uint> order(triangle_cnt);
+
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, triangle_cnt / MIN_CHUNK_TRIANGLES));
+
+        auto chunkRange = [&indices, &order, triangle_cnt, num_chunks](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; chunk++)
+            {
+                size_t first = (triangle_cnt * chunk) / num_chunks;
+                size_t last = (triangle_cnt * (chunk + 1)) / num_chunks;
+                optimizeChunk(indices, first, last, order.data() + first);
+            }
+        };
+        parallelFor(num_chunks, chunkRange, (uint)num_chunks);
+
+        std::vector<uint> reordered_indices(indices.size());
+        for (size_t t = 0; t < triangle_cnt; t++)
+        {
+            reordered_indices[3 * t] = indices[3 * order[t]];
+            reordered_indices[3 * t + 1] = indices[3 * order[t] + 1];
+            reordered_indices[3 * t + 2] = indices[3 * order[t] + 2];
+        }
+        indices.swap(reordered_indices);
+
+        return order;
+    }
+
+    /**
+     * Renumber vertices in the order they are first referenced by the index list, unreferenced vertices are moved
+     * to the end keeping their relative order.
+     * \return The new index of each vertex
+     */
+    std::vector<uint> optimizeVertexFetch(std::vector<uint> &indices, size_t vertex_count)
+    {
+        const uint UNASSIGNED = std::numeric_limits<uint>::max();
+
+        std::vector<uint> remap(vertex_count, UNASSIGNED);
+        uint next_vertex = 0;
+        for (uint &index : indices)
+        {
+            if (remap[index] == UNASSIGNED)
+                remap[index] = next_vertex++;
+            index = remap[index];
+        }
+
+        for (auto &new_index : remap)
+        {
+            if (new_index == UNASSIGNED)
+                new_index = next_vertex++;
+        }
+
+        return remap;
+    }
+}
+
+struct IcoSphere
+{
+    IcoSphere(){
+        // TODO
+    };
+
+    IcoSphere(uint subdivision)
+    {
+        GLfloat x = 0.525731112119133606f;
+        GLfloat z = 0.850650808352039932f;
+
+        std::vector<Vertex_XYZ> sphere_vertices({Vertex_XYZ(-x, 0.0f, z),
+                                                 Vertex_XYZ(x, 0.0f, z),
+                                                 Vertex_XYZ(-x, 0.0f, -z),
+                                                 Vertex_XYZ(x, 0.0f, -z),
+                                                 Vertex_XYZ(0.0f, z, x),
+                                                 Vertex_XYZ(0.0f, z, -x),
+                                                 Vertex_XYZ(0.0f, -z, x),
+                                                 Vertex_XYZ(0.0f, -z, -x),
+                                                 Vertex_XYZ(z, x, 0.0f),
+                                                 Vertex_XYZ(-z, x, 0.0f),
+                                                 Vertex_XYZ(z, -x, 0.0f),
+                                                 Vertex_XYZ(-z, -x, 0.0f)});
+        std::vector<unsigned int> sphere_indices({0, 4, 1, 0, 9, 4, 9, 5, 4, 4, 5, 8, 4, 8, 1,
+                                                  8, 10, 1, 8, 3, 10, 5, 3, 8, 5, 2, 3, 2, 7, 3,
+                                                  7, 10, 3, 7, 6, 10, 7, 11, 6, 11, 0, 6, 0, 1, 6,
+                                                  6, 1, 10, 9, 0, 11, 9, 11, 2, 9, 2, 5, 7, 2, 11});
+
+        // Subdivide icosahedron, midpoints are shared by the two triangles adjacent to an edge
+        for (uint subdivs = 0; subdivs < subdivision; subdivs++)
+        {
+            std::vector<unsigned int> refined_indices;
+            refined_indices.reserve(sphere_indices.size() * 4);
+
+            std::unordered_map<uint64_t, unsigned int> midpoints;
+            midpoints.reserve(sphere_indices.size());
+
+            auto midpoint = [&sphere_vertices, &midpoints](unsigned int idx1, unsigned int idx2) {
+                uint64_t key = ((uint64_t)std::min(idx1, idx2) << 32) | std::max(idx1, idx2);
+                auto midpoint_itr = midpoints.find(key);
+                if (midpoint_itr != midpoints.end())
+                    return midpoint_itr->second;
+
+                Math::Vec3 newVtx((sphere_vertices[idx1].x + sphere_vertices[idx2].x),
+                                  (sphere_vertices[idx1].y + sphere_vertices[idx2].y),
+                                  (sphere_vertices[idx1].z + sphere_vertices[idx2].z));
+                newVtx = Math::normalize(newVtx);
+
+                unsigned int newIdx = sphere_vertices.size();
+                sphere_vertices.push_back(Vertex_XYZ(newVtx.x, newVtx.y, newVtx.z));
+                midpoints[key] = newIdx;
+
+                return newIdx;
+            };
+
+            for (int i = 0; i < (int)sphere_indices.size(); i = i + 3)
+            {
+                unsigned int idx1 = sphere_indices[i];
+                unsigned int idx2 = sphere_indices[i + 1];
+                unsigned int idx3 = sphere_indices[i + 2];
+
+                unsigned int newIdx1 = midpoint(idx1, idx2);
+                unsigned int newIdx2 = midpoint(idx2, idx3);
+                unsigned int newIdx3 = midpoint(idx3, idx1);
+
+                refined_indices.push_back(idx1);
+                refined_indices.push_back(newIdx1);
+                refined_indices.push_back(newIdx3);
+
+                refined_indices.push_back(newIdx1);
+                refined_indices.push_back(idx2);
+                refined_indices.push_back(newIdx2);
+
+                refined_indices.push_back(newIdx3);
+                refined_indices.push_back(newIdx1);
+                refined_indices.push_back(newIdx2);
+
+                refined_indices.push_back(newIdx3);
+                refined_indices.push_back(newIdx2);
+                refined_indices.push_back(idx3);
+            }
+
+            sphere_indices.swap(refined_indices);
+        }
+
+        // Reorder for vertex cache reuse, which matters most for the instanced meshes
+#ifndef NVERBOSE
+        float acmr_before = MeshOptimizer::computeACMR(sphere_indices, sphere_vertices.size());
+#endif
+        MeshOptimizer::optimizeVertexCache(sphere_indices);
+        std::vector<uint> vertex_remap = MeshOptimizer::optimizeVertexFetch(sphere_indices, sphere_vertices.size());
+
+        std::vector<Vertex_XYZ> reordered_vertices(sphere_vertices.size());
+        for (size_t v = 0; v < sphere_vertices.size(); v++)
+            reordered_vertices[vertex_remap[v]] = sphere_vertices[v];
+        sphere_vertices.swap(reordered_vertices);
+#ifndef NVERBOSE
+        std::cout << "IcoSphere(" << subdivision << "): " << sphere_vertices.size() << " vertices, " << sphere_indices.size() / 3 << " triangles, ACMR "
+                  << acmr_before << " -> " << MeshOptimizer::computeACMR(sphere_indices, sphere_vertices.size()) << std::endl;
+#endif
+
+        index_cnt = sphere_indices.size();
+
+        auto va_size = sizeof(Vertex_XYZ) * sphere_vertices.size();
+        auto vi_size = sizeof(uint) * sphere_indices.size();
+
+        glGenVertexArrays(1, &va_handle);
+        glGenBuffers(1, &vbo_handle);
+        glGenBuffers(1, &ibo_handle);
+
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, va_size, sphere_vertices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, sphere_indices.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex_XYZ), 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    };
+    ~IcoSphere()
+    {
+        // delete mesh resources
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &ibo_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &vbo_handle);
+        glBindVertexArray(0);
+        glDeleteVertexArrays(1, &va_handle);
+    }
+
+    GLuint va_handle;
+    GLuint vbo_handle;
+    GLuint ibo_handle;
+
+    uint index_cnt;
+
+    void draw(uint instance_cnt)
+    {
+        glBindVertexArray(va_handle);
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)index_cnt, GL_UNSIGNED_INT, nullptr, instance_cnt);
+    }
+};
+
+/**
+ * Set of edge widths and colours to show, given by an expression of clauses separated by spaces that all have to hold.
+ * Each clause compares width or color with values, e.g. "width>=3", "color=2-3,5" or "width!=1 color<4".
+ * = and != take a comma separated list of values and ranges of values.
+ */
+struct EdgeFilter
+{
+    EdgeFilter()
+    {
+        width_mask.fill(~0u);
+        color_mask.fill(~0u);
+    }
+
+    /* Bit i of the 256 bits of each mask is set if an edge of width/colour i is shown */
+    std::array<uint32_t, 8> width_mask;
+    std::array<uint32_t, 8> color_mask;
+
+    std::string expression;
+
+    /**
+     * \return False if the expression is malformed
+     */
+    static bool parse(const std::string &expression, EdgeFilter &filter)
+    {
+        filter = EdgeFilter();
+        filter.expression = expression;
+
+        std::istringstream clauses(expression);
+        std::string clause;
+        while (clauses >> clause)
+        {
+            size_t op_begin = clause.find_first_of("=!<>");
+            size_t op_end = clause.find_first_not_of("=!<>", op_begin);
+            if (op_begin == std::string::npos || op_end == std::string::npos)
+                return false;
+
+            std::string attribute = clause.substr(0, op_begin);
+            std::string op = clause.substr(op_begin, op_end - op_begin);
+
+            std::array<uint32_t, 8> *mask;
+            if (attribute == "width")
+                mask = &filter.width_mask;
+            else if (attribute == "color")
+                mask = &filter.color_mask;
+            else
+                return false;
+
+            std::bitset<256> values;
+            if (op == "=" || op == "!=")
+            {
+                std::istringstream ranges(clause.substr(op_end));
+                std::string range;
+                while (std::getline(ranges, range, ','))
+                {
+                    int first, last;
+                    if (!parseRange(range, first, last))
+                        return false;
+                    for (int v = first; v <= last; v++)
+                        values.set(v);
+                }
+                if (op == "!=")
+                    values.flip();
+            }
+            else if (op == "<" || op == "<=" || op == ">" || op == ">=")
+            {
+                int value, last;
+                if (!parseRange(clause.substr(op_end), value, last) || value != last)
+                    return false;
+                for (int v = 0; v < 256; v++)
+                {
+                    if ((op == "<" && v < value) || (op == "<=" && v <= value) ||
+                        (op == ">" && v > value) || (op == ">=" && v >= value))
+                        values.set(v);
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            for (int v = 0; v < 256; v++)
+                if (!values.test(v))
+                    (*mask)[v / 32] &= ~(1u << (v % 32));
+        }
+
+        return true;
+    }
+
+private:
+    /**
+     * Parse "a" or "a-b" with values in [0,255]
+     */
+    static bool parseRange(const std::string &range, int &first, int &last)
+    {
+        char dash, rest;
+        std::istringstream in(range);
+        if (!(in >> first))
+            return false;
+        last = first;
+        if (in >> dash && (dash != '-' || !(in >> last) || in >> rest))
+            return false;
+        return 0 <= first && first <= last && last < 256;
+    }
+};
+
+/**
+ * How edge_f.glsl turns the colour values of the vertices of a subgraph into colours. Values outside of the threshold
+ * are drawn in the out of range colour, which hides them if its alpha is 0. Others either
+ *  - PALETTE: pick the colour with their index,
+ *  - COLORMAP: are mapped from the range onto the colours as stops of a continuous colormap,
+ *  - CYCLIC: are spread over the colormap by the golden ratio, so that neighbouring values differ.
+ * Changing the style of a subgraph only changes uniforms and a small texture, the vertex colours stay as they are.
+ */
+struct EdgeStyle
+{
+    enum Mode
+    {
+        PALETTE = 0,
+        COLORMAP = 1,
+        CYCLIC = 2
+    };
+
+    EdgeStyle()
+        : mode(PALETTE), range({{0.0f, 1.0f}}), threshold({{-std::numeric_limits<float>::max(), std::numeric_limits<float>::max()}}),
+          out_of_range_color({{0.0f, 0.0f, 0.0f, 0.0f}})
+    {
+        // Edge classes of .gl files, 6 is used for routes
+        colors.assign(256, {{0.0f, 0.0f, 0.0f, 1.0f}});
+        colors[1] = {{0.3f, 0.55f, 0.95f, 1.0f}};
+        colors[2] = {{0.95f, 0.4f, 0.4f, 1.0f}};
+        colors[3] = {{0.95f, 0.75f, 0.45f, 1.0f}};
+        colors[4] = {{0.95f, 0.9f, 0.55f, 1.0f}};
+        colors[5] = {{1.0f, 1.0f, 1.0f, 1.0f}};
+        colors[6] = {{0.3f, 0.9f, 0.4f, 1.0f}};
+    }
+
+    EdgeStyle(Mode mode, const std::vector<std::array<float, 4>> &colors, float range_min = 0.0f, float range_max = 1.0f)
+        : mode(mode), colors(colors), range({{range_min, range_max}}),
+          threshold({{-std::numeric_limits<float>::max(), std::numeric_limits<float>::max()}}), out_of_range_color({{0.0f, 0.0f, 0.0f, 0.0f}})
+    {
+    }
+
+    Mode mode;
+    std::vector<std::array<float, 4>> colors;
+    std::array<float, 2> range;
+    std::array<float, 2> threshold;
+    std::array<float, 4> out_of_range_color;
+
+    /* Stops of the hue circle, lightened a little */
+    static std::vector<std::array<float, 4>> hueCircle()
+    {
+        return {{{1.0f, 0.2f, 0.2f, 1.0f}}, {{1.0f, 1.0f, 0.2f, 1.0f}}, {{0.2f, 1.0f, 0.2f, 1.0f}}, {{0.2f, 1.0f, 1.0f, 1.0f}},
+                {{0.2f, 0.2f, 1.0f, 1.0f}}, {{1.0f, 0.2f, 1.0f, 1.0f}}, {{1.0f, 0.2f, 0.2f, 1.0f}}};
+    }
+};
+
+/**
+ * This struct essentially holds a renderable representation of a subgraph as a mesh, which is made up from
+ * a set of vertices and a set of indices (the latter describing the mesh connectivity).
+ * In this case the mesh uses line primitives, i.e. two succesive indices describe a single line segment.
+ *
+ * From a programming point of view, it makes sense to keep the three OpenGL handles required for a mesh obejct
+ * organised together in a struct as most high level operations like "send the mesh data to the GPU" require
+ * several OpenGL function calls and all of these handles.
+ */
+struct Subgraph
+{
+    Subgraph() : va_handle(0), vbo_handle(0), color_vbo_handle(0), ibo_handle(0), line_attributes_handle(0), visible_ibo_handle(0),
+                 draw_commands_handle(0), style_tx_handle(0), isVisible(true), isFiltered(false), index_offsets(), line_widths(),
+                 edge_count(0), color_version(0), visible_ibo_allocated(false), style_changed(true) {}
+    Subgraph(const Subgraph &) = delete;
+    ~Subgraph()
+    {
+        if (va_handle != 0)
+        {
+            // delete mesh resources
+            glBindVertexArray(va_handle);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &ibo_handle);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &vbo_handle);
+            glDeleteBuffers(1, &color_vbo_handle);
+            glDeleteBuffers(1, &line_attributes_handle);
+            glDeleteBuffers(1, &visible_ibo_handle);
+            glDeleteBuffers(1, &draw_commands_handle);
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &va_handle);
+        }
+        if (style_tx_handle != 0)
+        {
+            glDeleteTextures(1, &style_tx_handle);
+        }
+    }
+
+    /* Handle for the vertex array object */
+    GLuint va_handle;
+
+    /* Handle for the vertex buffer object (allows access to vertex data in GPU memory) */
+    GLuint vbo_handle;
+
+    /* Handle for the vertex colours, kept apart from the geo coordinates so that they can be changed on their own */
+    GLuint color_vbo_handle;
+
+    /* Handle for the index buffer objects (allows access to index data in GPU memory) */
+    GLuint ibo_handle;
+
+    /* Handles for filtering the edges on the GPU: width, colour and subset of each line, the indices of the lines passing
+     * the filter and one indirect draw command per subset */
+    GLuint line_attributes_handle;
+    GLuint visible_ibo_handle;
+    GLuint draw_commands_handle;
+
+    /* Handle for the palette or colormap of the style */
+    GLuint style_tx_handle;
+
+    bool isVisible;
+
+    /* Draw the lines passing the latest filter instead of all lines */
+    bool isFiltered;
+
+    /* To draw lines of different type, i.e of different width seperatly but still store them
+     * in the same index buffer object, offsets into the buffer are used to only draw a subset of the index buffer
+     * in each draw call.
+     */
+    std::vector<uint> index_offsets;
+    /* Stores the width of each subset of lines */
+    std::vector<float> line_widths;
+    /* Number of edges loaded, each contributes two indices to the index buffer */
+    size_t edge_count;
+    /* GraphStore node of each vertex, nodes with edges of different colours have one vertex per colour */
+    std::vector<uint> vertex_nodes;
+    /* Colour of each vertex as loaded */
+    std::vector<float> vertex_colors;
+    /* Counts the changes of the vertex colours, so that a change by someone else can be told apart */
+    uint color_version;
+
+    EdgeStyle style;
+
+    void loadGraphData(const GraphStore &graph)
+    {
+        index_offsets.clear();
+        line_widths.clear();
+        edge_count = graph.edgeCount();
+        isFiltered = false;
+        visible_ibo_allocated = false;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint> indices;
+        std::vector<uint> line_attributes;
+        line_attributes.reserve(graph.edgeCount());
+
+        // At least as many vertices as there are nodes are required
+        vertices.reserve(graph.nodeCount());
+
+        // Each edge contributes two indices
+        indices.reserve(graph.edgeCount() * 2);
+
+        // Copy geo coordinates from input nodes to vertices
+        for (size_t i = 0; i < graph.nodeCount(); i++)
+        {
+            vertices.push_back(Vertex(graph.longitudes[i], graph.latitudes[i]));
+        }
+
+        // Counting sort of the edges by width, stable so that edges of the same width keep their (possibly spatial) order
+        std::array<uint, 257> width_offsets;
+        width_offsets.fill(0);
+        for (uint8_t edge_width : graph.widths)
+            width_offsets[edge_width + 1]++;
+        for (size_t w = 1; w < width_offsets.size(); w++)
+            width_offsets[w] += width_offsets[w - 1];
+
+        std::vector<uint> edge_order(graph.edgeCount());
+        for (uint e = 0; e < graph.edgeCount(); e++)
+            edge_order[width_offsets[graph.widths[e]]++] = e;
+
+        // Copy indices from edge array to index array
+        std::vector<bool> has_next(graph.nodeCount(), false);
+        std::vector<uint> next(graph.nodeCount(), 0);
+        uint width = 0;
+        uint counter = 0;
+        for (uint e : edge_order)
+        {
+            uint src_id = graph.sources[e];
+            uint tgt_id = graph.targets[e];
+            float edge_color = (float)graph.colors[e];
+            uint edge_width = graph.widths[e];
+
+            while (has_next[src_id] && (vertices[src_id].color != edge_color))
+            {
+                src_id = next[src_id];
+            }
+
+            if (vertices[src_id].color == -1)
+            {
+                vertices[src_id].color = edge_color;
+            }
+
+            if (vertices[src_id].color != edge_color)
+            {
+                uint next_id = (uint)vertices.size();
+                vertices.push_back(Vertex(vertices[src_id].longitude, vertices[src_id].latitude));
+                vertices[next_id].color = edge_color;
+                has_next.push_back(false);
+                next.push_back(0);
+
+                next[src_id] = next_id;
+                has_next[src_id] = true;
+                src_id = next_id;
+            }
+
+            while (has_next[tgt_id] && (vertices[tgt_id].color != edge_color))
+            {
+                tgt_id = next[tgt_id];
+            }
+
+            if (vertices[tgt_id].color == -1)
+            {
+                vertices[tgt_id].color = edge_color;
+            }
+
+            if (vertices[tgt_id].color != edge_color)
+            {
+                uint next_id = (uint)vertices.size();
+                vertices.push_back(Vertex(vertices[tgt_id].longitude, vertices[tgt_id].latitude));
+                vertices[next_id].color = edge_color;
+                has_next.push_back(false);
+                next.push_back(0);
+
+                next[tgt_id] = next_id;
+                has_next[tgt_id] = true;
+                tgt_id = next_id;
+            }
+
+            // std::cout << "Edge color: " << edge_color << std::endl;
+            // std::cout << "Source color: " << vertices[src_id].color << std::endl;
+            // std::cout << "Target color: " << vertices[tgt_id].color << std::endl;
+
+            if (width != edge_width)
+            {
+                index_offsets.push_back(counter);
+                line_widths.push_back((float)edge_width);
+                width = edge_width;
+            }
+
+            indices.push_back(src_id);
+            indices.push_back(tgt_id);
+            line_attributes.push_back(edge_width | ((uint)graph.colors[e] << 8) | ((uint)(index_offsets.size() - 1) << 16));
+
+            counter += 2;
+        }
+        index_offsets.push_back((uint)indices.size());
+
+        // Vertices up to the node count are the nodes themselves, follow the chains of copies for the others
+        vertex_nodes.resize(vertices.size());
+        vertex_colors.resize(vertices.size());
+        for (uint n = 0; n < graph.nodeCount(); n++)
+        {
+            for (uint v = n;; v = next[v])
+            {
+                vertex_nodes[v] = n;
+                if (!has_next[v])
+                    break;
+            }
+        }
+        std::vector<float> geo_coords(vertices.size() * 2);
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            geo_coords[2 * v] = vertices[v].longitude;
+            geo_coords[2 * v + 1] = vertices[v].latitude;
+            vertex_colors[v] = vertices[v].color;
+        }
+
+        // Allocate GPU memory and send data
+        if (vertices.size() < 1 || indices.size() < 1)
+            return;
+
+        auto va_size = sizeof(float) * geo_coords.size();
+        auto vi_size = sizeof(uint) * indices.size();
+
+        if (va_handle == 0 || vbo_handle == 0 || ibo_handle == 0)
+        {
+            glGenVertexArrays(1, &va_handle);
+            glGenBuffers(1, &vbo_handle);
+            glGenBuffers(1, &color_vbo_handle);
+            glGenBuffers(1, &ibo_handle);
+            glGenBuffers(1, &line_attributes_handle);
+            glGenBuffers(1, &visible_ibo_handle);
+            glGenBuffers(1, &draw_commands_handle);
+        }
+
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, va_size, geo_coords.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, color_vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertex_colors.size(), vertex_colors.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, indices.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, line_attributes_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(uint) * line_attributes.size(), line_attributes.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, 2 * sizeof(float), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, color_vbo_handle);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, false, sizeof(float), 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // std::cout << "GfxGraph consisting of " << vertices.size() << " vertices and " << indices.size() << " indices" << std::endl;
+    }
+
+    /**
+     * Replace the colour of each vertex, e.g. to show values computed per node. Geometry stays as it is.
+     * \param colors One colour per vertex, see vertex_nodes for the node of each vertex
+     */
+    void setVertexColors(const std::vector<float> &colors)
+    {
+        if (color_vbo_handle == 0 || colors.size() != vertex_colors.size())
+            return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, color_vbo_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * colors.size(), colors.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        color_version++;
+    }
+
+    /**
+     * Restore the vertex colours given by the edges.
+     */
+    void resetVertexColors()
+    {
+        setVertexColors(vertex_colors);
+    }
+
+    /**
+     * Change how the vertex colours are shown. The texture is only loaded again if the colours of the style change.
+     */
+    void setStyle(const EdgeStyle &new_style)
+    {
+        style_changed = style_changed || (new_style.colors != style.colors) || (new_style.mode != style.mode);
+        style = new_style;
+    }
+
+    /**
+     * Set the uniforms of edge_f.glsl and bind the texture of the style to texture unit 0.
+     */
+    void applyStyle(GLuint prgm_handle)
+    {
+        if (style_tx_handle == 0)
+            glGenTextures(1, &style_tx_handle);
+        if (style_changed)
+            loadColorTexture1D(style_tx_handle, style.colors, (style.mode == EdgeStyle::PALETTE) ? GL_NEAREST : GL_LINEAR);
+        style_changed = false;
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_1D, style_tx_handle);
+        glUniform1i(glGetUniformLocation(prgm_handle, "style_tx1D"), 0);
+        glUniform1i(glGetUniformLocation(prgm_handle, "mode"), style.mode);
+        glUniform2fv(glGetUniformLocation(prgm_handle, "range"), 1, style.range.data());
+        glUniform2fv(glGetUniformLocation(prgm_handle, "threshold"), 1, style.threshold.data());
+        glUniform4fv(glGetUniformLocation(prgm_handle, "out_of_range_color"), 1, style.out_of_range_color.data());
+    }
+
+    /**
+     * Compact the lines passing a filter into a second index buffer, which is drawn instead of all lines from then on.
+     * Each subset of lines of the same width is packed at the start of its range of the index buffer, so that the
+     * number of lines to draw per subset is counted straight into an indirect draw command. Requires OpenGL 4.3.
+     * \param filter_prgm_handle Compute shader program of edge_filter_c.glsl
+     */
+    void filterEdges(GLuint filter_prgm_handle, const EdgeFilter &filter)
+    {
+        if (ibo_handle == 0 || index_offsets.size() < 2)
+            return;
+
+        if (!visible_ibo_allocated)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, visible_ibo_handle);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * index_offsets.back(), nullptr, GL_DYNAMIC_DRAW);
+            visible_ibo_allocated = true;
+        }
+
+        std::vector<DrawElementsIndirectCommand> commands(index_offsets.size() - 1);
+        for (size_t i = 0; i < commands.size(); i++)
+            commands[i] = {0, 1, index_offsets[i], 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_commands_handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        GLuint line_cnt = index_offsets.back() / 2;
+
+        glUseProgram(filter_prgm_handle);
+        glUniform1ui(glGetUniformLocation(filter_prgm_handle, "line_cnt"), line_cnt);
+        glUniform1uiv(glGetUniformLocation(filter_prgm_handle, "width_mask"), 8, filter.width_mask.data());
+        glUniform1uiv(glGetUniformLocation(filter_prgm_handle, "color_mask"), 8, filter.color_mask.data());
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ibo_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, line_attributes_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visible_ibo_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, draw_commands_handle);
+
+        // Work groups beyond the guaranteed 65535 in x direction continue in y direction
+        GLuint group_cnt = (line_cnt + FILTER_GROUP_SIZE - 1) / FILTER_GROUP_SIZE;
+        GLuint group_cnt_x = std::min(group_cnt, MAX_GROUP_CNT);
+        glDispatchCompute(group_cnt_x, (group_cnt + group_cnt_x - 1) / group_cnt_x, 1);
+        glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        for (GLuint binding = 0; binding < 4; binding++)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+
+        isFiltered = true;
+    }
+
+    /**
+     * Number of edges drawn, reads the counts of the latest filter back from the GPU.
+     */
+    size_t visibleEdgeCount()
+    {
+        if (!isFiltered)
+            return index_offsets.back() / 2;
+
+        std::vector<DrawElementsIndirectCommand> commands(index_offsets.size() - 1);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_commands_handle);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        size_t index_cnt = 0;
+        for (const DrawElementsIndirectCommand &command : commands)
+            index_cnt += command.count;
+        return index_cnt / 2;
+    }
+
+    void draw(float scale)
+    {
+        // glBindVertexArray(va_handle);
+        // glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, 0);
+
+        glBindVertexArray(va_handle);
+
+        if (isFiltered)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, visible_ibo_handle);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_commands_handle);
+        }
+
+        for (size_t i = 0; i < index_offsets.size() - 1; i++)
+        {
+            glLineWidth(std::max(1.0f, line_widths[i] * scale));
+            // glLineWidth(line_widths[i]);
+
+            if (isFiltered)
+                glDrawElementsIndirect(GL_LINES, GL_UNSIGNED_INT, (void *)(i * sizeof(DrawElementsIndirectCommand)));
+            else
+                glDrawElements(GL_LINES, index_offsets[i + 1] - index_offsets[i], GL_UNSIGNED_INT, (void *)(index_offsets[i] * sizeof(GLuint)));
+        }
+
+        if (isFiltered)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+    }
+
+private:
+    /* Layout of the commands read by glDrawElementsIndirect */
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLuint base_vertex;
+        GLuint base_instance;
+    };
+
+    /* Local size of edge_filter_c.glsl and the number of work groups per dimension every implementation supports */
+    static constexpr GLuint FILTER_GROUP_SIZE = 256;
+    static constexpr GLuint MAX_GROUP_CNT = 65535;
+
+    bool visible_ibo_allocated;
+    bool style_changed;
+};
+
+constexpr GLuint Subgraph::FILTER_GROUP_SIZE;
+constexpr GLuint Subgraph::MAX_GROUP_CNT;
+
+/**
+ * A graph made up from subgraphs, that can be arranged on multiple layers. Limited to rendering edges.
+ * This struct primarily holds a set of subgraphs and offers the neccessary functionality to add and change subgraphs.
+ */
+struct Graph
+{
+    Graph()
+    {
+        prgm_handle = createShaderProgram("../src/edge_v.glsl", "../src/edge_f.glsl", {"v_geoCoords", "v_color"});
+        filter_prgm_handle = 0;
+    }
+    ~Graph()
+    {
+        // delete shader program
+        glDeleteProgram(prgm_handle);
+        if (filter_prgm_handle != 0)
+            glDeleteProgram(filter_prgm_handle);
+    }
+
+    /**
+     * Add a new subgraph. Defaults to layer 0.
+     * \param graph Nodes and edges of the new subgraph.
+     * \return Index of the new subgraph.
+     */
+    uint addSubgraph(const GraphStore &graph)
+    {
+        std::unique_ptr<Subgraph> subgraph(new Subgraph);
+        subgraphs.push_back(std::move(subgraph));
+
+        subgraphs.back()->loadGraphData(graph);
+
+        auto itr = layers.insert(std::pair<uint, std::list<uint>>(0, std::list<uint>()));
+        itr.first->second.push_back(subgraphs.size() - 1);
+
+        return (uint)subgraphs.size() - 1;
+    }
+
+    /**
+     * Add a new subgraph on a given layer. If the layer index doesn't exist, a new layer is created.
+     * \param graph Nodes and edges of the new subgraph.
+     * \param layer Layer to place the new subgraph on. If layer doesn't exist yet, it is automatically created.
+     * \return Index of the new subgraph.
+     */
+    uint addSubgraph(const GraphStore &graph, uint layer)
+    {
+        std::unique_ptr<Subgraph> subgraph(new Subgraph);
+        subgraphs.push_back(std::move(subgraph));
+
+        subgraphs.back()->loadGraphData(graph);
+
+        auto itr = layers.insert(std::pair<uint, std::list<uint>>(layer, std::list<uint>()));
+        itr.first->second.push_back(subgraphs.size() - 1);
+
+        return (uint)subgraphs.size() - 1;
+    }
+
+    /**
+     * Replace the nodes and edges of a subgraph, keeping its layer and visibility.
+     * \param index Target subgraph index
+     * \param graph New nodes and edges of the subgraph.
+     */
+    void updateSubgraph(uint index, const GraphStore &graph)
+    {
+        if (index < subgraphs.size())
+            subgraphs[index]->loadGraphData(graph);
+    }
+
+    /**
+     * Access a subgraph, e.g. to find the index buffer range of an edge.
+     * \param index Target subgraph index
+     */
+    const Subgraph &getSubgraph(uint index) const
+    {
+        return *subgraphs[index];
+    }
+
+    Subgraph &getSubgraph(uint index)
+    {
+        return *subgraphs[index];
+    }
+
+    /**
+     * Only draw the edges of a subgraph passing a filter. The filter is applied on the GPU, so changing it is cheap.
+     * \param index Target subgraph index
+     * \return False if filtering isn't supported by the OpenGL context, which requires version 4.3
+     */
+    bool setEdgeFilter(uint index, const EdgeFilter &filter)
+    {
+        if (index >= subgraphs.size())
+            return false;
+
+        if (filter_prgm_handle == 0)
+        {
+            GLint major_version = 0, minor_version = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+            glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+            if (major_version < 4 || (major_version == 4 && minor_version < 3))
+            {
+                std::cerr << "Edge filters require OpenGL 4.3" << std::endl;
+                return false;
+            }
+            filter_prgm_handle = createComputeProgram("../src/edge_filter_c.glsl");
+        }
+
+        subgraphs[index]->filterEdges(filter_prgm_handle, filter);
+        return true;
+    }
+
+    /**
+     * Draw all edges of a subgraph again.
+     * \param index Target subgraph index
+     */
+    void clearEdgeFilter(uint index)
+    {
+        if (index < subgraphs.size())
+            subgraphs[index]->isFiltered = false;
+    }
+
+    /**
+     * Set visibily of a given subgraph.
+     * \param index Target subgraph index
+     * \param visibility If set to false, subgraph will not be rendered.
+     */
+    void setVisibilty(uint index, bool visibility)
+    {
+        if (index < subgraphs.size())
+            subgraphs[index]->isVisible = visibility;
+    }
+
+    /**
+     * Set layer of a given subgraph.
+     * \param index Target subgraph index
+     * \param layer Layer that the subgraph is assigned to.
+     */
+    void setLayer(uint index, uint layer)
+    {
+        // TODO find cleaner solution
+        for (auto &layer : layers)
+            for (auto itr = layer.second.begin(); itr != layer.second.end(); itr++)
+                if (*itr == index)
+                    layer.second.erase(itr);
+
+        auto itr = layers.insert(std::pair<uint, std::list<uint>>(layer, std::list<uint>()));
+        itr.first->second.push_back(index);
+    }
+
+    /**
+     * Draw all subgraphs, that are set to visible.
+     * The draw order depends on layers and -within each layer- on edge type.
+     * \param scale Additonal scale factor for edge widths.
+     */
+    void draw(OrbitalCamera &camera, float scale)
+    {
+        glUseProgram(prgm_handle);
+
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+
+        for (auto &layer : layers)
+        {
+            for (auto &subgraph_idx : layer.second)
+            {
+                if (subgraphs[subgraph_idx]->isVisible)
+                {
+                    subgraphs[subgraph_idx]->applyStyle(prgm_handle);
+                    subgraphs[subgraph_idx]->draw(scale);
+                }
+            }
+        }
+    }
+
+private:
+    /**
+     * OpenGL handle to graph rendering shader program
+     */
+    GLuint prgm_handle;
+
+    /**
+     * OpenGL handle to edge filter compute program, created by the first filter
+     */
+    GLuint filter_prgm_handle;
+
+    /**
+     * Actual (Linear) storage of all subgraphs.
+     */
+    std::vector<std::unique_ptr<Subgraph>> subgraphs;
+
+    /**
+     * List of subgraphs (given by index) per layer.
+     */
+    std::map<uint, std::list<uint>> layers;
+};
+
+/**
+ * Shortest route between two clicked nodes of a graph, drawn as subgraph on a layer above the graph itself.
+ * The first click selects the start node, the second click the destination, which shows the route between them.
+ * Nodes are reported by their ID in the graph file, given for each node index by node_ids.
+ */
+struct RouteOverlay
+{
+    RouteOverlay(const GraphStore &graph, const std::vector<uint> &node_ids, const NodeGrid &node_grid, ContractionHierarchy &hierarchy,
+                 Graph &line_graph)
+        : graph(graph), node_ids(node_ids), node_grid(node_grid), hierarchy(hierarchy), line_graph(line_graph), source(ContractionHierarchy::NO_ID)
+    {
+        subgraph_index = line_graph.addSubgraph(GraphStore(), LAYER);
+    }
+
+    /**
+     * Select the node closest to the given geo coordinates as start or destination of the route.
+     */
+    void click(float lon, float lat)
+    {
+        uint32_t node = node_grid.closestNode(lon, lat);
+        if (node >= graph.nodeCount())
+            return;
+
+        if (source == ContractionHierarchy::NO_ID)
+        {
+            source = node;
+            line_graph.updateSubgraph(subgraph_index, GraphStore());
+            std::cout << "Route from node " << node_ids[node] << ", click the destination" << std::endl;
+            return;
+        }
+
+        std::vector<uint32_t> edges;
+        auto t_start = std::chrono::high_resolution_clock::now();
+        float length = hierarchy.query(source, node, edges);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        if (std::isinf(length))
+            std::cout << "No route from node " << node_ids[source] << " to node " << node_ids[node] << std::endl;
+        else
+            std::cout << "Route from node " << node_ids[source] << " to node " << node_ids[node] << ": " << length / 1000.0f << "km over "
+                      << edges.size() << " edges, found in "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count() << "us" << std::endl;
+
+        // Copy the edges of the route and their nodes
+        GraphStore route;
+        std::unordered_map<uint32_t, uint32_t> route_nodes;
+        auto routeNode = [this, &route, &route_nodes](uint32_t n) {
+            auto itr = route_nodes.insert(std::make_pair(n, (uint32_t)route.nodeCount()));
+            if (itr.second)
+            {
+                route.latitudes.push_back(graph.latitudes[n]);
+                route.longitudes.push_back(graph.longitudes[n]);
+            }
+            return itr.first->second;
+        };
+        for (uint32_t e : edges)
+        {
+            route.sources.push_back(routeNode(graph.sources[e]));
+            route.targets.push_back(routeNode(graph.targets[e]));
+            route.widths.push_back(ROUTE_WIDTH);
+            route.colors.push_back(ROUTE_COLOR);
+        }
+        line_graph.updateSubgraph(subgraph_index, route);
+
+        source = ContractionHierarchy::NO_ID;
+    }
+
+private:
+    /* Drawn on top of all subgraphs on layer 0, with a colour and width no road of the graph has */
+    static constexpr uint LAYER = 1;
+    static constexpr uint8_t ROUTE_WIDTH = 5;
+    static constexpr uint8_t ROUTE_COLOR = 6;
+
+    const GraphStore &graph;
+    const std::vector<uint> &node_ids;
+    const NodeGrid &node_grid;
+    ContractionHierarchy &hierarchy;
+    Graph &line_graph;
+
+    uint subgraph_index;
+    uint32_t source;
+};
+
+constexpr uint RouteOverlay::LAYER;
+constexpr uint8_t RouteOverlay::ROUTE_WIDTH;
+constexpr uint8_t RouteOverlay::ROUTE_COLOR;
+
+/**
+ * Travel distance from a node to all other nodes of a graph up to a cutoff, shown by recolouring the edges of the
+ * subgraph the graph has been loaded into. Only the vertex colours are replaced, the geometry stays as it is.
+ */
+struct IsochroneOverlay
+{
+    IsochroneOverlay(const GraphStore &graph, const std::vector<uint> &node_ids, const NodeGrid &node_grid, Subgraph &subgraph, float cutoff)
+        : graph(graph), node_ids(node_ids), node_grid(node_grid), subgraph(subgraph), edge_style(subgraph.style), cutoff(cutoff), source((uint32_t)graph.nodeCount())
+    {
+        search.build(graph);
+    }
+
+    /**
+     * Compute the distances from the node closest to the given geo coordinates, unless that node is the source already.
+     */
+    void setSource(float lon, float lat)
+    {
+        uint32_t node = node_grid.closestNode(lon, lat);
+        if (node == source || node >= graph.nodeCount())
+            return;
+        source = node;
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        search.run(source, cutoff);
+
+        // Vertices within the cutoff map their distance onto the colormap, all others are greyed out by the threshold.
+        // Those get twice the cutoff rather than infinity, which wouldn't survive the interpolation along the edges.
+        std::vector<float> colors(subgraph.vertex_nodes.size());
+        const DeltaStepping &distances = search;
+        const std::vector<uint> &vertex_nodes = subgraph.vertex_nodes;
+        float unreached = 2.0f * cutoff;
+        auto colorRange = [&colors, &distances, &vertex_nodes, unreached](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++)
+            {
+                float distance = distances.distance(vertex_nodes[v]);
+                colors[v] = std::isinf(distance) ? unreached : distance;
+            }
+        };
+        parallelFor(colors.size(), colorRange);
+        subgraph.setVertexColors(colors);
+
+        EdgeStyle style(EdgeStyle::COLORMAP, {{{0.1f, 0.85f, 0.95f, 1.0f}}, {{0.85f, 0.15f, 0.85f, 1.0f}}}, 0.0f, cutoff);
+        style.threshold[1] = cutoff;
+        style.out_of_range_color = {{0.55f, 0.55f, 0.55f, 1.0f}};
+        subgraph.setStyle(style);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        std::cout << "Isochrone around node " << node_ids[source] << ": " << search.reachedNodes().size() << " nodes within "
+                  << cutoff / 1000.0f << "km, computed in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count() << "us" << std::endl;
+    }
+
+    /**
+     * Restore the colours of the edges.
+     */
+    void clear()
+    {
+        source = (uint32_t)graph.nodeCount();
+        subgraph.resetVertexColors();
+        subgraph.setStyle(edge_style);
+    }
+
+private:
+    const GraphStore &graph;
+    const std::vector<uint> &node_ids;
+    const NodeGrid &node_grid;
+    Subgraph &subgraph;
+    /* Style of the subgraph without the isochrone */
+    EdgeStyle edge_style;
+    DeltaStepping search;
+
+    float cutoff;
+    uint32_t source;
+};
+
+
+/**
+ * Connected components of a graph shown by recolouring the edges of the subgraph the graph has been loaded into,
+ * either each component in a colour of its own or only the components with fewer nodes than a threshold.
+ */
+struct ComponentOverlay
+{
+    enum Mode
+    {
+        EDGES,
+        SMALL_COMPONENTS,
+        ALL_COMPONENTS
+    };
+
+    ComponentOverlay(const ConnectedComponents &components, Subgraph &subgraph, uint32_t min_size)
+        : components(components), subgraph(subgraph), edge_style(subgraph.style), min_size(min_size), mode(EDGES), color_version(0),
+          colors_written(false)
+    {
+    }
+
+    void setMode(Mode new_mode)
+    {
+        mode = new_mode;
+        if (mode == EDGES)
+        {
+            subgraph.resetVertexColors();
+            subgraph.setStyle(edge_style);
+            return;
+        }
+
+        // The component of each vertex is its colour in both modes, only written if someone else changed the colours
+        if (!colors_written || subgraph.color_version != color_version)
+        {
+            std::vector<float> colors(subgraph.vertex_nodes.size());
+            const ConnectedComponents &labelled = components;
+            const std::vector<uint> &vertex_nodes = subgraph.vertex_nodes;
+            auto colorRange = [&colors, &labelled, &vertex_nodes](size_t begin, size_t end) {
+                for (size_t v = begin; v < end; v++)
+                    colors[v] = (float)labelled.labels[vertex_nodes[v]];
+            };
+            parallelFor(colors.size(), colorRange);
+            subgraph.setVertexColors(colors);
+            color_version = subgraph.color_version;
+            colors_written = true;
+        }
+
+        // Components are numbered by decreasing size, the small ones are those from the first small one on
+        EdgeStyle style(EdgeStyle::CYCLIC, EdgeStyle::hueCircle());
+        if (mode == SMALL_COMPONENTS)
+        {
+            auto first_small = std::upper_bound(components.sizes.begin(), components.sizes.end(), min_size, std::greater<uint32_t>());
+            style.threshold[0] = (float)(first_small - components.sizes.begin()) - 0.5f;
+            style.out_of_range_color = {{0.55f, 0.55f, 0.55f, 1.0f}};
+        }
+        subgraph.setStyle(style);
+    }
+
+    /**
+     * Switch from the edge colours to the small components, to all components and back again.
+     */
+    void nextMode()
+    {
+        setMode((Mode)((mode + 1) % 3));
+    }
+
+private:
+    const ConnectedComponents &components;
+    Subgraph &subgraph;
+    /* Style of the subgraph without the components */
+    EdgeStyle edge_style;
+
+    uint32_t min_size;
+    Mode mode;
+
+    uint color_version;
+    bool colors_written;
+};
+
+/**
+ * Density of the edges of a graph, drawn instead of the edges when zoomed out far enough that they only overdraw each
+ * other. The edges are drawn once into an equirectangular float texture with additive blending, so that each texel
+ * holds the length of the edges through it in texels. Mipmaps of the texture form the density pyramid sampled by a
+ * sphere around the globe, whose cost doesn't depend on the number of edges. Edges crossing the antimeridian are
+ * split there by a geometry shader rather than drawn across the whole texture.
+ */
+struct DensityHeatmap
+{
+    DensityHeatmap() : sphere(4), density_tx_handle(0), max_density(1.0f)
+    {
+        accumulate_prgm_handle = createShaderProgram("../src/heatmap_accumulate_v.glsl", "../src/heatmap_accumulate_g.glsl",
+                                                     "../src/heatmap_accumulate_f.glsl", {"v_geoCoords"});
+        prgm_handle = createShaderProgram("../src/heatmap_v.glsl", "../src/heatmap_f.glsl", {"v_position"});
+
+        // Dark purple over red to pale yellow, of increasing brightness
+        glGenTextures(1, &colormap_tx_handle);
+        setColormap({{{0.10f, 0.03f, 0.25f, 1.0f}}, {{0.55f, 0.10f, 0.45f, 1.0f}}, {{0.90f, 0.30f, 0.20f, 1.0f}},
+                     {{0.99f, 0.75f, 0.25f, 1.0f}}, {{0.99f, 0.99f, 0.75f, 1.0f}}});
+    }
+    DensityHeatmap(const DensityHeatmap &) = delete;
+    ~DensityHeatmap()
+    {
+        glDeleteProgram(accumulate_prgm_handle);
+        glDeleteProgram(prgm_handle);
+        glDeleteTextures(1, &colormap_tx_handle);
+        if (density_tx_handle != 0)
+            glDeleteTextures(1, &density_tx_handle);
+    }
+
+    /**
+     * \param stops Colours from the lowest to the highest density, evenly spaced
+     */
+    void setColormap(const std::vector<std::array<float, 4>> &stops)
+    {
+        loadColorTexture1D(colormap_tx_handle, stops, GL_LINEAR);
+    }
+
+    /**
+     * Accumulate the edges of a subgraph into the density texture, replacing earlier content.
+     */
+    void accumulate(const Subgraph &subgraph)
+    {
+        if (subgraph.va_handle == 0)
+            return;
+
+        if (density_tx_handle == 0)
+            glGenTextures(1, &density_tx_handle);
+
+        glBindTexture(GL_TEXTURE_2D, density_tx_handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, TEXTURE_WIDTH, TEXTURE_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
+
+        GLuint fbo_handle;
+        glGenFramebuffers(1, &fbo_handle);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_handle);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, density_tx_handle, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Density heatmap framebuffer incomplete" << std::endl;
+
+        glViewport(0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glLineWidth(1.0f);
+
+        glUseProgram(accumulate_prgm_handle);
+        glBindVertexArray(subgraph.va_handle);
+        glDrawElements(GL_LINES, subgraph.index_offsets.back(), GL_UNSIGNED_INT, nullptr);
+        glBindVertexArray(0);
+
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo_handle);
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // Densities are scaled by the highest one of a level that is about as coarse as the globe when zoomed out
+        std::vector<float> level((TEXTURE_WIDTH >> NORMALIZATION_LEVEL) * (TEXTURE_HEIGHT >> NORMALIZATION_LEVEL));
+        glGetTexImage(GL_TEXTURE_2D, NORMALIZATION_LEVEL, GL_RED, GL_FLOAT, level.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        max_density = std::max(*std::max_element(level.begin(), level.end()), std::numeric_limits<float>::min());
+    }
+
+    void draw(OrbitalCamera &camera)
+    {
+        if (density_tx_handle == 0)
+            return;
+
+        glUseProgram(prgm_handle);
+
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        glUniform1f(glGetUniformLocation(prgm_handle, "max_density"), max_density);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, density_tx_handle);
+        glUniform1i(glGetUniformLocation(prgm_handle, "density_tx2D"), 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, colormap_tx_handle);
+        glUniform1i(glGetUniformLocation(prgm_handle, "colormap_tx1D"), 1);
+
+        // Faces of the ico sphere point inwards
+        glCullFace(GL_FRONT);
+        sphere.draw(1);
+        glCullFace(GL_BACK);
+
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+private:
+    /* Resolution of the density texture, which is about what a whole earth view covers on screen */
+    static constexpr GLsizei TEXTURE_WIDTH = 2048;
+    static constexpr GLsizei TEXTURE_HEIGHT = 1024;
+    static constexpr GLint NORMALIZATION_LEVEL = 2;
+
+    IcoSphere sphere;
+
+    GLuint accumulate_prgm_handle;
+    GLuint prgm_handle;
+    GLuint density_tx_handle;
+    GLuint colormap_tx_handle;
+
+    float max_density;
+};
+
+constexpr GLsizei DensityHeatmap::TEXTURE_WIDTH;
+constexpr GLsizei DensityHeatmap::TEXTURE_HEIGHT;
+constexpr GLint DensityHeatmap::NORMALIZATION_LEVEL;
+
+/**
+ * CPU point location on a spherical triangulation.
+ * Each triangle knows its neighbours across its three edges. A query jumps to a start triangle taken from a
+ * coarse lat/lon grid over the bounding box of the mesh and walks from there towards the query point,
+ * crossing the edge that separates the current triangle from the point in each step.
+ * Queries only read the structure, thus any number of threads may locate points concurrently.
+ */
+struct TriangleLocator
+{
+    TriangleLocator() : grid_width(0), grid_height(0), min_lon(0.0f), min_lat(0.0f), cell_lon(1.0f), cell_lat(1.0f) {}
+
+    static constexpr uint NO_NEIGHBOUR = std::numeric_limits<uint>::max();
+
+    /* Geo coordinate of each node (x = longitude, y = latitude), positions on the unit sphere are computed from it */
+    std::vector<Math::Vec2> lon_lat;
+
+    /* Node indices of each triangle, counter-clockwise if seen from outside the sphere */
+    std::vector<std::array<uint, 3>> corners;
+
+    /* Neighbour across the edge from corner i to corner i+1, NO_NEIGHBOUR at the border of the mesh */
+    std::vector<std::array<uint, 3>> neighbours;
+
+    /* Start triangle for each cell of the jump grid */
+    std::vector<uint> grid;
+    uint grid_width;
+    uint grid_height;
+    float min_lon;
+    float min_lat;
+    float cell_lon;
+    float cell_lat;
+
+    /* Set for cells overlapped by a triangle, points in other cells are not covered by the mesh */
+    std::vector<bool> covered_cells;
+
+    /* Sorted cells overlapped by a triangle at the border of the mesh. The triangles overlapping border_cells[i] are
+     * border_cell_triangles[border_cell_start[i]] to border_cell_triangles[border_cell_start[i+1]-1]
+     */
+    std::vector<uint> border_cells;
+    std::vector<uint> border_cell_start;
+    std::vector<uint> border_cell_triangles;
+
+    /* Triangles changed or created by insertions since the mesh was built, missing from the border cell lists */
+    std::vector<uint> inserted_triangles;
+
+    size_t size() const
+    {
+        return corners.size();
+    }
+
+    void build(const GraphStore &graph)
+    {
+        lon_lat.clear();
+        corners.clear();
+        neighbours.clear();
+        grid.clear();
+        covered_cells.clear();
+        border_cells.clear();
+        border_cell_start.clear();
+        border_cell_triangles.clear();
+        inserted_triangles.clear();
+
+        lon_lat.reserve(graph.nodeCount());
+        for (size_t i = 0; i < graph.nodeCount(); i++)
+            lon_lat.push_back(Math::Vec2(graph.longitudes[i], graph.latitudes[i]));
+
+        corners.reserve(graph.triangleCount());
+        for (size_t t = 0; t < graph.triangleCount(); t++)
+        {
+            std::array<uint, 3> c = {{graph.triangle_corners[3 * t], graph.triangle_corners[3 * t + 1], graph.triangle_corners[3 * t + 2]}};
+            if (orientation(position(c[0]), position(c[1]), position(c[2])) < 0.0)
+                std::swap(c[1], c[2]);
+            corners.push_back(c);
+        }
+
+        // Match both halves of each edge, the key is the pair of node indices ordered by index
+        std::array<uint, 3> no_neighbours = {{NO_NEIGHBOUR, NO_NEIGHBOUR, NO_NEIGHBOUR}};
+        neighbours.assign(corners.size(), no_neighbours);
+
+        std::unordered_map<uint64_t, uint> open_edges;
+        open_edges.reserve(corners.size() * 2);
+        for (uint t = 0; t < corners.size(); t++)
+        {
+            for (uint i = 0; i < 3; i++)
+            {
+                uint a = corners[t][i];
+                uint b = corners[t][(i + 1) % 3];
+                uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+
+                auto match = open_edges.find(key);
+                if (match == open_edges.end())
+                {
+                    open_edges.insert(std::make_pair(key, t * 3 + i));
+                }
+                else
+                {
+                    neighbours[t][i] = match->second / 3;
+                    neighbours[match->second / 3][match->second % 3] = t;
+                    open_edges.erase(match);
+                }
+            }
+        }
+
+        buildGrid(graph);
+    }
+
+    /**
+     * Find the triangle containing the given geo coordinate.
+     * \return Index of the triangle, -1 if the point is not covered by the mesh
+     */
+    int locate(float lon, float lat) const
+    {
+        if (corners.empty())
+            return -1;
+
+        return locate(geoToCartesian(lon, lat), lon, lat);
+    }
+
+    /**
+     * Find the triangle containing the point p on the unit sphere at the given geo coordinate. The walk starts
+     * at the start triangle of the point's grid cell and is restarted from the start triangles of the surrounding
+     * cells if it leaves the mesh, e.g. in a non-convex part of the mesh. If all walks fail, the triangles that
+     * may contain the point are tested one by one.
+     */
+    int locate(const Math::Vec3 &p, float lon, float lat) const
+    {
+        int x = (int)cellX(lon);
+        int y = (int)cellY(lat);
+        if (!covered_cells[y * grid_width + x])
+            return -1;
+
+        std::array<uint, 9> tried;
+        size_t tried_cnt = 0;
+        for (int i = 0; i < 9; i++)
+        {
+            // The point's own cell first, then its neighbours
+            int cell_x = std::max(0, std::min(x + (i + 4) % 9 % 3 - 1, (int)grid_width - 1));
+            int cell_y = std::max(0, std::min(y + (i + 4) % 9 / 3 - 1, (int)grid_height - 1));
+            uint start = grid[cell_y * grid_width + cell_x];
+            if (std::find(tried.begin(), tried.begin() + tried_cnt, start) != tried.begin() + tried_cnt)
+                continue;
+            tried[tried_cnt++] = start;
+
+            int t = walk(p, start);
+            if (t >= 0)
+                return t;
+            if (t == -2)
+                break;
+        }
+
+        // Walks fail close to holes and concave borders of the mesh, where only the triangles listed for the cell
+        // and those changed by insertions can contain the point
+        uint cell = y * grid_width + x;
+        auto border_cell = std::lower_bound(border_cells.begin(), border_cells.end(), cell);
+        if (border_cell != border_cells.end() && *border_cell == cell)
+        {
+            size_t i = border_cell - border_cells.begin();
+            for (uint k = border_cell_start[i]; k < border_cell_start[i + 1]; k++)
+            {
+                if (contains(border_cell_triangles[k], p))
+                    return (int)border_cell_triangles[k];
+            }
+            for (uint t : inserted_triangles)
+            {
+                if (contains(t, p))
+                    return (int)t;
+            }
+
+            return -1;
+        }
+
+        // Other covered cells are covered completely, walks only fail there on folded meshes
+        for (uint t = 0; t < corners.size(); t++)
+        {
+            if (contains(t, p))
+                return (int)t;
+        }
+
+        return -1;
+    }
+
+    /**
+     * Locate a batch of geo coordinates (x = longitude, y = latitude) using multiple threads.
+     * \param num_threads Number of threads to use, 0 uses one thread per hardware thread
+     */
+    void locate(const std::vector<Math::Vec2> &lon_lat, std::vector<int> &triangle_ids, uint num_threads = 0) const
+    {
+        triangle_ids.resize(lon_lat.size());
+
+        auto locateRange = [this, &lon_lat, &triangle_ids](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                triangle_ids[i] = locate(lon_lat[i].x, lon_lat[i].y);
+        };
+        parallelFor(lon_lat.size(), locateRange, num_threads);
+    }
+
+    /**
+     * Result of inserting a node, used to patch renderable copies of the triangulation.
+     */
+    struct Insertion
+    {
+        uint node;
+
+        /* Modified or created triangles, may contain duplicates */
+        std::vector<uint> changed_triangles;
+
+        /* For each created triangle in order of creation, the triangle it was split from */
+        std::vector<uint> parent_triangles;
+
+        std::vector<std::pair<uint, uint>> removed_edges;
+        std::vector<std::pair<uint, uint>> added_edges;
+    };
+
+    /**
+     * Insert a node at the given geo coordinate, keeping a Delaunay triangulation Delaunay.
+     * The containing triangle is split into three, or the two triangles sharing the edge the point lies on into four.
+     * Afterwards edges opposite to the new node are flipped until all of them are locally Delaunay.
+     * Modified triangles keep their index, created triangles are appended. The jump grid is left untouched,
+     * its start triangles stay valid, modified and created triangles are remembered for the border cells.
+     * \return False if the point is not covered by the mesh or coincides with a node
+     */
+    bool insert(float lon, float lat, Insertion &insertion)
+    {
+        insertion.changed_triangles.clear();
+        insertion.parent_triangles.clear();
+        insertion.removed_edges.clear();
+        insertion.added_edges.clear();
+
+        if (corners.empty())
+            return false;
+
+        Math::Vec3 p = geoToCartesian(lon, lat);
+        int located = locate(p, lon, lat);
+        if (located < 0)
+            return false;
+
+        uint t = (uint)located;
+        std::array<uint, 3> c = corners[t];
+        std::array<uint, 3> n = neighbours[t];
+
+        std::array<Math::Vec3, 3> c_positions = {{position(c[0]), position(c[1]), position(c[2])}};
+        for (uint i = 0; i < 3; i++)
+        {
+            if (Math::dot64(c_positions[i], p) > 1.0 - 1e-14)
+                return false;
+        }
+
+        // Points with a negligible barycentric coordinate lie on the opposite edge
+        double area = orientation(c_positions[0], c_positions[1], c_positions[2]);
+        uint on_edge = 3;
+        for (uint i = 0; i < 3; i++)
+        {
+            if (orientation(c_positions[i], c_positions[(i + 1) % 3], p) <= 1e-6 * area)
+                on_edge = i;
+        }
+
+        uint node = (uint)lon_lat.size();
+        lon_lat.push_back(Math::Vec2(lon, lat));
+        insertion.node = node;
+
+        std::vector<uint> unchecked;
+
+        if (on_edge == 3)
+        {
+            uint t1 = (uint)corners.size();
+            uint t2 = t1 + 1;
+
+            setTriangle(t, c[0], c[1], node, n[0], t1, t2);
+            addTriangle(c[1], c[2], node, n[1], t2, t, t, insertion);
+            addTriangle(c[2], c[0], node, n[2], t, t1, t, insertion);
+            replaceNeighbour(n[1], t, t1);
+            replaceNeighbour(n[2], t, t2);
+
+            for (uint i = 0; i < 3; i++)
+                insertion.added_edges.push_back(std::make_pair(node, c[i]));
+
+            unchecked = {t, t1, t2};
+        }
+        else
+        {
+            uint u = c[on_edge], v = c[(on_edge + 1) % 3], w = c[(on_edge + 2) % 3];
+            uint n_uv = n[on_edge], n_vw = n[(on_edge + 1) % 3], n_wu = n[(on_edge + 2) % 3];
+
+            uint t2 = (uint)corners.size();
+            uint n2 = (n_uv != NO_NEIGHBOUR) ? t2 + 1 : NO_NEIGHBOUR;
+            uint n1 = n_uv;
+
+            setTriangle(t, w, u, node, n_wu, n1, t2);
+            addTriangle(v, w, node, n_vw, t, n2, t, insertion);
+            replaceNeighbour(n_vw, t, t2);
+
+            insertion.removed_edges.push_back(std::make_pair(u, v));
+            insertion.added_edges.push_back(std::make_pair(node, u));
+            insertion.added_edges.push_back(std::make_pair(node, v));
+            insertion.added_edges.push_back(std::make_pair(node, w));
+
+            unchecked = {t, t2};
+
+            if (n_uv != NO_NEIGHBOUR)
+            {
+                uint f = edgeIndex(n_uv, v, u);
+                uint q = corners[n_uv][(f + 2) % 3];
+                uint n_uq = neighbours[n_uv][(f + 1) % 3], n_qv = neighbours[n_uv][(f + 2) % 3];
+
+                setTriangle(n1, u, q, node, n_uq, n2, t);
+                addTriangle(q, v, node, n_qv, t2, n1, n1, insertion);
+                replaceNeighbour(n_qv, n1, n2);
+
+                insertion.added_edges.push_back(std::make_pair(node, q));
+
+                unchecked.push_back(n1);
+                unchecked.push_back(n2);
+            }
+        }
+
+        insertion.changed_triangles = unchecked;
+
+        // Lawson flips, every triangle on the stack has the new node as its third corner
+        while (!unchecked.empty())
+        {
+            uint t = unchecked.back();
+            unchecked.pop_back();
+
+            uint nb = neighbours[t][0];
+            if (nb == NO_NEIGHBOUR)
+                continue;
+
+            uint u = corners[t][0], v = corners[t][1];
+            uint f = edgeIndex(nb, v, u);
+            uint q = corners[nb][(f + 2) % 3];
+
+            const std::array<uint, 3> &c_t = corners[t];
+            if (!inCircumcircle(precisePosition(c_t[0]), precisePosition(c_t[1]), precisePosition(c_t[2]), precisePosition(q)))
+                continue;
+
+            uint n_vp = neighbours[t][1], n_pu = neighbours[t][2];
+            uint n_uq = neighbours[nb][(f + 1) % 3], n_qv = neighbours[nb][(f + 2) % 3];
+
+            setTriangle(t, u, q, node, n_uq, nb, n_pu);
+            setTriangle(nb, q, v, node, n_qv, n_vp, t);
+            replaceNeighbour(n_vp, t, nb);
+            replaceNeighbour(n_uq, nb, t);
+
+            insertion.removed_edges.push_back(std::make_pair(u, v));
+            insertion.added_edges.push_back(std::make_pair(node, q));
+            insertion.changed_triangles.push_back(t);
+            insertion.changed_triangles.push_back(nb);
+
+            unchecked.push_back(t);
+            unchecked.push_back(nb);
+        }
+
+        inserted_triangles.insert(inserted_triangles.end(), insertion.changed_triangles.begin(), insertion.changed_triangles.end());
+
+        return true;
+    }
+
+    /**
+     * Center of the circumcircle of a triangle on the unit sphere.
+     */
+    Math::Vec3 circumcenter(uint t) const
+    {
+        Math::Vec3 a = position(corners[t][0]);
+        Math::Vec3 b = position(corners[t][1]);
+        Math::Vec3 c = position(corners[t][2]);
+
+        double ab[3] = {(double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z};
+        double ac[3] = {(double)c.x - a.x, (double)c.y - a.y, (double)c.z - a.z};
+        double n[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+        double n_length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        if (n_length == 0.0)
+            return a;
+
+        return Math::Vec3((float)(n[0] / n_length), (float)(n[1] / n_length), (float)(n[2] / n_length));
+    }
+
+    /**
+     * Position of a node on the unit sphere.
+     */
+    Math::Vec3 position(uint node) const
+    {
+        return geoToCartesian(lon_lat[node].x, lon_lat[node].y);
+    }
+
+    /**
+     * Position of a node on the unit sphere in double precision, as needed by inCircumcircle.
+     */
+    std::array<double, 3> precisePosition(uint node) const
+    {
+        return geoToCartesian64(lon_lat[node].x, lon_lat[node].y);
+    }
+
+    static Math::Vec3 geoToCartesian(float lon, float lat)
+    {
+        float lat_sin = sin((PI / 180.0f) * lat);
+        float lon_sin = sin((PI / 180.0f) * lon);
+
+        float lat_cos = cos((PI / 180.0f) * lat);
+        float lon_cos = cos((PI / 180.0f) * lon);
+
+        return Math::Vec3(lon_sin * lat_cos, lat_sin, lat_cos * lon_cos);
+    }
+
+    static std::array<double, 3> geoToCartesian64(double lon, double lat)
+    {
+        const double deg_to_rad = 0.017453292519943295769236907684886;
+
+        double lat_cos = std::cos(deg_to_rad * lat);
+        std::array<double, 3> p = {{std::sin(deg_to_rad * lon) * lat_cos, std::sin(deg_to_rad * lat), lat_cos * std::cos(deg_to_rad * lon)}};
+        return p;
+    }
+
+    /**
+     * True if p lies strictly inside the circumcircle of the counter-clockwise triangle a, b, c on the unit sphere,
+     * i.e. on the outer side of the plane through its corners. Float positions are off the sphere by up to 6e-8,
+     * far more than the plane distance of nearby nodes, hence the test needs positions computed in double precision.
+     * Nodes closer to the plane than the rounding error of the positions count as cocircular.
+     */
+    static bool inCircumcircle(const std::array<double, 3> &a, const std::array<double, 3> &b, const std::array<double, 3> &c,
+                               const std::array<double, 3> &p)
+    {
+        double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        double ap[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+        double n[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+
+        // A position error of e changes the result by at most about 3 * e * (longest difference)^2
+        double max_squared_length = std::max(ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2],
+                                             std::max(ac[0] * ac[0] + ac[1] * ac[1] + ac[2] * ac[2], ap[0] * ap[0] + ap[1] * ap[1] + ap[2] * ap[2]));
+        double tolerance = 16.0 * std::numeric_limits<double>::epsilon() * max_squared_length;
+
+        return ap[0] * n[0] + ap[1] * n[1] + ap[2] * n[2] > tolerance;
+    }
+
+private:
+    /**
+     * Determinant of a, b and c. Positive if c lies left of the great circle from a to b seen from outside.
+     * Evaluated in double precision, the float positions of neighbouring nodes in street graphs are very close.
+     */
+    static double orientation(const Math::Vec3 &a, const Math::Vec3 &b, const Math::Vec3 &c)
+    {
+        double bc_x = (double)b.y * c.z - (double)b.z * c.y;
+        double bc_y = (double)b.z * c.x - (double)b.x * c.z;
+        double bc_z = (double)b.x * c.y - (double)b.y * c.x;
+
+        return a.x * bc_x + a.y * bc_y + a.z * bc_z;
+    }
+
+    /**
+     * Index of the edge from corner a to corner b in triangle t.
+     */
+    uint edgeIndex(uint t, uint a, uint b) const
+    {
+        for (uint i = 0; i < 3; i++)
+        {
+            if (corners[t][i] == a && corners[t][(i + 1) % 3] == b)
+                return i;
+        }
+
+        assert(false);
+        return 0;
+    }
+
+    void setTriangle(uint t, uint a, uint b, uint c, uint n_ab, uint n_bc, uint n_ca)
+    {
+        corners[t] = {{a, b, c}};
+        neighbours[t] = {{n_ab, n_bc, n_ca}};
+    }
+
+    void addTriangle(uint a, uint b, uint c, uint n_ab, uint n_bc, uint n_ca, uint parent, Insertion &insertion)
+    {
+        corners.push_back({{a, b, c}});
+        neighbours.push_back({{n_ab, n_bc, n_ca}});
+        insertion.parent_triangles.push_back(parent);
+    }
+
+    void replaceNeighbour(uint t, uint old_neighbour, uint new_neighbour)
+    {
+        if (t == NO_NEIGHBOUR)
+            return;
+
+        for (uint i = 0; i < 3; i++)
+        {
+            if (neighbours[t][i] == old_neighbour)
+                neighbours[t][i] = new_neighbour;
+        }
+    }
+
+    /**
+     * Remembering stochastic walk from the given start triangle towards the point p on the unit sphere.
+     * Each step tests the edges in a pseudo-random order, except the one it came through, and crosses the first edge
+     * the point lies behind. Unlike always crossing the edge the point lies furthest behind, this also terminates
+     * on triangulations that are not Delaunay.
+     * \return Index of the triangle containing p, -1 if the walk left the mesh through a border edge,
+     *         -2 if it visited more triangles than the mesh has, which only happens on folded meshes
+     */
+    int walk(const Math::Vec3 &p, uint start) const
+    {
+        uint t = start;
+        uint came_from = NO_NEIGHBOUR;
+        uint32_t random_state = start * 2654435761u + 1u;
+
+        std::array<uint, 3> previous_c = {{NO_NEIGHBOUR, NO_NEIGHBOUR, NO_NEIGHBOUR}};
+        std::array<Math::Vec3, 3> previous_positions;
+        for (size_t step = 0; step < corners.size(); step++)
+        {
+            const std::array<uint, 3> &c = corners[t];
+
+            // Two corners are shared with the previous triangle, only the third position needs to be computed
+            std::array<Math::Vec3, 3> c_positions;
+            for (uint i = 0; i < 3; i++)
+            {
+                size_t shared = std::find(previous_c.begin(), previous_c.end(), c[i]) - previous_c.begin();
+                c_positions[i] = (shared < 3) ? previous_positions[shared] : position(c[i]);
+            }
+            previous_c = c;
+            previous_positions = c_positions;
+
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 17;
+            random_state ^= random_state << 5;
+
+            uint exit_edge = 3;
+            for (uint k = 0; k < 3 && exit_edge == 3; k++)
+            {
+                uint i = (random_state + k) % 3;
+                if (neighbours[t][i] != came_from && orientation(c_positions[i], c_positions[(i + 1) % 3], p) < 0.0)
+                    exit_edge = i;
+            }
+
+            if (exit_edge == 3)
+                return contains(c_positions, p) ? (int)t : -1;
+
+            if (neighbours[t][exit_edge] == NO_NEIGHBOUR)
+                return -1;
+
+            came_from = t;
+            t = neighbours[t][exit_edge];
+        }
+
+        return -2;
+    }
+
+    bool contains(uint t, const Math::Vec3 &p) const
+    {
+        std::array<Math::Vec3, 3> c_positions = {{position(corners[t][0]), position(corners[t][1]), position(corners[t][2])}};
+        return contains(c_positions, p);
+    }
+
+    static bool contains(const std::array<Math::Vec3, 3> &c_positions, const Math::Vec3 &p)
+    {
+        const Math::Vec3 &a = c_positions[0];
+        const Math::Vec3 &b = c_positions[1];
+        const Math::Vec3 &c = c_positions[2];
+
+        // The edge tests alone would also accept the antipode of a point inside the triangle's complement
+        return orientation(a, b, p) >= 0.0 && orientation(b, c, p) >= 0.0 && orientation(c, a, p) >= 0.0 &&
+               Math::dot64(p, Math::Vec3(a.x + b.x + c.x, a.y + b.y + c.y, a.z + b.z + c.z)) > 0.0;
+    }
+
+    uint cellX(float lon) const
+    {
+        return (uint)std::max(0, std::min((int)((lon - min_lon) / cell_lon), (int)grid_width - 1));
+    }
+
+    uint cellY(float lat) const
+    {
+        return (uint)std::max(0, std::min((int)((lat - min_lat) / cell_lat), (int)grid_height - 1));
+    }
+
+    /**
+     * Call function(cell) for each grid cell overlapped by the bounding box of triangle t. The box is padded by
+     * a cell to absorb the rounding of the positions.
+     * \return False if the triangle spans the antimeridian or contains a pole, its mean longitude is meaningless then
+     */
+    template <typename Function>
+    bool forOverlappedCells(const GraphStore &graph, uint t, Function function) const
+    {
+        float t_min_lon = 180.0f, t_max_lon = -180.0f, t_min_lat = 90.0f, t_max_lat = -90.0f;
+        for (uint i = 0; i < 3; i++)
+        {
+            t_min_lon = std::min(t_min_lon, graph.longitudes[corners[t][i]]);
+            t_max_lon = std::max(t_max_lon, graph.longitudes[corners[t][i]]);
+            t_min_lat = std::min(t_min_lat, graph.latitudes[corners[t][i]]);
+            t_max_lat = std::max(t_max_lat, graph.latitudes[corners[t][i]]);
+        }
+
+        // Edges bulge towards the poles by less than half their length
+        float max_edge_length = 0.0f;
+        for (uint i = 0; i < 3; i++)
+        {
+            Math::Vec3 corner = position(corners[t][i]);
+            Math::Vec3 edge = corner - position(corners[t][(i + 1) % 3]);
+            max_edge_length = std::max(max_edge_length, 2.0f * std::asin(std::min(0.5f * edge.length(), 1.0f)) * 180.0f / PI);
+        }
+        t_min_lat -= 0.5f * max_edge_length;
+        t_max_lat += 0.5f * max_edge_length;
+
+        bool contains_pole = false;
+        if (contains(t, Math::Vec3(0.0f, 1.0f, 0.0f)))
+        {
+            t_max_lat = 90.0f;
+            contains_pole = true;
+        }
+        if (contains(t, Math::Vec3(0.0f, -1.0f, 0.0f)))
+        {
+            t_min_lat = -90.0f;
+            contains_pole = true;
+        }
+
+        // Triangles spanning the antimeridian cover the columns from their eastern corners to 180 degrees
+        // and from -180 degrees to their western corners
+        bool spans_antimeridian = (t_max_lon - t_min_lon >= 180.0f);
+        float east_lon = 180.0f, west_lon = -180.0f;
+        for (uint i = 0; i < 3 && spans_antimeridian; i++)
+        {
+            float lon = graph.longitudes[corners[t][i]];
+            if (lon < 0.0f)
+                west_lon = std::max(west_lon, lon);
+            else
+                east_lon = std::min(east_lon, lon);
+        }
+
+        // Up to two ranges of columns, the second one is empty unless the triangle spans the antimeridian
+        std::array<std::pair<uint, uint>, 2> columns = {{std::make_pair(cellX(t_min_lon - cell_lon), cellX(t_max_lon + cell_lon)), std::make_pair(1u, 0u)}};
+        if (contains_pole)
+            columns[0] = std::make_pair(0u, grid_width - 1);
+        else if (spans_antimeridian)
+            columns = {{std::make_pair(0u, cellX(west_lon + cell_lon)), std::make_pair(cellX(east_lon - cell_lon), grid_width - 1)}};
+
+        for (uint y = cellY(t_min_lat - cell_lat); y <= cellY(t_max_lat + cell_lat); y++)
+        {
+            for (auto &range : columns)
+            {
+                for (uint x = range.first; x <= range.second; x++)
+                    function(y * grid_width + x);
+            }
+        }
+
+        return !contains_pole && !spans_antimeridian;
+    }
+
+    /**
+     * Bin triangle centroids into a grid with about two triangles per cell, empty cells copy the start triangle
+     * of the closest filled cell. Cells overlapped by a triangle are marked as covered and cells overlapped by
+     * a triangle at the border of the mesh keep a list of all triangles overlapping them.
+     * Insertions only subdivide covered areas, thus both stay valid.
+     */
+    void buildGrid(const GraphStore &graph)
+    {
+        if (corners.empty())
+            return;
+
+        float max_lon = -180.0f, max_lat = -90.0f;
+        min_lon = 180.0f;
+        min_lat = 90.0f;
+        for (size_t i = 0; i < graph.nodeCount(); i++)
+        {
+            min_lon = std::min(min_lon, graph.longitudes[i]);
+            min_lat = std::min(min_lat, graph.latitudes[i]);
+            max_lon = std::max(max_lon, graph.longitudes[i]);
+            max_lat = std::max(max_lat, graph.latitudes[i]);
+        }
+
+        grid_width = std::max(1u, std::min(2048u, (uint)std::sqrt(corners.size() / 2.0)));
+        grid_height = grid_width;
+        cell_lon = std::max((max_lon - min_lon) / grid_width, 1e-6f);
+        cell_lat = std::max((max_lat - min_lat) / grid_height, 1e-6f);
+
+        grid.assign(grid_width * grid_height, NO_NEIGHBOUR);
+        covered_cells.assign(grid_width * grid_height, false);
+        std::vector<bool> on_border(grid_width * grid_height, false);
+        for (uint t = 0; t < corners.size(); t++)
+        {
+            const std::array<uint, 3> &n = neighbours[t];
+            bool is_border_triangle = (n[0] == NO_NEIGHBOUR || n[1] == NO_NEIGHBOUR || n[2] == NO_NEIGHBOUR);
+
+            auto markCell = [this, &on_border, is_border_triangle](uint cell) {
+                covered_cells[cell] = true;
+                if (is_border_triangle)
+                    on_border[cell] = true;
+            };
+            if (!forOverlappedCells(graph, t, markCell))
+                continue;
+
+            float lon = 0.0f, lat = 0.0f;
+            for (uint i = 0; i < 3; i++)
+            {
+                lon += graph.longitudes[corners[t][i]] / 3.0f;
+                lat += graph.latitudes[corners[t][i]] / 3.0f;
+            }
+            grid[cellY(lat) * grid_width + cellX(lon)] = t;
+        }
+
+        // Counting sort of the triangles overlapping border cells
+        std::vector<uint> border_index(grid.size(), NO_NEIGHBOUR);
+        border_cells.clear();
+        for (uint cell = 0; cell < grid.size(); cell++)
+        {
+            if (on_border[cell])
+            {
+                border_index[cell] = (uint)border_cells.size();
+                border_cells.push_back(cell);
+            }
+        }
+
+        border_cell_start.assign(border_cells.size() + 1, 0);
+        for (uint t = 0; t < corners.size(); t++)
+        {
+            forOverlappedCells(graph, t, [this, &border_index](uint cell) {
+                if (border_index[cell] != NO_NEIGHBOUR)
+                    border_cell_start[border_index[cell] + 1]++;
+            });
+        }
+
+        for (uint i = 1; i < border_cell_start.size(); i++)
+            border_cell_start[i] += border_cell_start[i - 1];
+
+        std::vector<uint> fill(border_cell_start.begin(), border_cell_start.end() - 1);
+        border_cell_triangles.resize(border_cell_start.back());
+        for (uint t = 0; t < corners.size(); t++)
+        {
+            forOverlappedCells(graph, t, [this, &border_index, &fill, t](uint cell) {
+                if (border_index[cell] != NO_NEIGHBOUR)
+                    border_cell_triangles[fill[border_index[cell]]++] = t;
+            });
+        }
+
+        // Breadth-first search from all filled cells, each empty cell is reached from a closest filled cell
+        std::vector<uint> queue;
+        queue.reserve(grid.size());
+        for (uint i = 0; i < grid.size(); i++)
+        {
+            if (grid[i] != NO_NEIGHBOUR)
+                queue.push_back(i);
+        }
+
+        if (queue.empty())
+        {
+            grid.assign(grid.size(), 0);
+            return;
+        }
+
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            uint x = queue[i] % grid_width;
+            uint y = queue[i] / grid_width;
+            uint adjacent[4] = {(x > 0) ? queue[i] - 1 : queue[i], (x + 1 < grid_width) ? queue[i] + 1 : queue[i],
+                                (y > 0) ? queue[i] - grid_width : queue[i], (y + 1 < grid_height) ? queue[i] + grid_width : queue[i]};
+            for (uint cell : adjacent)
+            {
+                if (grid[cell] == NO_NEIGHBOUR)
+                {
+                    grid[cell] = grid[queue[i]];
+                    queue.push_back(cell);
+                }
+            }
+        }
+    }
+};
+
+constexpr uint TriangleLocator::NO_NEIGHBOUR;
+
+/**
+ * Checks the empty circumcircle property of a spherical triangulation.
+ * The circumcircle of a triangle on the sphere is the intersection of the sphere with the plane through its corners,
+ * a node violates the property if it lies on the outer side of that plane. Candidate nodes are taken from a lat/lon
+ * grid of all nodes covering the bounding box of the circumcircle, triangles are checked in parallel.
+ */
+struct DelaunayValidator
+{
+    DelaunayValidator(const TriangleLocator &mesh) : mesh(mesh), grid_width(0), grid_height(0), min_lon(0.0f), min_lat(0.0f), cell_lon(1.0f), cell_lat(1.0f) {}
+
+    const TriangleLocator &mesh;
+
+    /* Nodes sorted by grid cell, the nodes of cell i are cell_nodes[cell_start[i]] to cell_nodes[cell_start[i+1]-1] */
+    std::vector<uint> cell_start;
+    std::vector<uint> cell_nodes;
+    uint grid_width;
+    uint grid_height;
+    float min_lon;
+    float min_lat;
+    float cell_lon;
+    float cell_lat;
+
+    /**
+     * Collect the indices of all triangles whose circumcircle contains another node.
+     */
+    void findViolations(std::vector<uint> &violating_triangles, uint num_threads = 0)
+    {
+        buildGrid();
+
+        std::vector<unsigned char> violates(mesh.size(), 0);
+
+        auto checkRange = [this, &violates](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++)
+                violates[t] = isViolated((uint)t) ? 1 : 0;
+        };
+        parallelFor(mesh.size(), checkRange, num_threads);
+
+        violating_triangles.clear();
+        for (uint t = 0; t < violates.size(); t++)
+        {
+            if (violates[t])
+                violating_triangles.push_back(t);
+        }
+    }
+
+private:
+    static float latitude(const Math::Vec3 &p)
+    {
+        return (180.0f * std::asin(std::max(-1.0f, std::min(p.y, 1.0f)))) / PI;
+    }
+
+    static float longitude(const Math::Vec3 &p)
+    {
+        return (180.0f * std::atan2(p.x, p.z)) / PI;
+    }
+
+    /**
+     * Counting sort of all nodes into a grid over their bounding box with about two nodes per cell.
+     */
+    void buildGrid()
+    {
+        const std::vector<Math::Vec2> &lon_lat = mesh.lon_lat;
+
+        std::vector<uint> node_cells(lon_lat.size());
+
+        float max_lon = -180.0f, max_lat = -90.0f;
+        min_lon = 180.0f;
+        min_lat = 90.0f;
+        for (auto &p : lon_lat)
+        {
+            min_lon = std::min(min_lon, p.x);
+            min_lat = std::min(min_lat, p.y);
+            max_lon = std::max(max_lon, p.x);
+            max_lat = std::max(max_lat, p.y);
+        }
+
+        grid_width = std::max(1u, std::min(4096u, (uint)std::sqrt(lon_lat.size() / 2.0)));
+        grid_height = grid_width;
+        cell_lon = std::max((max_lon - min_lon) / grid_width, 1e-6f);
+        cell_lat = std::max((max_lat - min_lat) / grid_height, 1e-6f);
+
+        cell_start.assign(grid_width * grid_height + 1, 0);
+        for (uint i = 0; i < lon_lat.size(); i++)
+        {
+            node_cells[i] = cellX(lon_lat[i].x) + cellY(lon_lat[i].y) * grid_width;
+            cell_start[node_cells[i] + 1]++;
+        }
+
+        for (uint i = 1; i < cell_start.size(); i++)
+            cell_start[i] += cell_start[i - 1];
+
+        std::vector<uint> fill(cell_start.begin(), cell_start.end() - 1);
+        cell_nodes.resize(lon_lat.size());
+        for (uint i = 0; i < lon_lat.size(); i++)
+            cell_nodes[fill[node_cells[i]]++] = i;
+    }
+
+    uint cellX(float lon) const
+    {
+        return (uint)std::max(0, std::min((int)((lon - min_lon) / cell_lon), (int)grid_width - 1));
+    }
+
+    uint cellY(float lat) const
+    {
+        return (uint)std::max(0, std::min((int)((lat - min_lat) / cell_lat), (int)grid_height - 1));
+    }
+
+    bool isViolated(uint t) const
+    {
+        const std::array<uint, 3> &c = mesh.corners[t];
+        Math::Vec3 a = mesh.position(c[0]);
+        Math::Vec3 b = mesh.position(c[1]);
+        Math::Vec3 d = mesh.position(c[2]);
+
+        // Plane through the corners, the normal points away from the sphere center for counter-clockwise triangles
+        double ab[3] = {(double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z};
+        double ad[3] = {(double)d.x - a.x, (double)d.y - a.y, (double)d.z - a.z};
+        double n[3] = {ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0]};
+        double n_length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (n_length == 0.0)
+            return false;
+
+        // Circumcircle center on the sphere and its angular radius
+        Math::Vec3 center((float)(n[0] / n_length), (float)(n[1] / n_length), (float)(n[2] / n_length));
+        double cos_radius = std::max(-1.0, std::min(Math::dot64(center, a), 1.0));
+        float radius = (180.0f / PI) * (float)std::acos(cos_radius);
+
+        float center_lat = latitude(center);
+        float center_lon = longitude(center);
+
+        uint x_begin = 0, x_end = grid_width - 1;
+        uint y_begin = cellY(center_lat - radius - cell_lat);
+        uint y_end = cellY(center_lat + radius + cell_lat);
+
+        // Near the poles or across the antimeridian the circle covers all longitudes of the grid
+        float lat_extent = std::abs(center_lat) + radius;
+        if (lat_extent < 89.0f)
+        {
+            float lon_radius = (180.0f / PI) * std::asin(std::min(1.0f, std::sin(radius * PI / 180.0f) / std::cos(center_lat * PI / 180.0f)));
+            if (center_lon - lon_radius > -180.0f && center_lon + lon_radius < 180.0f)
+            {
+                x_begin = cellX(center_lon - lon_radius - cell_lon);
+                x_end = cellX(center_lon + lon_radius + cell_lon);
+            }
+        }
+
+        std::array<std::array<double, 3>, 3> c_positions = {{mesh.precisePosition(c[0]), mesh.precisePosition(c[1]), mesh.precisePosition(c[2])}};
+        for (uint y = y_begin; y <= y_end; y++)
+        {
+            for (uint x = x_begin; x <= x_end; x++)
+            {
+                uint cell = y * grid_width + x;
+                for (uint i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+                {
+                    uint node = cell_nodes[i];
+                    if (node == c[0] || node == c[1] || node == c[2])
+                        continue;
+
+                    if (TriangleLocator::inCircumcircle(c_positions[0], c_positions[1], c_positions[2], mesh.precisePosition(node)))
+                        return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+/**
+ * A graph specifically made to display nodes, edges and triangles of a triangulation of a sphere surface.
+ */
+struct TriangleGraph
+{
+    TriangleGraph()
+        : triangle_prgm_handle(0), nodeEdge_prgm_handle(0), num_nodes(0),
+          num_edges(0), num_triangles(0), node_va_handle(0), node_vbo_handle(0), node_ibo_handle(0),
+          edge_va_handle(0), edge_vbo_handle(0), edge_ibo_handle(0),
+          triangle_va_handle(0), triangle_ibo_handle(0), triangle_colour_handle(0), triangle_colour_tx_handle(0),
+          show_sphere(false),
+          num_sphere_indices(0), sphere_world_position(1.0f, 0.0f, 0.0f), sphere_scale(1.0f), sphere_target_scale(1.0f),
+          sphere(4), has_translucent_triangles(false), oit_fbo_handle(0), oit_accum_colour_handle(0), oit_accum_weight_handle(0),
+          oit_opaque_colour_handle(0), oit_depth_buffer_handle(0), oit_width(0), oit_height(0), oit_va_handle(0),
+          node_capacity(0), edge_capacity(0), triangle_capacity(0),
+          show_voronoi(false), voronoi_outdated(true), num_voronoi_edges(0), voronoi_va_handle(0), voronoi_vbo_handle(0), voronoi_ibo_handle(0)
+    {
+        // Create shader programs
+        triangle_prgm_handle = createShaderProgram("../src/triangleGraph_triangle_v.glsl", "../src/triangleGraph_triangle_f.glsl", {"v_geoCoords"});
+        nodeEdge_prgm_handle = createShaderProgram("../src/triangleGraph_nodeEdge_v.glsl", "../src/triangleGraph_nodeEdge_f.glsl", {"v_geoCoords", "v_colour"});
+        sphere_prgm_handle = createShaderProgram("../src/triangleGraph_sphere_v.glsl", "../src/triangleGraph_sphere_f.glsl", {"v_position"});
+        oit_prgm_handle = createShaderProgram("../src/triangleGraph_triangle_v.glsl", "../src/triangleGraph_oit_f.glsl", {"v_geoCoords"});
+        composite_prgm_handle = createShaderProgram("../src/triangleGraph_composite_v.glsl", "../src/triangleGraph_composite_f.glsl", {});
+
+        // The fullscreen composite pass generates its vertices in the shader, but still needs a vertex array bound
+        glGenVertexArrays(1, &oit_va_handle);
+    }
+    TriangleGraph(const TriangleGraph &) = delete;
+    ~TriangleGraph()
+    {
+        if (node_va_handle != 0)
+        {
+            // delete mesh resources
+            glBindVertexArray(node_va_handle);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
             glDeleteBuffers(1, &node_ibo_handle);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -1695,1006 +5647,2983 @@ struct TriangleGraph
             glDeleteVertexArrays(1, &node_va_handle);
         }
 
-        if (edge_va_handle != 0)
+        if (edge_va_handle != 0)
+        {
+            // delete mesh resources
+            glBindVertexArray(edge_va_handle);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &edge_ibo_handle);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &edge_vbo_handle);
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &edge_va_handle);
+        }
+
+        if (triangle_va_handle != 0)
+        {
+            // delete mesh resources
+            glBindVertexArray(triangle_va_handle);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &triangle_ibo_handle);
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &triangle_va_handle);
+            glDeleteTextures(1, &triangle_colour_tx_handle);
+            glDeleteBuffers(1, &triangle_colour_handle);
+        }
+
+        // delete order-independent transparency resources
+        if (oit_fbo_handle != 0)
+        {
+            glDeleteFramebuffers(1, &oit_fbo_handle);
+            glDeleteTextures(1, &oit_accum_colour_handle);
+            glDeleteTextures(1, &oit_accum_weight_handle);
+            glDeleteTextures(1, &oit_opaque_colour_handle);
+            glDeleteRenderbuffers(1, &oit_depth_buffer_handle);
+        }
+        glDeleteVertexArrays(1, &oit_va_handle);
+
+        if (voronoi_va_handle != 0)
+        {
+            // delete mesh resources
+            glBindVertexArray(voronoi_va_handle);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &voronoi_ibo_handle);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &voronoi_vbo_handle);
+            glBindVertexArray(0);
+            glDeleteVertexArrays(1, &voronoi_va_handle);
+        }
+
+        // delete shader program
+        glDeleteProgram(triangle_prgm_handle);
+        glDeleteProgram(nodeEdge_prgm_handle);
+        glDeleteProgram(sphere_prgm_handle);
+        glDeleteProgram(oit_prgm_handle);
+        glDeleteProgram(composite_prgm_handle);
+    }
+
+    GLuint triangle_prgm_handle;
+    GLuint nodeEdge_prgm_handle;
+    GLuint sphere_prgm_handle;
+    GLuint oit_prgm_handle;
+    GLuint composite_prgm_handle;
+
+    size_t num_nodes;
+    size_t num_edges;
+    size_t num_triangles;
+
+    GLuint node_va_handle;
+    GLuint node_vbo_handle;
+    GLuint node_ibo_handle;
+
+    GLuint edge_va_handle;
+    GLuint edge_vbo_handle;
+    GLuint edge_ibo_handle;
+
+    /* Triangles share the node vertex buffer, their colours are fetched per primitive from a buffer texture */
+    GLuint triangle_va_handle;
+    GLuint triangle_ibo_handle;
+    GLuint triangle_colour_handle;
+    GLuint triangle_colour_tx_handle;
+
+    bool show_sphere;
+    uint num_sphere_indices;
+    Math::Vec3 sphere_world_position;
+    float sphere_scale;
+    float sphere_target_scale;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_0;
+    std::chrono::time_point<std::chrono::high_resolution_clock> t_1;
+
+    IcoSphere sphere;
+
+    /* Set if any triangle of the loaded graph comes with an alpha value below 255 */
+    bool has_translucent_triangles;
+
+    /* Render targets for weighted blended order-independent transparency.
+     * Accumulated colour (rgb) and revealage (a), accumulated weight and the opaque nodes and edges
+     * share a single depth buffer, so that triangles hidden behind nodes and edges are discarded.
+     */
+    GLuint oit_fbo_handle;
+    GLuint oit_accum_colour_handle;
+    GLuint oit_accum_weight_handle;
+    GLuint oit_opaque_colour_handle;
+    GLuint oit_depth_buffer_handle;
+    int oit_width;
+    int oit_height;
+    GLuint oit_va_handle;
+
+    /* Number of nodes, edges and triangles the buffers have room for, grown when inserting nodes */
+    size_t node_capacity;
+    size_t edge_capacity;
+    size_t triangle_capacity;
+
+    /* Colour of each node and of each triangle as in the GPU buffers, the locator keeps the geo coordinates of the nodes */
+    std::vector<Colour_RGBA> node_colours;
+    std::vector<Colour_RGBA> triangle_colours;
+
+    /* Node indices of each edge and, built on the first insertion, the edge slot for each pair of nodes */
+    std::vector<uint> edge_endpoints;
+    std::unordered_map<uint64_t, uint> edge_slots;
+
+    /* Voronoi diagram dual to the triangulation, built when shown */
+    bool show_voronoi;
+    bool voronoi_outdated;
+    size_t num_voronoi_edges;
+    GLuint voronoi_va_handle;
+    GLuint voronoi_vbo_handle;
+    GLuint voronoi_ibo_handle;
+
+    /* Finds the triangle under the cursor when clicking, also used for sphere creation */
+    TriangleLocator locator;
+
+    /* Changes of the last node insertion, kept to reuse its memory */
+    TriangleLocator::Insertion insertion;
+
+    /**
+     * Upload a graph to the GPU. Takes ownership of the graph data and releases it once it is uploaded,
+     * only the compact TriangleLocator (float geo coordinates and uint32 triangle corners and neighbours),
+     * the node and triangle colours and the edge endpoints are kept on the CPU.
+     */
+    void loadGraphData(GraphStore &&input_graph)
+    {
+        GraphStore graph(std::move(input_graph));
+
+        optimizeMeshOrder(graph);
+
+        num_nodes = graph.nodeCount();
+        num_edges = graph.edgeCount();
+        num_triangles = graph.triangleCount();
+
+        node_capacity = num_nodes;
+        edge_capacity = num_edges;
+        triangle_capacity = num_triangles;
+        voronoi_outdated = true;
+
+        edge_endpoints.clear();
+        edge_endpoints.reserve(num_edges * 2);
+        for (size_t i = 0; i < num_edges; i++)
+        {
+            edge_endpoints.push_back(graph.sources[i]);
+            edge_endpoints.push_back(graph.targets[i]);
+        }
+        edge_slots.clear();
+        triangle_colours.clear();
+
+        locator.build(graph);
+
+        //////////
+        // Nodes
+        //////////
+
+        std::vector<Vertex_RGB> node_vertices;
+        std::vector<uint> node_indices;
+
+        // At least as many vertices as there are nodes are required
+        node_vertices.reserve(num_nodes);
+
+        // Each edge contributes two indices
+        node_indices.reserve(num_nodes);
+
+        // Copy geo coordinates from input nodes to vertices
+        uint index_counter = 0;
+        for (size_t i = 0; i < num_nodes; i++)
+        {
+            const Colour_RGBA &colour = graph.node_colours[i];
+            node_vertices.push_back(Vertex_RGB(graph.longitudes[i], graph.latitudes[i], colour.r, colour.g, colour.b, colour.a));
+
+            node_indices.push_back(index_counter++);
+        }
+        node_colours = std::move(graph.node_colours);
+
+        // Allocate GPU memory and send data
+        if (node_vertices.size() < 1 || node_indices.size() < 1)
+            return;
+
+        auto va_size = sizeof(Vertex_RGB) * node_vertices.size();
+        auto vi_size = sizeof(uint) * node_indices.size();
+
+        if (node_va_handle == 0 || node_vbo_handle == 0 || node_ibo_handle == 0)
+        {
+            glGenVertexArrays(1, &node_va_handle);
+            glGenBuffers(1, &node_vbo_handle);
+            glGenBuffers(1, &node_ibo_handle);
+        }
+
+        glBindVertexArray(node_va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, va_size, node_vertices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node_ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, node_indices.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(node_va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        std::vector<Vertex_RGB>().swap(node_vertices);
+        std::vector<uint>().swap(node_indices);
+
+        //////////
+        // Edges
+        //////////
+
+        std::vector<Vertex_RGB> edge_vertices;
+        std::vector<uint> edge_indices;
+
+        // Each edge has its own two vertices, as its colour is stored per vertex
+        edge_vertices.reserve(num_edges * 2);
+
+        // Each edge contributes two indices
+        edge_indices.reserve(num_edges * 2);
+
+        index_counter = 0;
+        for (size_t i = 0; i < num_edges; i++)
+        {
+            uint source = graph.sources[i];
+            uint target = graph.targets[i];
+            const Colour_RGBA &colour = graph.edge_colours[i];
+            edge_vertices.push_back(Vertex_RGB(graph.longitudes[source], graph.latitudes[source], colour.r, colour.g, colour.b, colour.a));
+            edge_vertices.push_back(Vertex_RGB(graph.longitudes[target], graph.latitudes[target], colour.r, colour.g, colour.b, colour.a));
+
+            edge_indices.push_back(index_counter++);
+            edge_indices.push_back(index_counter++);
+
+            // TODO could be possible to optimize by finding vertices of the same color
+        }
+
+        // Allocate GPU memory and send data
+        if (edge_vertices.size() < 1 || edge_indices.size() < 1)
+            return;
+
+        va_size = sizeof(Vertex_RGB) * edge_vertices.size();
+        vi_size = sizeof(uint) * edge_indices.size();
+
+        if (edge_va_handle == 0 || edge_vbo_handle == 0 || edge_ibo_handle == 0)
+        {
+            glGenVertexArrays(1, &edge_va_handle);
+            glGenBuffers(1, &edge_vbo_handle);
+            glGenBuffers(1, &edge_ibo_handle);
+        }
+
+        glBindVertexArray(edge_va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, edge_vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, va_size, edge_vertices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, edge_indices.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(edge_va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, edge_vbo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        std::vector<Vertex_RGB>().swap(edge_vertices);
+        std::vector<uint>().swap(edge_indices);
+        std::vector<uint32_t>().swap(graph.sources);
+        std::vector<uint32_t>().swap(graph.targets);
+        std::vector<Colour_RGBA>().swap(graph.edge_colours);
+
+        //////////////
+        // Triangles
+        //////////////
+
+        // Triangles index the node vertices, only their colour is stored per triangle
+        has_translucent_triangles = false;
+        for (auto &colour : graph.triangle_colours)
+            has_translucent_triangles |= (static_cast<unsigned char>(colour.a) < 255);
+
+        // Allocate GPU memory and send data
+        if (graph.triangle_colours.size() < 1 || graph.triangle_corners.size() < 1)
+            return;
+
+        if (triangle_va_handle == 0 || triangle_ibo_handle == 0 || triangle_colour_handle == 0)
+        {
+            glGenVertexArrays(1, &triangle_va_handle);
+            glGenBuffers(1, &triangle_ibo_handle);
+            glGenBuffers(1, &triangle_colour_handle);
+            glGenTextures(1, &triangle_colour_tx_handle);
+        }
+
+        glBindVertexArray(triangle_va_handle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * graph.triangle_corners.size(), graph.triangle_corners.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, triangle_colour_handle);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(Colour_RGBA) * graph.triangle_colours.size(), graph.triangle_colours.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        attachTriangleColours();
+
+        triangle_colours = std::move(graph.triangle_colours);
+    }
+
+    /**
+     * Reorder triangles for post-transform vertex cache reuse and renumber nodes in the order the triangles
+     * first use them, see MeshOptimizer. Triangles are sorted along a Z-order curve over their centroids first,
+     * so that the chunks optimized in parallel are compact patches of the mesh.
+     */
+    static void optimizeMeshOrder(GraphStore &graph)
+    {
+        size_t triangle_cnt = graph.triangleCount();
+        if (triangle_cnt == 0)
+            return;
+
+#ifndef NVERBOSE
+        auto t_start = std::chrono::high_resolution_clock::now();
+        float acmr_before = MeshOptimizer::computeACMR(graph.triangle_corners, graph.nodeCount());
+#endif
+
+        std::vector<std::pair<uint32_t, uint>> spatial_order(triangle_cnt);
+        auto centroidRange = [&graph, &spatial_order](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++)
+            {
+                float lon = 0.0f, lat = 0.0f;
+                for (size_t i = 3 * t; i < 3 * t + 3; i++)
+                {
+                    lon += graph.longitudes[graph.triangle_corners[i]] / 3.0f;
+                    lat += graph.latitudes[graph.triangle_corners[i]] / 3.0f;
+                }
+                uint16_t x = (uint16_t)std::max(0.0f, std::min(65535.0f, (lon + 180.0f) * (65535.0f / 360.0f)));
+                uint16_t y = (uint16_t)std::max(0.0f, std::min(65535.0f, (lat + 90.0f) * (65535.0f / 180.0f)));
+                spatial_order[t] = std::make_pair(Math::mortonCode(x, y), (uint)t);
+            }
+        };
+        parallelFor(triangle_cnt, centroidRange);
+        parallelSort(spatial_order.begin(), spatial_order.end(), std::less<std::pair<uint32_t, uint>>());
+
+        std::vector<uint> triangle_order(triangle_cnt);
+        for (size_t t = 0; t < triangle_cnt; t++)
+            triangle_order[t] = spatial_order[t].second;
+        std::vector<std::pair<uint32_t, uint>>().swap(spatial_order);
+        graph.permuteTriangles(triangle_order);
+
+        std::vector<uint> indices(graph.triangle_corners);
+        std::vector<uint> cache_order = MeshOptimizer::optimizeVertexCache(indices);
+        graph.permuteTriangles(cache_order);
+
+        // Nodes in the order of their first use, nodes without triangles keep their relative order at the end
+        std::vector<uint> node_remap = MeshOptimizer::optimizeVertexFetch(indices, graph.nodeCount());
+        std::vector<uint> node_order(node_remap.size());
+        for (size_t n = 0; n < node_remap.size(); n++)
+            node_order[node_remap[n]] = (uint)n;
+        graph.permuteNodes(node_order);
+
+#ifndef NVERBOSE
+        auto t_end = std::chrono::high_resolution_clock::now();
+        std::cout << "Reordered " << triangle_cnt << " triangles in " << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count()
+                  << "ms, ACMR " << acmr_before << " -> " << MeshOptimizer::computeACMR(graph.triangle_corners, graph.nodeCount()) << std::endl;
+#endif
+    }
+
+    /**
+     * (Re-)Attach the triangle colour buffer to its buffer texture, required after the buffer was resized.
+     */
+    void attachTriangleColours()
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, triangle_colour_tx_handle);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, triangle_colour_handle);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    /**
+     * Draw nodes, edges and triangles. Opaque triangles are drawn in a single depth tested pass.
+     * Translucent triangles are drawn once into the weighted blended order-independent transparency
+     * targets and composited over the current framebuffer afterwards.
+     * \param triangle_transparency Alpha factor applied to all triangles
+     */
+    void draw(OrbitalCamera &camera, float triangle_transparency)
+    {
+        t_1 = std::chrono::high_resolution_clock::now();
+        float dt = std::chrono::duration_cast<std::chrono::duration<double>>(t_1 - t_0).count();
+        t_0 = std::chrono::high_resolution_clock::now();
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        if (triangle_transparency < 1.0f || has_translucent_triangles)
+        {
+            drawTransparent(camera, triangle_transparency);
+        }
+        else
+        {
+            drawTriangles(triangle_prgm_handle, camera, triangle_transparency);
+            drawNodesAndEdges(camera);
+        }
+
+        glEnable(GL_CULL_FACE);
+
+        if (show_sphere)
+        {
+            glUseProgram(sphere_prgm_handle);
+
+            sphere_scale = (sphere_scale < sphere_target_scale) ? (sphere_scale + sphere_target_scale * dt) : sphere_target_scale;
+
+            Math::Mat4x4 model_matrix;
+            model_matrix[0] = sphere_scale;
+            model_matrix[5] = sphere_scale;
+            model_matrix[10] = sphere_scale;
+            model_matrix[12] = sphere_world_position.x;
+            model_matrix[13] = sphere_world_position.y;
+            model_matrix[14] = sphere_world_position.z;
+            model_matrix[15] = 1.0f;
+
+            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "model_matrix"), 1, GL_FALSE, model_matrix.data.data());
+            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+
+            glCullFace(GL_FRONT);
+            sphere.draw(1);
+        }
+
+        glCullFace(GL_BACK);
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    void drawTriangles(GLuint prgm_handle, OrbitalCamera &camera, float triangle_transparency)
+    {
+        glUseProgram(prgm_handle);
+
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        glUniform1fv(glGetUniformLocation(prgm_handle, "transparency"), 1, &triangle_transparency);
+        glUniform1fv(glGetUniformLocation(prgm_handle, "depth_range"), 1, &camera.far);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, triangle_colour_tx_handle);
+        int zero = 0;
+        glUniform1iv(glGetUniformLocation(prgm_handle, "colour_tx"), 1, &zero);
+
+        glBindVertexArray(triangle_va_handle);
+        glDrawElements(GL_TRIANGLES, (GLsizei)num_triangles * 3, GL_UNSIGNED_INT, nullptr);
+    }
+
+    void drawNodesAndEdges(OrbitalCamera &camera)
+    {
+        glUseProgram(nodeEdge_prgm_handle);
+
+        glUniformMatrix4fv(glGetUniformLocation(nodeEdge_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(nodeEdge_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+
+        // glLineWidth(std::max(1.0f, 20.0f * scale));
+        glBindVertexArray(edge_va_handle);
+        glDrawElements(GL_LINES, (GLsizei)num_edges * 2, GL_UNSIGNED_INT, nullptr);
+
+        // glPointSize(std::max(2.0f, 15.0f * scale));
+        glPointSize(5.0);
+        glBindVertexArray(node_va_handle);
+        glDrawElements(GL_POINTS, (GLsizei)num_nodes, GL_UNSIGNED_INT, nullptr);
+
+        if (show_voronoi)
+            updateVoronoiDiagram();
+
+        if (show_voronoi && num_voronoi_edges > 0)
+        {
+            glBindVertexArray(voronoi_va_handle);
+            glDrawElements(GL_LINES, (GLsizei)num_voronoi_edges * 2, GL_UNSIGNED_INT, nullptr);
+        }
+    }
+
+    /**
+     * Weighted blended order-independent transparency. Every triangle is rasterized exactly once,
+     * regardless of its facing, and the result doesn't depend on the order of the triangles.
+     */
+    void drawTransparent(OrbitalCamera &camera, float triangle_transparency)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint previous_fbo = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_fbo);
+        resizeOitTargets(viewport[2], viewport[3]);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, oit_fbo_handle);
+        glViewport(0, 0, oit_width, oit_height);
+
+        GLenum bufs[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, bufs);
+
+        // Revealage starts out at 1 (i.e. background fully visible), everything else at 0
+        GLfloat accum_clear[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        GLfloat zero_clear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        GLfloat depth_clear = 1.0f;
+        glDepthMask(GL_TRUE);
+        glClearBufferfv(GL_COLOR, 0, accum_clear);
+        glClearBufferfv(GL_COLOR, 1, zero_clear);
+        glClearBufferfv(GL_COLOR, 2, zero_clear);
+        glClearBufferfv(GL_DEPTH, 0, &depth_clear);
+
+        // Opaque nodes and edges fill the depth buffer
+        GLenum opaque_bufs[3] = {GL_NONE, GL_NONE, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, opaque_bufs);
+        glDisable(GL_BLEND);
+        drawNodesAndEdges(camera);
+
+        // Translucent triangles are depth tested against nodes and edges, but don't write depth.
+        // Colour is summed up, while alpha of the first target is multiplied into the revealage.
+        GLenum transparent_bufs[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, transparent_bufs);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        drawTriangles(oit_prgm_handle, camera, triangle_transparency);
+
+        // Composite over the previously bound framebuffer
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previous_fbo);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+        glDisable(GL_DEPTH_TEST);
+        glBlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE);
+
+        glUseProgram(composite_prgm_handle);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, oit_accum_colour_handle);
+        int zero = 0;
+        glUniform1iv(glGetUniformLocation(composite_prgm_handle, "accumColour_tx2D"), 1, &zero);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, oit_accum_weight_handle);
+        int one = 1;
+        glUniform1iv(glGetUniformLocation(composite_prgm_handle, "accumWeight_tx2D"), 1, &one);
+
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, oit_opaque_colour_handle);
+        int two = 2;
+        glUniform1iv(glGetUniformLocation(composite_prgm_handle, "opaque_tx2D"), 1, &two);
+
+        glBindVertexArray(oit_va_handle);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glActiveTexture(GL_TEXTURE0);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_DEPTH_TEST);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    /**
+     * (Re-)Create the order-independent transparency render targets if the viewport size changed.
+     */
+    void resizeOitTargets(int width, int height)
+    {
+        if (oit_fbo_handle != 0 && width == oit_width && height == oit_height)
+            return;
+
+        oit_width = width;
+        oit_height = height;
+
+        if (oit_fbo_handle == 0)
+        {
+            glGenFramebuffers(1, &oit_fbo_handle);
+            glGenTextures(1, &oit_accum_colour_handle);
+            glGenTextures(1, &oit_accum_weight_handle);
+            glGenTextures(1, &oit_opaque_colour_handle);
+            glGenRenderbuffers(1, &oit_depth_buffer_handle);
+        }
+
+        std::array<GLuint, 3> handles = {{oit_accum_colour_handle, oit_accum_weight_handle, oit_opaque_colour_handle}};
+        std::array<GLint, 3> internal_formats = {{GL_RGBA16F, GL_R16F, GL_RGBA8}};
+        std::array<GLenum, 3> formats = {{GL_RGBA, GL_RED, GL_RGBA}};
+
+        glBindFramebuffer(GL_FRAMEBUFFER, oit_fbo_handle);
+
+        for (size_t i = 0; i < handles.size(); i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, handles[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_formats[i], width, height, 0, formats[i], GL_FLOAT, nullptr);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, handles[i], 0);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, oit_depth_buffer_handle);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, oit_depth_buffer_handle);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "Order-independent transparency framebuffer incomplete" << std::endl;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    /**
+     * Insert a node at the given geo coordinate and update the Delaunay triangulation, see TriangleLocator::insert.
+     * Only the buffer ranges of the new node and of the changed edges and triangles are written to the GPU,
+     * buffers grow geometrically when they are full.
+     * \return False if the point is not covered by the mesh or coincides with a node
+     */
+    bool insertPoint(float lon, float lat)
+    {
+        if (node_va_handle == 0 || edge_va_handle == 0 || triangle_va_handle == 0)
+            return false;
+
+        size_t first_new_triangle = locator.size();
+
+        if (!locator.insert(lon, lat, insertion))
+            return false;
+
+        //////////
+        // Node
+        //////////
+
+        // The new node takes the colour of a neighbour
+        Colour_RGBA colour = node_colours[locator.corners[insertion.changed_triangles.front()][0]];
+        Vertex_RGB node_vertex(lon, lat, colour.r, colour.g, colour.b, colour.a);
+        node_colours.push_back(colour);
+
+        reserveBuffers(node_vbo_handle, node_ibo_handle, node_capacity, num_nodes, num_nodes + 1, sizeof(Vertex_RGB), sizeof(uint));
+
+        uint node_index = (uint)num_nodes;
+        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, num_nodes * sizeof(Vertex_RGB), sizeof(Vertex_RGB), &node_vertex);
+        glBindBuffer(GL_ARRAY_BUFFER, node_ibo_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, num_nodes * sizeof(uint), sizeof(uint), &node_index);
+        num_nodes++;
+
+        //////////
+        // Edges
+        //////////
+
+        if (edge_slots.empty())
+        {
+            edge_slots.reserve(edge_endpoints.size() / 2);
+            for (uint i = 0; i < edge_endpoints.size() / 2; i++)
+                edge_slots[edgeKey(edge_endpoints[2 * i], edge_endpoints[2 * i + 1])] = i;
+        }
+
+        // Flipped edges are moved to their new endpoints, keeping their colour
+        std::vector<uint> free_slots;
+        for (auto &edge : insertion.removed_edges)
+        {
+            auto slot = edge_slots.find(edgeKey(edge.first, edge.second));
+            if (slot != edge_slots.end())
+            {
+                free_slots.push_back(slot->second);
+                edge_slots.erase(slot);
+            }
+        }
+
+        size_t num_appended_edges = (insertion.added_edges.size() > free_slots.size()) ? insertion.added_edges.size() - free_slots.size() : 0;
+        reserveBuffers(edge_vbo_handle, edge_ibo_handle, edge_capacity, num_edges, num_edges + num_appended_edges, 2 * sizeof(Vertex_RGB), 2 * sizeof(uint));
+
+        for (auto &edge : insertion.added_edges)
+        {
+            const Math::Vec2 &first = locator.lon_lat[edge.first];
+            const Math::Vec2 &second = locator.lon_lat[edge.second];
+            Vertex_RGB vertices[2] = {Vertex_RGB(first.x, first.y, 0, 0, 0), Vertex_RGB(second.x, second.y, 0, 0, 0)};
+
+            uint slot;
+            glBindBuffer(GL_ARRAY_BUFFER, edge_vbo_handle);
+            if (!free_slots.empty())
+            {
+                slot = free_slots.back();
+                free_slots.pop_back();
+
+                glBufferSubData(GL_ARRAY_BUFFER, (2 * slot) * sizeof(Vertex_RGB), sizeof(float) * 2, &vertices[0]);
+                glBufferSubData(GL_ARRAY_BUFFER, (2 * slot + 1) * sizeof(Vertex_RGB), sizeof(float) * 2, &vertices[1]);
+            }
+            else
+            {
+                slot = (uint)num_edges++;
+                uint indices[2] = {2 * slot, 2 * slot + 1};
+
+                glBufferSubData(GL_ARRAY_BUFFER, (2 * slot) * sizeof(Vertex_RGB), sizeof(vertices), vertices);
+                glBindBuffer(GL_ARRAY_BUFFER, edge_ibo_handle);
+                glBufferSubData(GL_ARRAY_BUFFER, (2 * slot) * sizeof(uint), sizeof(indices), indices);
+
+                edge_endpoints.resize(2 * num_edges);
+            }
+
+            edge_endpoints[2 * slot] = edge.first;
+            edge_endpoints[2 * slot + 1] = edge.second;
+            edge_slots[edgeKey(edge.first, edge.second)] = slot;
+        }
+
+        //////////////
+        // Triangles
+        //////////////
+
+        size_t previous_triangle_capacity = triangle_capacity;
+        reserveBuffers(triangle_colour_handle, triangle_ibo_handle, triangle_capacity, num_triangles, locator.size(), sizeof(Colour_RGBA), 3 * sizeof(uint));
+        if (triangle_capacity != previous_triangle_capacity)
+            attachTriangleColours();
+
+        // Changed triangles keep their colour, created triangles inherit the colour of the triangle they were split from
+        for (uint parent : insertion.parent_triangles)
+            triangle_colours.push_back(triangle_colours[parent]);
+
+        glBindBuffer(GL_ARRAY_BUFFER, triangle_colour_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, first_new_triangle * sizeof(Colour_RGBA), (locator.size() - first_new_triangle) * sizeof(Colour_RGBA),
+                        &triangle_colours[first_new_triangle]);
+
+        glBindBuffer(GL_ARRAY_BUFFER, triangle_ibo_handle);
+        for (uint t : insertion.changed_triangles)
+            glBufferSubData(GL_ARRAY_BUFFER, (3 * t) * sizeof(uint), 3 * sizeof(uint), locator.corners[t].data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        num_triangles = locator.size();
+        voronoi_outdated = true;
+
+        return true;
+    }
+
+    /**
+     * Insert multiple nodes given as geo coordinates (x = longitude, y = latitude).
+     * \return Number of inserted nodes
+     */
+    size_t insertPoints(const std::vector<Math::Vec2> &lon_lat)
+    {
+        size_t inserted = 0;
+        for (auto &point : lon_lat)
+            inserted += insertPoint(point.x, point.y) ? 1 : 0;
+
+        return inserted;
+    }
+
+    static uint64_t edgeKey(uint a, uint b)
+    {
+        return ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+    }
+
+    /**
+     * Make room for at least required elements in a pair of vertex and index buffers, doubling their capacity.
+     */
+    static void reserveBuffers(GLuint vbo_handle, GLuint ibo_handle, size_t &capacity, size_t used, size_t required, size_t vertex_bytes, size_t index_bytes)
+    {
+        size_t index_capacity = capacity;
+        reserveBuffer(vbo_handle, capacity, used, required, vertex_bytes);
+        reserveBuffer(ibo_handle, index_capacity, used, required, index_bytes);
+    }
+
+    /**
+     * Show or hide the Voronoi diagram of the nodes.
+     */
+    void toggleVoronoiDiagram()
+    {
+        show_voronoi = !show_voronoi;
+    }
+
+    /**
+     * Derive the Voronoi diagram from the triangulation if it is outdated: its vertices are the circumcenters
+     * of the triangles and each pair of adjacent triangles contributes one edge.
+     */
+    void updateVoronoiDiagram()
+    {
+        if (!voronoi_outdated || locator.size() == 0)
+            return;
+
+        voronoi_outdated = false;
+
+        // One vertex per triangle, placed at its circumcenter
+        std::vector<Vertex_RGB> voronoi_vertices(locator.size());
+
+        auto circumcenterRange = [this, &voronoi_vertices](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++)
+            {
+                Math::Vec3 center = locator.circumcenter((uint)t);
+                float lat = (180.0f * std::asin(std::max(-1.0f, std::min(center.y, 1.0f)))) / PI;
+                float lon = (180.0f * std::atan2(center.x, center.z)) / PI;
+                voronoi_vertices[t] = Vertex_RGB(lon, lat, 0, (char)200, (char)255);
+            }
+        };
+        parallelFor(locator.size(), circumcenterRange);
+
+        // Each triangulation edge shared by two triangles, visited from the triangle with the lower index
+        std::vector<uint> voronoi_indices;
+        voronoi_indices.reserve(locator.size() * 3);
+        for (uint t = 0; t < locator.size(); t++)
+        {
+            for (uint neighbour : locator.neighbours[t])
+            {
+                if (neighbour != TriangleLocator::NO_NEIGHBOUR && neighbour > t)
+                {
+                    voronoi_indices.push_back(t);
+                    voronoi_indices.push_back(neighbour);
+                }
+            }
+        }
+
+        num_voronoi_edges = voronoi_indices.size() / 2;
+
+        if (voronoi_va_handle == 0)
+        {
+            glGenVertexArrays(1, &voronoi_va_handle);
+            glGenBuffers(1, &voronoi_vbo_handle);
+            glGenBuffers(1, &voronoi_ibo_handle);
+        }
+
+        glBindVertexArray(voronoi_va_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, voronoi_vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex_RGB) * voronoi_vertices.size(), voronoi_vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, voronoi_ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * voronoi_indices.size(), voronoi_indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    /**
+     * Check the empty circumcircle property of all triangles and colour the violating triangles magenta.
+     */
+    void highlightDelaunayViolations()
+    {
+        auto t_start = std::chrono::high_resolution_clock::now();
+
+        std::vector<uint> violating_triangles;
+        DelaunayValidator validator(locator);
+        validator.findViolations(violating_triangles);
+
+        auto t_end = std::chrono::high_resolution_clock::now();
+        std::cout << violating_triangles.size() << " of " << num_triangles << " triangles violate the Delaunay property, checked in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl;
+
+        if (violating_triangles.empty())
+            return;
+
+        // Only map the range of triangle colours spanned by the violating triangles
+        size_t first = violating_triangles.front();
+        size_t last = violating_triangles.back() + 1;
+
+        glBindBuffer(GL_ARRAY_BUFFER, triangle_colour_handle);
+        Colour_RGBA *mapped = (Colour_RGBA *)glMapBufferRange(GL_ARRAY_BUFFER, first * sizeof(Colour_RGBA), (last - first) * sizeof(Colour_RGBA), GL_MAP_WRITE_BIT);
+        if (mapped != nullptr)
+        {
+            for (uint t : violating_triangles)
+            {
+                triangle_colours[t].r = (char)255;
+                triangle_colours[t].g = 0;
+                triangle_colours[t].b = (char)255;
+                mapped[t - first] = triangle_colours[t];
+            }
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    /**
+     * Place the sphere on the triangle containing the given geo coordinate, or hide it if there is none.
+     */
+    void pick(float lon, float lat)
+    {
+        placeSphere(locator.locate(lon, lat));
+    }
+
+    void placeSphere(int triangle_id)
+    {
+        if (triangle_id < 0)
+        {
+            show_sphere = false;
+            return;
+        }
+
+        Math::Vec3 v1 = locator.position(locator.corners[triangle_id][0]);
+        Math::Vec3 v2 = locator.position(locator.corners[triangle_id][1]);
+        Math::Vec3 v3 = locator.position(locator.corners[triangle_id][2]);
+
+        show_sphere = true;
+        // http://www.ics.uci.edu/~eppstein/junkyard/circumcenter.html
+        sphere_world_position = v1 + ((pow((v3 - v1).length(), 2.0f) * Math::cross(Math::cross((v2 - v1), (v3 - v1)), (v2 - v1)) + pow((v2 - v1).length(), 2.0f) * Math::cross((v3 - v1), Math::cross((v2 - v1), (v3 - v1)))) / (2.0f * pow(Math::cross((v2 - v1), (v3 - v1)).length(), 2.0f)));
+        sphere_target_scale = (sphere_world_position - v1).length();
+        sphere_scale = 0.0;
+    }
+};
+
+struct CollisionSpheres
+{
+    CollisionSpheres() : sphere_cnt(0),
+                         grow_factor(0.0),
+                         highest_priority(0),
+                         show_eliminations_factor(0.0),
+                         current_timestep(0),
+                         time(0.0),
+                         ss_prgm_handle(0),
+                         cs_prgm_handle(0),
+                         data_texture_handle(0),
+                         priority_texture_handle(0),
+                         ss_mesh(6),
+                         cs_mesh(3)
+    {
+        // Create shader progams
+        ss_prgm_handle = createShaderProgram("../src/surface_sphere_v.glsl", "../src/surface_sphere_f.glsl", {"v_position"});
+        cs_prgm_handle = createShaderProgram("../src/collision_sphere_v.glsl", "../src/collision_sphere_f.glsl", {"v_position"});
+    };
+
+    ~CollisionSpheres(){};
+
+    std::vector<CollisionSphere> collision_sphere_data;
+    uint sphere_cnt;
+    float grow_factor;
+    uint highest_priority;
+    float show_eliminations_factor;
+
+    uint current_timestep;
+    float time;
+
+    /* Surface sphere program handle */
+    GLuint ss_prgm_handle;
+    /* Collision spheres program handle */
+    GLuint cs_prgm_handle;
+    /* Collision spheres data texture handle */
+    GLuint data_texture_handle;
+    /* Additional collision spheres data texture handle */
+    GLuint priority_texture_handle;
+
+    /* Surface sphere mesh */
+    IcoSphere ss_mesh;
+    /* Collision spheres mesh */
+    IcoSphere cs_mesh;
+
+    Math::Vec3 geoToCartesian(float lon, float lat)
+    {
+        float lat_sin = sin((PI / 180.0) * lat);
+        float lon_sin = sin((PI / 180.0) * lon);
+
+        float lat_cos = cos((PI / 180.0) * lat);
+        float lon_cos = cos((PI / 180.0) * lon);
+
+        float r = 1.0;
+        // Earth radius in meters = 6378137.0;
+
+        return Math::Vec3(lon_sin * lat_cos * r,
+                          lat_sin * r,
+                          lat_cos * lon_cos * r);
+    }
+
+    void moveTimestep(int direction)
+    {
+
+        current_timestep = (static_cast<int>(current_timestep) + direction < 0) ? 0u : std::min(current_timestep + direction, sphere_cnt);
+
+        time = collision_sphere_data[current_timestep].collision_time;
+    }
+
+    static constexpr double DEG_TO_RAD = 0.017453292519943295769236907684886;
+    static constexpr double EARTH_RADIUS_IN_CENTIMETERS = 637279756.0856;
+
+    double haversine(const CollisionSphere &from, const CollisionSphere &to)
+    {
+        double lat_arc = (from.lat - to.lat) * DEG_TO_RAD;
+        double lon_arc = (from.lon - to.lon) * DEG_TO_RAD;
+        double lat_h = sin(lat_arc * 0.5);
+        lat_h *= lat_h;
+        double lon_h = sin(lon_arc * 0.5);
+        lon_h *= lon_h;
+        double tmp = cos(from.lat * DEG_TO_RAD) * cos(to.lat * DEG_TO_RAD);
+        return 2.0 * asin(sqrt(lat_h + tmp * lon_h));
+    }
+
+    void loadData(std::vector<CollisionSphere> &spheres, std::map<uint, uint> &id_map)
+    {
+        // Copy data
+        collision_sphere_data = spheres;
+
+        sphere_cnt = spheres.size() - 4;
+
+        current_timestep = (sphere_cnt > 1000) ? sphere_cnt - 1000 : 0;
+        time = spheres[current_timestep].collision_time;
+
+        // Extract information from collision sphere and store in texture for rendering
+        uint tx_height = std::ceil(static_cast<float>(sphere_cnt) / 8096.0f);
+        std::vector<float> tx_data(8096 * tx_height * 4, 0.0f);
+        std::vector<float> prio_tx_data(8096 * tx_height * 2, 0.0f);
+
+        float min_priority = static_cast<float>(spheres[sphere_cnt - 1].priority);
+
+        for (int i = (sphere_cnt - 1); i >= 0; i = i - 1)
         {
-            // delete mesh resources
-            glBindVertexArray(edge_va_handle);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &edge_ibo_handle);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &edge_vbo_handle);
-            glBindVertexArray(0);
-            glDeleteVertexArrays(1, &edge_va_handle);
+            tx_data[i * 4 + 0] = (spheres[i].lat);
+            tx_data[i * 4 + 1] = (spheres[i].lon);
+
+            // approximate radius in 3d space
+            auto search = id_map.find(spheres[i].collision_partner_id);
+            assert(search != id_map.end());
+            uint q_idx = search->second;
+            assert(q_idx < spheres.size());
+
+            // Math::Vec3 p = geoToCartesian(spheres[i].lon, spheres[i].lat);
+            // Math::Vec3 q = geoToCartesian(spheres[q_idx].lon, spheres[q_idx].lat);
+            double rp = spheres[i].radius;
+            double rq = spheres[q_idx].radius;
+
+            // float d = (p - q).length();
+            double d = haversine(spheres[i], spheres[q_idx]);
+
+            double bl = d * (rp / (rp + rq));
+            double radius = 2.0 * ::sin(bl / 2.0);
+
+            tx_data[i * 4 + 2] = (radius);
+            tx_data[i * 4 + 3] = (spheres[i].collision_time);
+
+            min_priority = std::min(min_priority, static_cast<float>(spheres[i].priority));
+            prio_tx_data[i * 2 + 0] = static_cast<float>(spheres[i].priority);
+            prio_tx_data[i * 2 + 1] = min_priority;
+
+            highest_priority = std::max(highest_priority, spheres[i].priority);
         }
 
-        if (triangle_va_handle != 0)
+        if (data_texture_handle == 0)
+            glGenTextures(1, &data_texture_handle);
+        glBindTexture(GL_TEXTURE_2D, data_texture_handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 8096, tx_height, 0, GL_RGBA, GL_FLOAT, tx_data.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (priority_texture_handle == 0)
+            glGenTextures(1, &priority_texture_handle);
+        glBindTexture(GL_TEXTURE_2D, priority_texture_handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 8096, tx_height, 0, GL_RG, GL_FLOAT, prio_tx_data.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void draw(OrbitalCamera &camera)
+    {
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_TEST);
+
+        // draw planetary surface sphere
+        glUseProgram(ss_prgm_handle);
+        glUniformMatrix4fv(glGetUniformLocation(ss_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(ss_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        ss_mesh.draw(1);
+
+        // draw collision spheres
+        glUseProgram(cs_prgm_handle);
+
+        glUniformMatrix4fv(glGetUniformLocation(cs_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(cs_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, data_texture_handle);
+        int zero = 0;
+        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "data_tx2D"), 1, &zero);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, priority_texture_handle);
+        int one = 1;
+        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "priority_data_tx2D"), 1, &one);
+
+        glUniform1fv(glGetUniformLocation(cs_prgm_handle, "time"), 1, &time);
+        float zpo = 0.0001;
+        glUniform1fv(glGetUniformLocation(cs_prgm_handle, "grow_factor"), 1, &zpo);
+        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "mode"), 1, &Controls::collisionSphere_mode);
+        glUniform1uiv(glGetUniformLocation(cs_prgm_handle, "id_offset"), 1, &current_timestep);
+        glUniform1uiv(glGetUniformLocation(cs_prgm_handle, "highest_priority"), 1, &highest_priority);
+
+        uint remaining_sphere_cnt = sphere_cnt - current_timestep;
+        int show_elimination_idx = remaining_sphere_cnt * show_eliminations_factor;
+        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "show_elimination_idx"), 1, &show_elimination_idx);
+
+        cs_mesh.draw(remaining_sphere_cnt);
+        glCullFace(GL_BACK);
+        glDisable(GL_DEPTH_TEST);
+    }
+};
+
+/**
+ * Culls the instances of labels or icons against the view frustum and the horizon of the globe on the GPU.
+ * The visible instances are copied into a buffer of their own and drawn with an indirect draw, so that the vertex
+ * work of instances outside of the view or behind the globe is skipped. Requires OpenGL 4.3 for the compute shader,
+ * on older contexts cull always fails and all instances should be drawn.
+ */
+struct InstanceCulling
+{
+    InstanceCulling() : prgm_handle(0), visible_buffer_handle(0), command_buffer_handle(0), visible_capacity(0), available(-1) {}
+    InstanceCulling(const InstanceCulling &) = delete;
+    ~InstanceCulling()
+    {
+        glDeleteProgram(prgm_handle);
+        glDeleteBuffers(1, &visible_buffer_handle);
+        glDeleteBuffers(1, &command_buffer_handle);
+    }
+
+    GLuint prgm_handle;
+
+    /** Visible instances of the latest cull, laid out like the culled instances */
+    GLuint visible_buffer_handle;
+
+    /** Indirect draw command of the unit quad, with one instance per visible instance */
+    GLuint command_buffer_handle;
+
+    /**
+     * Create the buffers up front, so that vertex arrays can reference the visible instances. Does nothing
+     * without OpenGL 4.3.
+     */
+    bool init()
+    {
+        if (available < 0)
         {
-            // delete mesh resources
-            glBindVertexArray(triangle_va_handle);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &triangle_ibo_handle);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glDeleteBuffers(1, &triangle_vbo_handle);
-            glBindVertexArray(0);
-            glDeleteVertexArrays(1, &triangle_va_handle);
+            GLint major_version = 0, minor_version = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+            glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+            available = (major_version > 4 || (major_version == 4 && minor_version >= 3)) ? 1 : 0;
+
+            if (available)
+            {
+                prgm_handle = createComputeProgram("../src/instance_cull_c.glsl");
+                glGenBuffers(1, &visible_buffer_handle);
+                glGenBuffers(1, &command_buffer_handle);
+            }
+        }
+
+        return available == 1;
+    }
+
+    /**
+     * Copy the instances visible from the camera into the visible buffer and set up the draw command.
+     * \param instance_floats Size of each instance in floats, instances start with their geo coordinates (lon, lat)
+     * \param scale_offset Offset of the scale within an instance in floats
+     * \param half_width_offset Offset of the half width of the quad within an instance in floats, or -1 to use half_width
+     * \param index_cnt Number of indices of the instanced quad
+     * \return False if culling isn't supported
+     */
+    bool cull(OrbitalCamera &camera, GLuint instance_buffer_handle, size_t instance_cnt, GLuint instance_floats,
+              GLuint scale_offset, GLint half_width_offset, float half_width, GLuint index_cnt)
+    {
+        if (!init())
+            return false;
+
+        if (instance_cnt > visible_capacity)
+        {
+            visible_capacity = std::max(instance_cnt, 2 * visible_capacity);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, visible_buffer_handle);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLfloat) * instance_floats * visible_capacity, nullptr, GL_DYNAMIC_DRAW);
+        }
+
+        DrawElementsIndirectCommand command = {index_cnt, 0, 0, 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer_handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        if (instance_cnt == 0)
+            return true;
+
+        // Planes of the frustum from the rows of the view projection matrix, normalized for the distance test
+        Math::Mat4x4 view_projection = camera.projection_matrix * camera.view_matrix;
+        std::array<float, 24> planes;
+        for (int plane = 0; plane < 6; plane++)
+        {
+            int row = plane / 2;
+            float sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+            for (int column = 0; column < 4; column++)
+                planes[plane * 4 + column] = view_projection[column * 4 + 3] + sign * view_projection[column * 4 + row];
+
+            float length = std::sqrt(planes[plane * 4] * planes[plane * 4] + planes[plane * 4 + 1] * planes[plane * 4 + 1] +
+                                     planes[plane * 4 + 2] * planes[plane * 4 + 2]);
+            for (int column = 0; column < 4; column++)
+                planes[plane * 4 + column] /= length;
         }
 
-        // delete shader program
-        glDeleteProgram(triangle_prgm_handle);
-        glDeleteProgram(nodeEdge_prgm_handle);
-        glDeleteProgram(picking_prgm_handle);
-        glDeleteProgram(sphere_prgm_handle);
-    }
+        float camera_lon = camera.longitude * (PI / 180.0f);
+        float camera_lat = camera.latitude * (PI / 180.0f);
+        std::array<float, 3> camera_position = {{std::sin(camera_lon) * std::cos(camera_lat) * camera.orbit,
+                                                 std::sin(camera_lat) * camera.orbit,
+                                                 std::cos(camera_lat) * std::cos(camera_lon) * camera.orbit}};
 
-    GLuint triangle_prgm_handle;
-    GLuint nodeEdge_prgm_handle;
-    GLuint picking_prgm_handle;
-    GLuint sphere_prgm_handle;
+        glUseProgram(prgm_handle);
+        glUniform1ui(glGetUniformLocation(prgm_handle, "instance_cnt"), (GLuint)instance_cnt);
+        glUniform1ui(glGetUniformLocation(prgm_handle, "instance_stride"), instance_floats);
+        glUniform1ui(glGetUniformLocation(prgm_handle, "scale_offset"), scale_offset);
+        glUniform1i(glGetUniformLocation(prgm_handle, "half_width_offset"), half_width_offset);
+        glUniform1f(glGetUniformLocation(prgm_handle, "half_width"), half_width);
+        glUniform4fv(glGetUniformLocation(prgm_handle, "frustum_planes"), 6, planes.data());
+        glUniform3fv(glGetUniformLocation(prgm_handle, "camera_position"), 1, camera_position.data());
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instance_buffer_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visible_buffer_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command_buffer_handle);
+
+        // Work groups beyond the guaranteed 65535 in x direction continue in y direction
+        GLuint group_cnt = (GLuint)((instance_cnt + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+        GLuint group_cnt_x = std::min(group_cnt, MAX_GROUP_CNT);
+        glDispatchCompute(group_cnt_x, (group_cnt + group_cnt_x - 1) / group_cnt_x, 1);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        for (GLuint binding = 0; binding < 3; binding++)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
 
-    size_t num_nodes;
-    size_t num_edges;
-    size_t num_triangles;
+        return true;
+    }
 
-    GLuint node_va_handle;
-    GLuint node_vbo_handle;
-    GLuint node_ibo_handle;
+    /**
+     * Draw the visible instances of the latest cull with a vertex array referencing the visible buffer.
+     */
+    void draw(GLuint array_handle)
+    {
+        glBindVertexArray(array_handle);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_handle);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
 
-    GLuint edge_va_handle;
-    GLuint edge_vbo_handle;
-    GLuint edge_ibo_handle;
+private:
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLuint base_vertex;
+        GLuint base_instance;
+    };
 
-    GLuint triangle_va_handle;
-    GLuint triangle_vbo_handle;
-    GLuint triangle_ibo_handle;
+    static constexpr GLuint CULL_GROUP_SIZE = 256;
+    static constexpr GLuint MAX_GROUP_CNT = 65535;
 
-    GLuint picking_fbo_handle;
-    GLuint picking_color_attachment_handle;
-    GLuint picking_depth_buffer_handle;
+    /** Number of instances the visible buffer can hold */
+    size_t visible_capacity;
+    /** -1 until the OpenGL version has been checked, then 1 if compute shaders are available and 0 otherwise */
+    int available;
+};
 
-    bool show_sphere;
-    uint num_sphere_indices;
-    Math::Vec3 sphere_world_position;
-    float sphere_scale;
-    float sphere_target_scale;
-    std::chrono::time_point<std::chrono::high_resolution_clock> t_0;
-    std::chrono::time_point<std::chrono::high_resolution_clock> t_1;
+constexpr GLuint InstanceCulling::CULL_GROUP_SIZE;
+constexpr GLuint InstanceCulling::MAX_GROUP_CNT;
 
-    IcoSphere sphere;
+/**
+ * Flat open addressing hash table mapping unicode code points to the lower left corner of their
+ * glyph in the font atlas. Code points without a glyph resolve to a fallback glyph.
+ */
+struct GlyphTable
+{
+    GlyphTable()
+        : keys(MIN_CAPACITY, EMPTY_KEY), slots(MIN_CAPACITY), entry_cnt(0), fallback{{0.0f, 0.0f}}
+    {
+    }
+
+    /**
+     * Map a code point to an atlas position, replacing any previous mapping
+     */
+    void insert(uint32_t code_point, const std::array<float, 2> &atlas_uv)
+    {
+        // keep the load factor at or below one half so that probe sequences stay short
+        if (2 * (entry_cnt + 1) > keys.size())
+            rehash(2 * keys.size());
 
-    // Need a copy of graph data for sphere creation
-    std::vector<Node_RGB> nodes;
-    std::vector<Triangle_RGB> triangles;
+        size_t idx = probe(code_point);
+        if (keys[idx] == EMPTY_KEY)
+        {
+            keys[idx] = code_point;
+            entry_cnt++;
+        }
+        slots[idx] = atlas_uv;
+    }
 
-    void loadGraphData(std::vector<Node_RGB> &nodes, std::vector<Edge_RGB> &edges, std::vector<Triangle_RGB> &triangles)
+    /**
+     * Atlas position of a code point, or of the fallback glyph if the atlas has no such glyph
+     */
+    const std::array<float, 2> &find(uint32_t code_point) const
     {
-        num_nodes = nodes.size();
-        num_edges = edges.size();
-        num_triangles = triangles.size();
+        size_t idx = probe(code_point);
+        return keys[idx] == code_point ? slots[idx] : fallback;
+    }
 
-        this->nodes = nodes;
-        this->triangles = triangles;
+    /**
+     * Use the glyph of an already inserted code point for all unknown code points
+     */
+    void setFallback(uint32_t code_point)
+    {
+        fallback = find(code_point);
+    }
 
-        //////////
-        // Nodes
-        //////////
+    size_t size() const
+    {
+        return entry_cnt;
+    }
 
-        std::vector<Vertex_RGB> node_vertices;
-        std::vector<uint> node_indices;
+private:
+    /** Never a valid code point, marks free slots */
+    static constexpr uint32_t EMPTY_KEY = 0xFFFFFFFF;
+    static constexpr size_t MIN_CAPACITY = 64;
 
-        // At least as many vertices as there are nodes are required
-        node_vertices.reserve(nodes.size());
+    /** Code point stored in each slot, capacity is always a power of two */
+    std::vector<uint32_t> keys;
+    std::vector<std::array<float, 2>> slots;
+    size_t entry_cnt;
+    std::array<float, 2> fallback;
 
-        // Each edge contributes two indices
-        node_indices.reserve(nodes.size());
+    /**
+     * Slot holding the code point or the free slot terminating its probe sequence
+     */
+    size_t probe(uint32_t code_point) const
+    {
+        const size_t mask = keys.size() - 1;
+        // Fibonacci hashing, the upper half of the product mixes all bits of the code point
+        size_t idx = ((code_point * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (keys[idx] != code_point && keys[idx] != EMPTY_KEY)
+            idx = (idx + 1) & mask;
+        return idx;
+    }
 
-        // Copy geo coordinates from input nodes to vertices
-        uint index_counter = 0;
-        for (auto &node : nodes)
+    void rehash(size_t capacity)
+    {
+        std::vector<uint32_t> old_keys(capacity, EMPTY_KEY);
+        std::vector<std::array<float, 2>> old_slots(capacity);
+        keys.swap(old_keys);
+        slots.swap(old_slots);
+        for (size_t i = 0; i < old_keys.size(); i++)
         {
-            node_vertices.push_back(Vertex_RGB((float)node.lon, (float)node.lat, node.r, node.g, node.b, node.a));
-
-            node_indices.push_back(index_counter++);
+            if (old_keys[i] != EMPTY_KEY)
+            {
+                size_t idx = probe(old_keys[i]);
+                keys[idx] = old_keys[i];
+                slots[idx] = old_slots[i];
+            }
         }
+    }
+};
 
-        // Allocate GPU memory and send data
-        if (node_vertices.size() < 1 || node_indices.size() < 1)
-            return;
+constexpr uint32_t GlyphTable::EMPTY_KEY;
+constexpr size_t GlyphTable::MIN_CAPACITY;
 
-        auto va_size = sizeof(Vertex_RGB) * node_vertices.size();
-        auto vi_size = sizeof(uint) * node_indices.size();
+/**
+ * Collection of text labels on the map.
+ */
+struct TextLabels
+{
+    /** Position of each glyph of the font atlas */
+    GlyphTable glyph_table;
 
-        if (node_va_handle == 0 || node_vbo_handle == 0 || node_ibo_handle == 0)
+    TextLabels()
+    {
+        std::vector<std::vector<uint32_t>> atlas_rows;
+
+        atlas_rows.push_back(toUnicodePoints("ABCDEFGHIJKLMN"));
+        atlas_rows.push_back(toUnicodePoints("OPQRSTUVWXYZab"));
+        atlas_rows.push_back(toUnicodePoints("cdefghijklmnop"));
+        atlas_rows.push_back(toUnicodePoints("qrstuvwxyz1234"));
+        atlas_rows.push_back(toUnicodePoints("567890&@.,?!'\""));
+        atlas_rows.push_back(toUnicodePoints("\"()*-_ßöäüÖÄÜ"));
+
+        float u_value = 1.0f / 16.0f;
+        float v_value = 5.0f / 6.0f;
+
+        for (auto &s : atlas_rows)
         {
-            glGenVertexArrays(1, &node_va_handle);
-            glGenBuffers(1, &node_vbo_handle);
-            glGenBuffers(1, &node_ibo_handle);
+            for (auto c : s)
+            {
+                glyph_table.insert(c, {{u_value, v_value}});
+                u_value += 1.0f / 16.0f;
+            }
+
+            u_value = 1.0f / 16.0f;
+            v_value -= 1.0f / 6.0f;
         }
 
-        glBindVertexArray(node_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, va_size, node_vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, node_ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, node_indices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
+        // the atlas has no space, but its last column is empty
+        glyph_table.insert(' ', {{15.0f / 16.0f, 5.0f / 6.0f}});
+
+        // characters missing from the atlas are drawn as question marks
+        glyph_table.setFallback('?');
+
+        // Create a unit quad that is instanced once per glyph
+        std::array<float, 8> vertex_array = {{0.0f, 0.0f,
+                                              0.0f, 1.0f,
+                                              1.0f, 1.0f,
+                                              1.0f, 0.0f}};
+        std::array<GLuint, 6> index_array = {{0, 2, 1, 2, 0, 3}};
+
+        glGenBuffers(1, &vbo_handle);
+        glGenBuffers(1, &ibo_handle);
+        glGenBuffers(1, &glyph_buffer_handle);
+        glGenBuffers(1, &visible_glyph_buffer_handle);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_array), vertex_array.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_array), index_array.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        glBindVertexArray(node_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, node_vbo_handle);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        glBindVertexArray(0);
+        // One vertex array draws from the glyphs of all labels, the other from the glyphs of the visible labels only
+        glGenVertexArrays(1, &va_handle);
+        glGenVertexArrays(1, &visible_va_handle);
+        setupGlyphArray(va_handle, glyph_buffer_handle);
+        setupGlyphArray(visible_va_handle, visible_glyph_buffer_handle);
+
+        // A third one draws the glyphs that survived culling
+        culled_va_handle = 0;
+        if (culling.init())
+        {
+            glGenVertexArrays(1, &culled_va_handle);
+            setupGlyphArray(culled_va_handle, culling.visible_buffer_handle);
+        }
+
+        // Load text label shader program
+        prgm_handle = createShaderProgram("../src/textLabel_v.glsl", "../src/textLabel_f.glsl", {"v_corner", "g_anchor", "g_offset", "g_atlasUV", "g_scale"});
+
+        // Load font atlas
+        unsigned long begin_pos;
+        int x_dim, y_dim;
+        char *img_data;
+        ResourceLoader::readPpmHeader("../resources/font_atlas.ppm", begin_pos, x_dim, y_dim);
+        img_data = new char[x_dim * y_dim * 3];
+        ResourceLoader::readPpmData("../resources/font_atlas.ppm", img_data, begin_pos, x_dim, y_dim);
+
+        glGenTextures(1, &font_atlas_handle);
+        // assert(font_atlas_handle > 0);
+        glBindTexture(GL_TEXTURE_2D, font_atlas_handle);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x_dim, y_dim, 0, GL_RGB, GL_UNSIGNED_BYTE, img_data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        delete[] img_data;
+    }
+    /* Structs and classes that free OpenGL resources within their destructor
+     * should be non-copyable to prevent bad stuff from happening
+     */
+    TextLabels(const TextLabels &) = delete;
+    ~TextLabels()
+    {
+        // delete mesh resources
+        glBindVertexArray(va_handle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &ibo_handle);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &vbo_handle);
+        glDeleteBuffers(1, &glyph_buffer_handle);
+        glDeleteBuffers(1, &visible_glyph_buffer_handle);
+        glBindVertexArray(0);
+        glDeleteVertexArrays(1, &va_handle);
+        glDeleteVertexArrays(1, &visible_va_handle);
+        glDeleteVertexArrays(1, &culled_va_handle);
 
-        //////////
-        // Edges
-        //////////
+        // delete GLSL program
+        glDeleteProgram(prgm_handle);
 
-        std::vector<Vertex_RGB> edge_vertices;
-        std::vector<uint> edge_indices;
+        // delete font atlas
+        glDeleteTextures(1, &font_atlas_handle);
+    }
 
-        // At least as many vertices as there are nodes are required
-        edge_vertices.reserve(nodes.size());
+    /**
+     * Per glyph instance data. The glyphs of all labels are stored in a single buffer and drawn with a single
+     * instanced draw call of a unit quad.
+     */
+    struct GlyphInstance
+    {
+        /** Geo-coordinates (lon, lat) of the label the glyph belongs to */
+        std::array<float, 2> anchor;
+        /** Offset of the glyph's left edge from the label center and half the width of the label */
+        std::array<float, 2> offset;
+        /** Lower left corner of the glyph in the font atlas */
+        std::array<float, 2> atlas_uv;
+        /** Relative scale of the label */
+        float scale;
+    };
 
-        // Each edge contributes two indices
-        edge_indices.reserve(edges.size() * 2);
+    GLuint va_handle;
 
-        index_counter = 0;
-        for (auto &edge : edges)
-        {
-            edge_vertices.push_back(Vertex_RGB(nodes[edge.source].lon, nodes[edge.source].lat, edge.r, edge.g, edge.b, edge.a));
-            edge_vertices.push_back(Vertex_RGB(nodes[edge.target].lon, nodes[edge.target].lat, edge.r, edge.g, edge.b, edge.a));
+    GLuint visible_va_handle;
 
-            edge_indices.push_back(index_counter++);
-            edge_indices.push_back(index_counter++);
+    GLuint culled_va_handle;
 
-            // TODO could be possible to optimize by finding vertices of the same color
-        }
+    GLuint vbo_handle;
 
-        // Allocate GPU memory and send data
-        if (edge_vertices.size() < 1 || edge_indices.size() < 1)
-            return;
+    GLuint ibo_handle;
 
-        va_size = sizeof(Vertex_RGB) * edge_vertices.size();
-        vi_size = sizeof(uint) * edge_indices.size();
+    /** Buffer holding the glyph instances of all labels */
+    GLuint glyph_buffer_handle;
 
-        if (edge_va_handle == 0 || edge_vbo_handle == 0 || edge_ibo_handle == 0)
-        {
-            glGenVertexArrays(1, &edge_va_handle);
-            glGenBuffers(1, &edge_vbo_handle);
-            glGenBuffers(1, &edge_ibo_handle);
-        }
+    /** Buffer holding the glyph instances of the visible labels, only used while some labels are hidden */
+    GLuint visible_glyph_buffer_handle;
 
-        glBindVertexArray(edge_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, edge_vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, va_size, edge_vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, edge_indices.data(), GL_DYNAMIC_DRAW);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    /** Frustum and horizon culling of the glyphs, unless decluttering culls the labels during placement */
+    InstanceCulling culling;
 
-        glBindVertexArray(edge_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, edge_vbo_handle);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_RGB), 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLuint prgm_handle;
 
-        //////////////
-        // Triangles
-        //////////////
+    GLuint font_atlas_handle;
+
+    /** Total number of labels */
+    uint num_labels = 0;
+
+    /** Geo-Cooridnates of each label */
+    std::vector<float> geoCoordinates;
+    /** Number of characters of each label */
+    std::vector<unsigned int> lengths;
+    /** Relative scale of each label */
+    std::vector<float> scales;
+    /** Visibility of each label i.e. rendered or not */
+    std::vector<bool> visibility;
+    /** Index of the first glyph of each label */
+    std::vector<size_t> offsets;
+    /** Placement priority of each label, labels of higher priority win when labels overlap on screen */
+    std::vector<float> priorities;
+    /** Glyph instances of all labels */
+    std::vector<GlyphInstance> glyphs;
+
+    /** Hide labels overlapping labels of higher priority on screen */
+    bool decluttering = true;
+    /** Edge length in pixels of the cells of the screen-space occupancy grid used for decluttering */
+    int declutter_cell_size = 4;
+
+    void addLabel(std::string label_text, float latitude, float longitude, float scale, float priority = 0.0f)
+    {
+        appendLabel(label_text, latitude, longitude, scale, priority);
+    }
+
+    /**
+     * Add many labels at once. Like addLabel, this only appends to the glyph instances on the CPU side,
+     * the new glyphs are sent to the GPU with a single upload before the next draw.
+     */
+    void addLabels(const std::vector<std::string> &label_texts, const std::vector<float> &latitudes,
+                   const std::vector<float> &longitudes, const std::vector<float> &label_scales,
+                   const std::vector<float> &label_priorities = std::vector<float>())
+    {
+        assert(label_texts.size() == latitudes.size() && label_texts.size() == longitudes.size() && label_texts.size() == label_scales.size());
+        assert(label_priorities.empty() || label_priorities.size() == label_texts.size());
+
+        size_t glyph_cnt = glyphs.size();
+        for (auto &text : label_texts)
+            glyph_cnt += text.size();
+
+        glyphs.reserve(glyph_cnt);
+        geoCoordinates.reserve(geoCoordinates.size() + 2 * label_texts.size());
+        lengths.reserve(lengths.size() + label_texts.size());
+        scales.reserve(scales.size() + label_texts.size());
+        visibility.reserve(visibility.size() + label_texts.size());
+        offsets.reserve(offsets.size() + label_texts.size());
+        priorities.reserve(priorities.size() + label_texts.size());
+        anchors.reserve(anchors.size() + label_texts.size());
+
+        for (size_t i = 0; i < label_texts.size(); i++)
+            appendLabel(label_texts[i], latitudes[i], longitudes[i], label_scales[i], label_priorities.empty() ? 0.0f : label_priorities[i]);
+    }
 
-        std::vector<Vertex_ID_RGB> triangle_vertices;
-        std::vector<uint> triangle_indices;
+    /**
+     * Remove all labels. The GPU buffers are kept for the labels added afterwards.
+     */
+    void clear()
+    {
+        num_labels = 0;
+        geoCoordinates.clear();
+        lengths.clear();
+        scales.clear();
+        visibility.clear();
+        offsets.clear();
+        priorities.clear();
+        glyphs.clear();
+        anchors.clear();
+
+        uploaded_glyph_cnt = 0;
+        hidden_label_cnt = 0;
+        placement_order.clear();
+        placed_labels.clear();
+        visibility_changed = true;
+    }
 
-        // At least as many vertices as there are nodes are required
-        triangle_vertices.reserve(nodes.size());
+    void toggleDecluttering()
+    {
+        decluttering = !decluttering;
+        visibility_changed = true;
+    }
 
-        // Each edge contributes two indices
-        triangle_indices.reserve(triangles.size() * 3);
+    /**
+     * Choose the labels to draw in the current frame, so that no two of them overlap on screen. The anchors are
+     * projected in parallel, then the labels are accepted greedily in order of priority and scale if the cells of
+     * a screen-space occupancy grid that they cover are still free. Labels on the far side of the globe aren't
+     * candidates. Does nothing unless decluttering is enabled.
+     * \param width Width of the viewport in pixels
+     * \param height Height of the viewport in pixels
+     */
+    void declutter(OrbitalCamera &camera, int width, int height, uint num_threads = 0)
+    {
+        if (!decluttering || width <= 0 || height <= 0)
+            return;
 
-        index_counter = 0;
-        int triangle_counter = 0;
-        for (auto &triangle : triangles)
+        // The order of the labels only depends on their priority and scale, so it only changes with new labels
+        if (placement_order.size() != num_labels)
         {
-            triangle_vertices.push_back(Vertex_ID_RGB(nodes[triangle.v1].lon, nodes[triangle.v1].lat, triangle.r, triangle.g, triangle.b, triangle_counter, triangle.a));
-            triangle_vertices.push_back(Vertex_ID_RGB(nodes[triangle.v2].lon, nodes[triangle.v2].lat, triangle.r, triangle.g, triangle.b, triangle_counter, triangle.a));
-            triangle_vertices.push_back(Vertex_ID_RGB(nodes[triangle.v3].lon, nodes[triangle.v3].lat, triangle.r, triangle.g, triangle.b, triangle_counter, triangle.a));
-
-            triangle_indices.push_back(index_counter++);
-            triangle_indices.push_back(index_counter++);
-            triangle_indices.push_back(index_counter++);
-
-            triangle_counter++;
-            // TODO could be possible to optimize by finding vertices of the same color
+            placement_order.resize(num_labels);
+            for (uint i = 0; i < num_labels; i++)
+                placement_order[i] = i;
+
+            const std::vector<float> &label_priorities = priorities;
+            const std::vector<float> &label_scales = scales;
+            auto placedBefore = [&label_priorities, &label_scales](uint a, uint b) {
+                if (label_priorities[a] != label_priorities[b])
+                    return label_priorities[a] > label_priorities[b];
+                if (label_scales[a] != label_scales[b])
+                    return label_scales[a] > label_scales[b];
+                return a < b;
+            };
+            parallelSort(placement_order.begin(), placement_order.end(), placedBefore, num_threads);
         }
 
-        // Allocate GPU memory and send data
-        if (triangle_vertices.size() < 1 || triangle_indices.size() < 1)
-            return;
+        // Project the corners of each label to pixels, mirroring the vertex shader. Empty boxes mark non-candidates
+        screen_boxes.resize(num_labels);
+        computeScreenBoxes(camera, width, height, num_threads);
 
-        va_size = sizeof(Vertex_ID_RGB) * triangle_vertices.size();
-        vi_size = sizeof(uint) * triangle_indices.size();
+        // Greedily occupy the grid cells covered by each label that finds all of them free
+        int cols = (width + declutter_cell_size - 1) / declutter_cell_size;
+        int rows = (height + declutter_cell_size - 1) / declutter_cell_size;
+        occupied_cells.assign((size_t)cols * rows, 0);
 
-        if (triangle_va_handle == 0 || triangle_vbo_handle == 0 || triangle_ibo_handle == 0)
+        std::vector<uint> placed;
+        for (uint label : placement_order)
         {
-            glGenVertexArrays(1, &triangle_va_handle);
-            glGenBuffers(1, &triangle_vbo_handle);
-            glGenBuffers(1, &triangle_ibo_handle);
-        }
+            const std::array<float, 4> &box = screen_boxes[label];
+            if (box[0] > box[2])
+                continue;
 
-        glBindVertexArray(triangle_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, triangle_vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, va_size, triangle_vertices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, vi_size, triangle_indices.data(), GL_STATIC_DRAW);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            int min_col = std::max(0, (int)(box[0] / declutter_cell_size));
+            int min_row = std::max(0, (int)(box[1] / declutter_cell_size));
+            int max_col = std::min(cols - 1, (int)(box[2] / declutter_cell_size));
+            int max_row = std::min(rows - 1, (int)(box[3] / declutter_cell_size));
 
-        glBindVertexArray(triangle_va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, triangle_vbo_handle);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex_ID_RGB), 0);
-        // glEnableVertexAttribArray(1);
-        // glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, true, sizeof(Vertex_ID_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        // glEnableVertexAttribArray(2);
-        // glVertexAttribPointer(2, 1, GL_INT, false, sizeof(Vertex_ID_RGB), (GLvoid *)((sizeof(GL_FLOAT) * 2) + (sizeof(GL_UNSIGNED_BYTE) * 3)));
+            bool free = true;
+            for (int row = min_row; row <= max_row && free; row++)
+            {
+                for (int col = min_col; col <= max_col && free; col++)
+                    free = (occupied_cells[(size_t)row * cols + col] == 0);
+            }
 
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 1, GL_INT, false, sizeof(Vertex_ID_RGB), (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex_ID_RGB), (GLvoid *)((sizeof(GL_FLOAT) * 2) + sizeof(GL_INT)));
+            if (!free)
+                continue;
 
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+            for (int row = min_row; row <= max_row; row++)
+                std::fill(occupied_cells.begin() + (size_t)row * cols + min_col, occupied_cells.begin() + (size_t)row * cols + max_col + 1, 1);
+
+            placed.push_back(label);
+        }
+
+        if (placed != placed_labels)
+        {
+            placed_labels.swap(placed);
+            visibility_changed = true;
+        }
     }
 
-    void draw(OrbitalCamera &camera, float triangle_transparency)
+    /**
+     * Show or hide a single label.
+     */
+    void setVisibility(size_t label, bool visible)
     {
-        glCullFace(GL_FRONT);
+        if (visibility[label] != visible)
+        {
+            visibility[label] = visible;
+            if (visible)
+                hidden_label_cnt--;
+            else
+                hidden_label_cnt++;
+            visibility_changed = true;
+        }
+    }
 
-        glUseProgram(triangle_prgm_handle);
+    void draw(OrbitalCamera &camera)
+    {
+        if (uploaded_glyph_cnt < glyphs.size())
+            uploadGlyphs();
 
-        glUniformMatrix4fv(glGetUniformLocation(triangle_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(triangle_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
-        glUniform1fv(glGetUniformLocation(triangle_prgm_handle, "transparency"), 1, &triangle_transparency);
+        bool compacted = (hidden_label_cnt > 0 || decluttering);
+        if (compacted && visibility_changed)
+            uploadVisibleGlyphs();
 
-        glBindVertexArray(triangle_va_handle);
-        glDrawElements(GL_TRIANGLES, (GLsizei)num_triangles * 3, GL_UNSIGNED_INT, nullptr);
+        size_t glyph_cnt = compacted ? visible_glyph_cnt : glyphs.size();
+        if (glyph_cnt == 0)
+            return;
 
-        glCullFace(GL_BACK);
+        // placed labels have been culled on the CPU already
+        bool culled = !decluttering && culling.cull(camera, compacted ? visible_glyph_buffer_handle : glyph_buffer_handle, glyph_cnt,
+                                                    sizeof(GlyphInstance) / sizeof(float), offsetof(GlyphInstance, scale) / sizeof(float),
+                                                    offsetof(GlyphInstance, offset) / sizeof(float) + 1, 0.0f, 6);
 
-        glEnable(GL_DEPTH_TEST);
+        glUseProgram(prgm_handle);
 
-        glUseProgram(nodeEdge_prgm_handle);
+        // bind font atlas texture
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, font_atlas_handle);
+        int zero = 0;
+        glUniform1iv(glGetUniformLocation(prgm_handle, "fontAtlas_tx2D"), 1, &zero);
 
-        glUniformMatrix4fv(glGetUniformLocation(nodeEdge_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(nodeEdge_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        // set label independent uniforms
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
 
-        // glLineWidth(std::max(1.0f, 20.0f * scale));
-        glBindVertexArray(edge_va_handle);
-        glDrawElements(GL_LINES, (GLsizei)num_edges * 2, GL_UNSIGNED_INT, nullptr);
+        if (culled)
+        {
+            culling.draw(culled_va_handle);
+            return;
+        }
 
-        // glPointSize(std::max(2.0f, 15.0f * scale));
-        glPointSize(5.0);
-        glBindVertexArray(node_va_handle);
-        glDrawElements(GL_POINTS, (GLsizei)num_nodes, GL_UNSIGNED_INT, nullptr);
+        glBindVertexArray(compacted ? visible_va_handle : va_handle);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (GLsizei)glyph_cnt);
+        glBindVertexArray(0);
+    }
 
-        t_1 = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration_cast<std::chrono::duration<double>>(t_1 - t_0).count();
-        t_0 = std::chrono::high_resolution_clock::now();
+private:
+    /** Number of glyph instances already sent to the GPU, glyphs are only ever appended */
+    size_t uploaded_glyph_cnt = 0;
+    /** Number of glyph instances the glyph buffer can hold */
+    size_t glyph_capacity = 0;
+    /** Number of labels that are currently hidden */
+    size_t hidden_label_cnt = 0;
+    /** Set whenever labels are added or their visibility changes */
+    bool visibility_changed = false;
+    /** Number of glyph instances in the visible glyph buffer */
+    size_t visible_glyph_cnt = 0;
+    /** All labels sorted by descending priority and scale */
+    std::vector<uint> placement_order;
+    /** Pixel bounding box (min x, min y, max x, max y) of each label in the current frame */
+    std::vector<std::array<float, 4>> screen_boxes;
+    /** Screen-space occupancy grid, non-zero cells are covered by a placed label */
+    std::vector<uint8_t> occupied_cells;
+    /** Labels placed by the latest declutter call, in order of placement */
+    std::vector<uint> placed_labels;
+    /** Position of each label on the unit sphere */
+    std::vector<Math::Vec3> anchors;
+
+    void appendLabel(const std::string &label_text, float latitude, float longitude, float scale, float priority)
+    {
+        num_labels++;
 
-        // Draw triangle front faces
-        glUseProgram(triangle_prgm_handle);
+        offsets.push_back(glyphs.size());
 
-        glUniformMatrix4fv(glGetUniformLocation(triangle_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(triangle_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
-        glUniform1fv(glGetUniformLocation(triangle_prgm_handle, "transparency"), 1, &triangle_transparency);
+        geoCoordinates.push_back(longitude);
+        geoCoordinates.push_back(latitude);
 
-        glBindVertexArray(triangle_va_handle);
-        glDrawElements(GL_TRIANGLES, (GLsizei)num_triangles * 3, GL_UNSIGNED_INT, nullptr);
+        // convert string to glyph instances (i.e. character to uv position in texture atlas)
+        std::vector<uint32_t> code_points = toUnicodePoints(label_text);
 
-        if (show_sphere)
+        // each glyph is 0.06 units wide and the label is centered on its geo-coordinates
+        float half_width = 0.03f * code_points.size();
+
+        uint i = 0;
+        for (auto c : code_points)
         {
-            glUseProgram(sphere_prgm_handle);
+            GlyphInstance glyph;
+            glyph.anchor = {{longitude, latitude}};
+            glyph.offset = {{-half_width + 0.06f * i++, half_width}};
+            glyph.atlas_uv = glyph_table.find(c);
+            glyph.scale = scale;
+            glyphs.push_back(glyph);
+        }
 
-            sphere_scale = (sphere_scale < sphere_target_scale) ? (sphere_scale + sphere_target_scale * dt) : sphere_target_scale;
+        lengths.push_back(code_points.size());
+        scales.push_back(scale);
+        priorities.push_back(priority);
+        visibility.push_back(true);
 
-            Math::Mat4x4 model_matrix;
-            model_matrix[0] = sphere_scale;
-            model_matrix[5] = sphere_scale;
-            model_matrix[10] = sphere_scale;
-            model_matrix[12] = sphere_world_position.x;
-            model_matrix[13] = sphere_world_position.y;
-            model_matrix[14] = sphere_world_position.z;
-            model_matrix[15] = 1.0f;
+        float lon = longitude * (PI / 180.0f);
+        float lat = latitude * (PI / 180.0f);
+        anchors.push_back(Math::Vec3(std::sin(lon) * std::cos(lat), std::sin(lat), std::cos(lat) * std::cos(lon)));
 
-            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "model_matrix"), 1, GL_FALSE, model_matrix.data.data());
-            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-            glUniformMatrix4fv(glGetUniformLocation(sphere_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        visibility_changed = true;
+    }
 
-            glCullFace(GL_FRONT);
-            // glBindVertexArray(sphere_va_handle);
-            // glDrawElements(GL_TRIANGLES, (GLsizei)num_sphere_indices, GL_UNSIGNED_INT, nullptr);
+    /**
+     * Compute the pixel bounding box of each label, or an empty box for labels that are hidden, on the far side
+     * of the globe, behind the camera or entirely off-screen.
+     */
+    void computeScreenBoxes(OrbitalCamera &camera, int width, int height, uint num_threads)
+    {
+        const Math::Mat4x4 &view = camera.view_matrix;
+        const Math::Mat4x4 &projection = camera.projection_matrix;
+
+        float camera_lon = camera.longitude * (PI / 180.0f);
+        float camera_lat = camera.latitude * (PI / 180.0f);
+        Math::Vec3 eye(std::sin(camera_lon) * std::cos(camera_lat) * camera.orbit,
+                       std::sin(camera_lat) * camera.orbit,
+                       std::cos(camera_lat) * std::cos(camera_lon) * camera.orbit);
+
+        std::vector<std::array<float, 4>> &boxes = screen_boxes;
+        auto boxRange = [this, &view, &projection, &eye, &boxes, width, height](size_t begin, size_t end) {
+            const float ccs_scale = 0.25f;
+            for (size_t i = begin; i < end; i++)
+            {
+                std::array<float, 4> &box = boxes[i];
+                box = {{1.0f, 1.0f, 0.0f, 0.0f}};
 
-            sphere.draw(1);
-        }
+                if (!visibility[i] || lengths[i] == 0)
+                    continue;
 
-        glCullFace(GL_BACK);
-        glDisable(GL_DEPTH_TEST);
-    }
+                Math::Vec3 anchor = anchors[i];
 
-    Math::Vec3 geoToCartesian(float lon, float lat)
-    {
-        float lat_sin = sin((PI / 180.0) * lat);
-        float lon_sin = sin((PI / 180.0) * lon);
+                // the globe hides anchors whose surface normal faces away from the camera
+                if (Math::dot(anchor, eye - anchor) <= 0.0f)
+                    continue;
 
-        float lat_cos = cos((PI / 180.0) * lat);
-        float lon_cos = cos((PI / 180.0) * lon);
+                float ccs[3];
+                for (int row = 0; row < 3; row++)
+                    ccs[row] = view.data[row] * anchor.x + view.data[4 + row] * anchor.y + view.data[8 + row] * anchor.z + view.data[12 + row];
 
-        float r = 1.0;
-        // Earth radius in meters = 6378137.0;
+                float label_scale = scales[i] * ccs_scale;
+                float half_width = 0.03f * lengths[i];
 
-        return Math::Vec3(lon_sin * lat_cos * r,
-                          lat_sin * r,
-                          lat_cos * lon_cos * r);
-    }
+                float min_x = std::numeric_limits<float>::max(), min_y = min_x;
+                float max_x = -min_x, max_y = -min_x;
+                bool in_front = true;
+                for (int corner = 0; corner < 4; corner++)
+                {
+                    float x = ccs[0] + ((corner & 1) ? half_width : -half_width) * label_scale;
+                    float y = ccs[1] + ((corner & 2) ? 0.1f : -0.1f) * label_scale;
+                    x -= std::max(-1.0f, std::min(1.0f, x)) * label_scale * half_width;
+
+                    float clip_x = projection.data[0] * x + projection.data[4] * y + projection.data[8] * ccs[2] + projection.data[12];
+                    float clip_y = projection.data[1] * x + projection.data[5] * y + projection.data[9] * ccs[2] + projection.data[13];
+                    float clip_w = projection.data[3] * x + projection.data[7] * y + projection.data[11] * ccs[2] + projection.data[15];
+                    if (clip_w <= 0.0f)
+                    {
+                        in_front = false;
+                        break;
+                    }
+
+                    float px = (0.5f * clip_x / clip_w + 0.5f) * width;
+                    float py = (0.5f * clip_y / clip_w + 0.5f) * height;
+                    min_x = std::min(min_x, px);
+                    max_x = std::max(max_x, px);
+                    min_y = std::min(min_y, py);
+                    max_y = std::max(max_y, py);
+                }
 
-    void pickingPass(OrbitalCamera &camera)
-    {
-        glEnable(GL_DEPTH);
+                if (!in_front || max_x < 0.0f || max_y < 0.0f || min_x >= width || min_y >= height)
+                    continue;
 
-        glBindFramebuffer(GL_FRAMEBUFFER, picking_fbo_handle);
-        glClearColor(-1, -1, -1, -1);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, 1600, 900);
+                box = {{min_x, min_y, max_x, max_y}};
+            }
+        };
+        parallelFor(num_labels, boxRange, num_threads);
+    }
 
-        GLenum bufs[1];
-        bufs[0] = GL_COLOR_ATTACHMENT0;
-        glDrawBuffers(1, bufs);
+    /**
+     * Describe the unit quad and the per glyph attributes, which are advanced once per instance, to a vertex array.
+     */
+    void setupGlyphArray(GLuint array_handle, GLuint instance_buffer_handle)
+    {
+        glBindVertexArray(array_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(GL_FLOAT) * 2, 0);
 
-        glUseProgram(picking_prgm_handle);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_handle);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(GlyphInstance), (GLvoid *)offsetof(GlyphInstance, anchor));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(GlyphInstance), (GLvoid *)offsetof(GlyphInstance, offset));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(GlyphInstance), (GLvoid *)offsetof(GlyphInstance, atlas_uv));
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, false, sizeof(GlyphInstance), (GLvoid *)offsetof(GlyphInstance, scale));
+        glVertexAttribDivisor(4, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
 
-        glUniformMatrix4fv(glGetUniformLocation(picking_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(picking_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+    /**
+     * Send the glyphs appended since the last upload to the GPU, growing the glyph buffer if neccessary.
+     */
+    void uploadGlyphs()
+    {
+        reserveBuffer(glyph_buffer_handle, glyph_capacity, uploaded_glyph_cnt, glyphs.size(), sizeof(GlyphInstance));
 
-        glBindVertexArray(triangle_va_handle);
-        glDrawElements(GL_TRIANGLES, (GLsizei)num_triangles * 3, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_ARRAY_BUFFER, glyph_buffer_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(GlyphInstance) * uploaded_glyph_cnt,
+                        sizeof(GlyphInstance) * (glyphs.size() - uploaded_glyph_cnt), &glyphs[uploaded_glyph_cnt]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        glDisable(GL_DEPTH);
+        uploaded_glyph_cnt = glyphs.size();
     }
 
-    void placeSphere(int triangle_id)
+    /**
+     * Gather the glyphs of all visible labels and send them to the GPU.
+     */
+    void uploadVisibleGlyphs()
     {
-        if (triangle_id < 0)
+        std::vector<GlyphInstance> visible_glyphs;
+        if (decluttering)
         {
-            show_sphere = false;
-            return;
+            // placed labels are visible by construction
+            for (uint i : placed_labels)
+                visible_glyphs.insert(visible_glyphs.end(), glyphs.begin() + offsets[i], glyphs.begin() + offsets[i] + lengths[i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < visibility.size(); i++)
+            {
+                if (visibility[i])
+                    visible_glyphs.insert(visible_glyphs.end(), glyphs.begin() + offsets[i], glyphs.begin() + offsets[i] + lengths[i]);
+            }
         }
 
-        Math::Vec3 v1 = geoToCartesian(nodes[triangles[triangle_id].v1].lon, nodes[triangles[triangle_id].v1].lat);
-        Math::Vec3 v2 = geoToCartesian(nodes[triangles[triangle_id].v2].lon, nodes[triangles[triangle_id].v2].lat);
-        Math::Vec3 v3 = geoToCartesian(nodes[triangles[triangle_id].v3].lon, nodes[triangles[triangle_id].v3].lat);
+        glBindBuffer(GL_ARRAY_BUFFER, visible_glyph_buffer_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphInstance) * visible_glyphs.size(), visible_glyphs.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        show_sphere = true;
-        // http://www.ics.uci.edu/~eppstein/junkyard/circumcenter.html
-        sphere_world_position = v1 + ((pow((v3 - v1).length(), 2.0f) * Math::cross(Math::cross((v2 - v1), (v3 - v1)), (v2 - v1)) + pow((v2 - v1).length(), 2.0f) * Math::cross((v3 - v1), Math::cross((v2 - v1), (v3 - v1)))) / (2.0f * pow(Math::cross((v2 - v1), (v3 - v1)).length(), 2.0f)));
-        sphere_target_scale = (sphere_world_position - v1).length();
-        sphere_scale = 0.0;
+        visible_glyph_cnt = visible_glyphs.size();
+        visibility_changed = false;
     }
 };
 
-struct CollisionSpheres
+struct Icons
 {
-    CollisionSpheres() : sphere_cnt(0),
-                         grow_factor(0.0),
-                         highest_priority(0),
-                         show_eliminations_factor(0.0),
-                         current_timestep(0),
-                         time(0.0),
-                         ss_prgm_handle(0),
-                         cs_prgm_handle(0),
-                         data_texture_handle(0),
-                         priority_texture_handle(0),
-                         ss_mesh(6),
-                         cs_mesh(3)
+    enum Icon
     {
-        // Create shader progams
-        ss_prgm_handle = createShaderProgram("../src/surface_sphere_v.glsl", "../src/surface_sphere_f.glsl", {"v_position"});
-        cs_prgm_handle = createShaderProgram("../src/collision_sphere_v.glsl", "../src/collision_sphere_f.glsl", {"v_position"});
+        ATM2,
+        BUS,
+        INFORMATION,
+        PARKINGGARAGE,
+        RESTAURANT,
+        SIGHT2,
+        TAXI,
+        TELEPHONE,
+        TOILETS,
+        TOOLS,
+        TRASH,
+        WIFI,
+        HOSPITAL,
+        CINEMA,
+        THEATER
     };
 
-    ~CollisionSpheres(){};
+    /**
+     * Per icon instance data. All icons are stored in a single buffer and drawn with a single instanced
+     * draw call of the icon quad.
+     */
+    struct IconInstance
+    {
+        /** Geo-coordinates (lon, lat) of the icon */
+        std::array<float, 2> anchor;
+        /** Lower left corner of the icon in the icon atlas */
+        std::array<float, 2> atlas_uv;
+        /** Relative scale of the icon */
+        float scale;
+    };
 
-    std::vector<CollisionSphere> collision_sphere_data;
-    uint sphere_cnt;
-    float grow_factor;
-    uint highest_priority;
-    float show_eliminations_factor;
+    std::array<float, 255> u;
+    std::array<float, 255> v;
 
-    uint current_timestep;
-    float time;
+    GLuint va_handle;
+    GLuint visible_va_handle;
+    GLuint culled_va_handle;
+    GLuint vbo_handle;
+    GLuint ibo_handle;
+
+    /** Buffer holding the instances of all icons */
+    GLuint instance_buffer_handle;
+    /** Buffer holding the instances of the visible icons in the order of the visible icon list, only used while some icons are hidden */
+    GLuint visible_instance_buffer_handle;
+
+    /** Frustum and horizon culling of the icons */
+    InstanceCulling culling;
+
+    GLuint prgm_handle;
+
+    GLuint icon_atlas_handle;
+
+    /** Total number of labels */
+    uint icon_cnt = 0;
+
+    /** Instance data of each icon */
+    std::vector<IconInstance> instances;
+    /** Type of each icon */
+    std::vector<Icon> types;
+    /** Visibility of each icon i.e. rendered or not */
+    std::vector<bool> visibility;
+    /** Compact list of the visible icons */
+    std::vector<uint32_t> visible_icons;
+    /** Position of each icon in the visible icon list, or NOT_VISIBLE */
+    std::vector<uint32_t> visible_slots;
+
+    Icons()
+    {
+        // Load text label shader program
+        prgm_handle = createShaderProgram("../src/icon_v.glsl", "../src/icon_f.glsl", {"v_position", "v_uv", "i_anchor", "i_atlasUV", "i_scale"});
+        atlas_uniform = glGetUniformLocation(prgm_handle, "iconAtlas_tx2D");
+        view_matrix_uniform = glGetUniformLocation(prgm_handle, "view_matrix");
+        projection_matrix_uniform = glGetUniformLocation(prgm_handle, "projection_matrix");
+
+        // Load icon atlas
+        unsigned long begin_pos;
+        int x_dim, y_dim;
+        char *img_data;
+        ResourceLoader::readPpmHeader("../resources/icon_atlas.ppm", begin_pos, x_dim, y_dim);
+        img_data = new char[x_dim * y_dim * 3];
+        ResourceLoader::readPpmData("../resources/icon_atlas.ppm", img_data, begin_pos, x_dim, y_dim);
+
+        glGenTextures(1, &icon_atlas_handle);
+        // assert(font_atlas_handle > 0);
+        glBindTexture(GL_TEXTURE_2D, icon_atlas_handle);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x_dim, y_dim, 0, GL_RGB, GL_UNSIGNED_BYTE, img_data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
-    /* Surface sphere program handle */
-    GLuint ss_prgm_handle;
-    /* Collision spheres program handle */
-    GLuint cs_prgm_handle;
-    /* Collision spheres data texture handle */
-    GLuint data_texture_handle;
-    /* Additional collision spheres data texture handle */
-    GLuint priority_texture_handle;
+        delete[] img_data;
 
-    /* Surface sphere mesh */
-    IcoSphere ss_mesh;
-    /* Collision spheres mesh */
-    IcoSphere cs_mesh;
+        // Create proxy geometry for icons
+        float x_min = -ICON_HALF_WIDTH;
+        float x_max = ICON_HALF_WIDTH;
+        std::array<float, 16> vertex_array = {{x_min, -0.1f, 0.0f, 0.0f,
+                                               x_min, 0.1f, 0.0f, 1.0f,
+                                               x_max, 0.1f, 1.0f, 1.0f,
+                                               x_max, -0.1f, 1.0f, 0.0f}};
+        std::array<GLuint, 6> index_array = {{0, 2, 1, 2, 0, 3}};
 
-    Math::Vec3 geoToCartesian(float lon, float lat)
-    {
-        float lat_sin = sin((PI / 180.0) * lat);
-        float lon_sin = sin((PI / 180.0) * lon);
+        glGenBuffers(1, &vbo_handle);
+        glGenBuffers(1, &ibo_handle);
+        glGenBuffers(1, &instance_buffer_handle);
+        glGenBuffers(1, &visible_instance_buffer_handle);
 
-        float lat_cos = cos((PI / 180.0) * lat);
-        float lon_cos = cos((PI / 180.0) * lon);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 16, vertex_array.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 6, index_array.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-        float r = 1.0;
-        // Earth radius in meters = 6378137.0;
+        // One vertex array draws all icons, the other the visible icons only
+        glGenVertexArrays(1, &va_handle);
+        glGenVertexArrays(1, &visible_va_handle);
+        setupIconArray(va_handle, instance_buffer_handle);
+        setupIconArray(visible_va_handle, visible_instance_buffer_handle);
 
-        return Math::Vec3(lon_sin * lat_cos * r,
-                          lat_sin * r,
-                          lat_cos * lon_cos * r);
+        // A third one draws the icons that survived culling
+        culled_va_handle = 0;
+        if (culling.init())
+        {
+            glGenVertexArrays(1, &culled_va_handle);
+            setupIconArray(culled_va_handle, culling.visible_buffer_handle);
+        }
     }
 
-    void moveTimestep(int direction)
+    Icons(const Icons &) = delete;
+    ~Icons()
     {
+        glDeleteBuffers(1, &vbo_handle);
+        glDeleteBuffers(1, &ibo_handle);
+        glDeleteBuffers(1, &instance_buffer_handle);
+        glDeleteBuffers(1, &visible_instance_buffer_handle);
+        glDeleteVertexArrays(1, &va_handle);
+        glDeleteVertexArrays(1, &visible_va_handle);
+        glDeleteVertexArrays(1, &culled_va_handle);
 
-        current_timestep = (static_cast<int>(current_timestep) + direction < 0) ? 0u : std::min(current_timestep + direction, sphere_cnt);
+        glDeleteProgram(prgm_handle);
 
-        time = collision_sphere_data[current_timestep].collision_time;
+        glDeleteTextures(1, &icon_atlas_handle);
     }
 
-    static constexpr double DEG_TO_RAD = 0.017453292519943295769236907684886;
-    static constexpr double EARTH_RADIUS_IN_CENTIMETERS = 637279756.0856;
-
-    double haversine(const CollisionSphere &from, const CollisionSphere &to)
+    void addIcon(Icon icon, float latitude, float longitude, float scale)
     {
-        double lat_arc = (from.lat - to.lat) * DEG_TO_RAD;
-        double lon_arc = (from.lon - to.lon) * DEG_TO_RAD;
-        double lat_h = sin(lat_arc * 0.5);
-        lat_h *= lat_h;
-        double lon_h = sin(lon_arc * 0.5);
-        lon_h *= lon_h;
-        double tmp = cos(from.lat * DEG_TO_RAD) * cos(to.lat * DEG_TO_RAD);
-        return 2.0 * asin(sqrt(lat_h + tmp * lon_h));
+        appendIcon(icon, latitude, longitude, scale);
     }
 
-    void loadData(std::vector<CollisionSphere> &spheres, std::map<uint, uint> &id_map)
+    /**
+     * Add many icons at once. The new instances are sent to the GPU with a single upload before the next draw.
+     */
+    void addIcons(const std::vector<Icon> &icon_types, const std::vector<float> &latitudes,
+                  const std::vector<float> &longitudes, const std::vector<float> &icon_scales)
     {
-        // Copy data
-        collision_sphere_data = spheres;
+        assert(icon_types.size() == latitudes.size() && icon_types.size() == longitudes.size() && icon_types.size() == icon_scales.size());
 
-        sphere_cnt = spheres.size() - 4;
+        instances.reserve(instances.size() + icon_types.size());
+        types.reserve(types.size() + icon_types.size());
+        visibility.reserve(visibility.size() + icon_types.size());
+        visible_icons.reserve(visible_icons.size() + icon_types.size());
+        visible_slots.reserve(visible_slots.size() + icon_types.size());
 
-        current_timestep = (sphere_cnt > 1000) ? sphere_cnt - 1000 : 0;
-        time = spheres[current_timestep].collision_time;
+        for (size_t i = 0; i < icon_types.size(); i++)
+            appendIcon(icon_types[i], latitudes[i], longitudes[i], icon_scales[i]);
+    }
 
-        // Extract information from collision sphere and store in texture for rendering
-        uint tx_height = std::ceil(static_cast<float>(sphere_cnt) / 8096.0f);
-        std::vector<float> tx_data(8096 * tx_height * 4, 0.0f);
-        std::vector<float> prio_tx_data(8096 * tx_height * 2, 0.0f);
+    /**
+     * Remove all icons. The GPU buffers are kept for the icons added afterwards.
+     */
+    void clear()
+    {
+        icon_cnt = 0;
+        instances.clear();
+        types.clear();
+        visibility.clear();
+        visible_icons.clear();
+        visible_slots.clear();
+
+        uploaded_instance_cnt = 0;
+        hidden_icon_cnt = 0;
+        uploaded_visible_cnt = 0;
+        visible_buffer_valid = false;
+        dirty_slots.clear();
+    }
 
-        float min_priority = static_cast<float>(spheres[sphere_cnt - 1].priority);
+    /**
+     * Show or hide a single icon. Only the affected entries of the visible instance buffer are updated before the next draw.
+     */
+    void setVisibility(size_t icon, bool visible)
+    {
+        if (visibility[icon] == visible)
+            return;
 
-        for (int i = (sphere_cnt - 1); i >= 0; i = i - 1)
+        visibility[icon] = visible;
+        if (visible)
         {
-            tx_data[i * 4 + 0] = (spheres[i].lat);
-            tx_data[i * 4 + 1] = (spheres[i].lon);
-
-            // approximate radius in 3d space
-            auto search = id_map.find(spheres[i].collision_partner_id);
-            assert(search != id_map.end());
-            uint q_idx = search->second;
-            assert(q_idx < spheres.size());
-
-            // Math::Vec3 p = geoToCartesian(spheres[i].lon, spheres[i].lat);
-            // Math::Vec3 q = geoToCartesian(spheres[q_idx].lon, spheres[q_idx].lat);
-            double rp = spheres[i].radius;
-            double rq = spheres[q_idx].radius;
-
-            // float d = (p - q).length();
-            double d = haversine(spheres[i], spheres[q_idx]);
-
-            double bl = d * (rp / (rp + rq));
-            double radius = 2.0 * ::sin(bl / 2.0);
-
-            tx_data[i * 4 + 2] = (radius);
-            tx_data[i * 4 + 3] = (spheres[i].collision_time);
-
-            min_priority = std::min(min_priority, static_cast<float>(spheres[i].priority));
-            prio_tx_data[i * 2 + 0] = static_cast<float>(spheres[i].priority);
-            prio_tx_data[i * 2 + 1] = min_priority;
-
-            highest_priority = std::max(highest_priority, spheres[i].priority);
+            hidden_icon_cnt--;
+            showIcon(icon);
+        }
+        else
+        {
+            hidden_icon_cnt++;
+
+            // move the last visible icon into the slot of the hidden one to keep the list compact
+            uint32_t slot = visible_slots[icon];
+            uint32_t last = visible_icons.back();
+            visible_icons[slot] = last;
+            visible_slots[last] = slot;
+            visible_icons.pop_back();
+            visible_slots[icon] = NOT_VISIBLE;
+            markDirty(slot);
         }
-
-        if (data_texture_handle == 0)
-            glGenTextures(1, &data_texture_handle);
-        glBindTexture(GL_TEXTURE_2D, data_texture_handle);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 8096, tx_height, 0, GL_RGBA, GL_FLOAT, tx_data.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        if (priority_texture_handle == 0)
-            glGenTextures(1, &priority_texture_handle);
-        glBindTexture(GL_TEXTURE_2D, priority_texture_handle);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, 8096, tx_height, 0, GL_RG, GL_FLOAT, prio_tx_data.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void draw(OrbitalCamera &camera)
     {
-        glCullFace(GL_FRONT);
-        glEnable(GL_DEPTH_TEST);
+        if (uploaded_instance_cnt < instances.size())
+            uploadInstances();
 
-        // draw planetary surface sphere
-        glUseProgram(ss_prgm_handle);
-        glUniformMatrix4fv(glGetUniformLocation(ss_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(ss_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
-        ss_mesh.draw(1);
+        if (hidden_icon_cnt > 0)
+        {
+            uploadVisibleInstances();
+        }
+        else
+        {
+            // the visible instance buffer is not kept up to date while all icons are drawn from the instance buffer
+            visible_buffer_valid = false;
+            dirty_slots.clear();
+        }
 
-        // draw collision spheres
-        glUseProgram(cs_prgm_handle);
+        size_t instance_cnt = (hidden_icon_cnt > 0) ? visible_icons.size() : instances.size();
+        if (instance_cnt == 0)
+            return;
 
-        glUniformMatrix4fv(glGetUniformLocation(cs_prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(cs_prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        bool culled = culling.cull(camera, (hidden_icon_cnt > 0) ? visible_instance_buffer_handle : instance_buffer_handle, instance_cnt,
+                                   sizeof(IconInstance) / sizeof(float), offsetof(IconInstance, scale) / sizeof(float), -1, ICON_HALF_WIDTH, 6);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, data_texture_handle);
-        int zero = 0;
-        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "data_tx2D"), 1, &zero);
+        glUseProgram(prgm_handle);
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, priority_texture_handle);
-        int one = 1;
-        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "priority_data_tx2D"), 1, &one);
+        // bind font atlas texture
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, icon_atlas_handle);
+        glUniform1i(atlas_uniform, 0);
 
-        glUniform1fv(glGetUniformLocation(cs_prgm_handle, "time"), 1, &time);
-        float zpo = 0.0001;
-        glUniform1fv(glGetUniformLocation(cs_prgm_handle, "grow_factor"), 1, &zpo);
-        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "mode"), 1, &Controls::collisionSphere_mode);
-        glUniform1uiv(glGetUniformLocation(cs_prgm_handle, "id_offset"), 1, &current_timestep);
-        glUniform1uiv(glGetUniformLocation(cs_prgm_handle, "highest_priority"), 1, &highest_priority);
+        // set label independent uniforms
+        glUniformMatrix4fv(view_matrix_uniform, 1, GL_FALSE, camera.view_matrix.data.data());
+        glUniformMatrix4fv(projection_matrix_uniform, 1, GL_FALSE, camera.projection_matrix.data.data());
 
-        uint remaining_sphere_cnt = sphere_cnt - current_timestep;
-        int show_elimination_idx = remaining_sphere_cnt * show_eliminations_factor;
-        glUniform1iv(glGetUniformLocation(cs_prgm_handle, "show_elimination_idx"), 1, &show_elimination_idx);
+        if (culled)
+        {
+            culling.draw(culled_va_handle);
+            return;
+        }
 
-        cs_mesh.draw(remaining_sphere_cnt);
-        glCullFace(GL_BACK);
-        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray((hidden_icon_cnt > 0) ? visible_va_handle : va_handle);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, (GLsizei)instance_cnt);
+        glBindVertexArray(0);
     }
-};
-
-/**
- * Collection of text labels on the map.
- */
-struct TextLabels
-{
-    std::array<float, 255> u;
-    std::array<float, 255> v;
 
-    TextLabels()
+private:
+    /** Half the width of the icon quad, its half height is 0.1 */
+    static constexpr float ICON_HALF_WIDTH = 0.086f;
+    static constexpr uint32_t NOT_VISIBLE = std::numeric_limits<uint32_t>::max();
+    /** Dirty slots at most this far apart are uploaded as one range, resending the clean slots in between */
+    static constexpr uint32_t DIRTY_GAP = 64;
+
+    GLint atlas_uniform;
+    GLint view_matrix_uniform;
+    GLint projection_matrix_uniform;
+
+    /** Number of instances already sent to the GPU, icons are only ever appended */
+    size_t uploaded_instance_cnt = 0;
+    /** Number of instances the instance buffer can hold */
+    size_t instance_capacity = 0;
+    /** Number of icons that are currently hidden */
+    size_t hidden_icon_cnt = 0;
+    /** Number of instances the visible instance buffer can hold */
+    size_t visible_capacity = 0;
+    /** Length of the visible icon list at the last upload of the visible instance buffer */
+    size_t uploaded_visible_cnt = 0;
+    /** Whether the visible instance buffer matches the visible icon list apart from the dirty slots */
+    bool visible_buffer_valid = false;
+    /** Slots of the visible icon list that changed since the last upload */
+    std::vector<uint32_t> dirty_slots;
+
+    void appendIcon(Icon icon, float latitude, float longitude, float scale)
     {
-        // std::vector<std::basic_string<wchar_t>> atlas_rows;
-
-        // atlas_rows.push_back(L"ABCDEFGHIJKLMN");
-        // atlas_rows.push_back(L"OPQRSTUVWXYZab");
-        // atlas_rows.push_back(L"cdefghijklmnop");
-        // atlas_rows.push_back(L"qrstuvwxyz1234");
-        // atlas_rows.push_back(L"567890&@.,?!'\"");
-        // atlas_rows.push_back(L"\"()*-_ßöäü");
-
-        // Using u16string, hoping to gain support for umlauts
-        std::vector<std::vector<uint16_t>> u16_atlas_rows;
-
-        u16_atlas_rows.push_back(toUnicodePoints("ABCDEFGHIJKLMN"));
-        u16_atlas_rows.push_back(toUnicodePoints("OPQRSTUVWXYZab"));
-        u16_atlas_rows.push_back(toUnicodePoints("cdefghijklmnop"));
-        u16_atlas_rows.push_back(toUnicodePoints("qrstuvwxyz1234"));
-        u16_atlas_rows.push_back(toUnicodePoints("567890&@.,?!'\""));
-        u16_atlas_rows.push_back(toUnicodePoints("\"()*-_ßöäüÖÄÜ"));
-
-        float u_value = 1.0f / 16.0f;
-        float v_value = 5.0f / 6.0f;
+        icon_cnt++;
 
-        for (auto &s : u16_atlas_rows)
-        {
-            for (auto c : s)
-            {
-                u[c] = u_value;
-                u_value += 1.0f / 16.0f;
-                v[c] = v_value;
+        IconInstance instance;
+        instance.anchor = {{longitude, latitude}};
+        instance.atlas_uv = {{(1.0f / 9.0f) + 2.0f * (1.0f / 9.0f) * (icon % 4),
+                              (1.0f / 9.0f) + 2.0f * (1.0f / 9.0f) * std::floor(icon / 4.0f)}};
+        instance.scale = scale;
+        instances.push_back(instance);
+        types.push_back(icon);
 
-                // std::cout << "Char: " << (char16_t)c << " Code: " << (int)c
-                //     << " u: " << u[c] << " v: " << v[c] << std::endl;
-            }
+        visibility.push_back(true);
+        visible_slots.push_back(NOT_VISIBLE);
+        showIcon(instances.size() - 1);
+    }
 
-            u_value = 1.0f / 16.0f;
-            v_value -= 1.0f / 6.0f;
-        }
+    void showIcon(size_t icon)
+    {
+        visible_slots[icon] = visible_icons.size();
+        visible_icons.push_back(icon);
+        markDirty(visible_slots[icon]);
+    }
 
-        // Generate vertex and index buffer array and allocate enough space for 10000 labels
-        glGenVertexArrays(1, &va_handle);
-        glGenBuffers(1, &vbo_handle);
-        glGenBuffers(1, &ibo_handle);
+    void markDirty(uint32_t slot)
+    {
+        // a full upload follows anyway if the buffer is stale or most of it changed
+        if (visible_buffer_valid && dirty_slots.size() < visible_icons.size() / 4)
+            dirty_slots.push_back(slot);
+        else
+            visible_buffer_valid = false;
+    }
 
-        glBindVertexArray(va_handle);
+    /**
+     * Describe the icon quad and the per icon attributes, which are advanced once per instance, to a vertex array.
+     */
+    void setupIconArray(GLuint array_handle, GLuint buffer_handle)
+    {
+        glBindVertexArray(array_handle);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        // each label uses vertex data worth 16 floats
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 16 * 10000, NULL, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
-        // each label uses 6 indices
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 6 * 10000, NULL, GL_STATIC_DRAW);
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(GL_FLOAT) * 4, 0);
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(GL_FLOAT) * 4, (GLvoid *)(sizeof(GL_FLOAT) * 2));
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_handle);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(IconInstance), (GLvoid *)offsetof(IconInstance, anchor));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(IconInstance), (GLvoid *)offsetof(IconInstance, atlas_uv));
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 1, GL_FLOAT, false, sizeof(IconInstance), (GLvoid *)offsetof(IconInstance, scale));
+        glVertexAttribDivisor(4, 1);
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // Load text label shader program
-        prgm_handle = createShaderProgram("../src/textLabel_v.glsl", "../src/textLabel_f.glsl", {"v_position", "v_uv"});
-
-        // Load font atlas
-        unsigned long begin_pos;
-        int x_dim, y_dim;
-        char *img_data;
-        ResourceLoader::readPpmHeader("../resources/font_atlas.ppm", begin_pos, x_dim, y_dim);
-        img_data = new char[x_dim * y_dim * 3];
-        ResourceLoader::readPpmData("../resources/font_atlas.ppm", img_data, begin_pos, x_dim, y_dim);
-
-        glGenTextures(1, &font_atlas_handle);
-        // assert(font_atlas_handle > 0);
-        glBindTexture(GL_TEXTURE_2D, font_atlas_handle);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x_dim, y_dim, 0, GL_RGB, GL_UNSIGNED_BYTE, img_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 3);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        delete[] img_data;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
-    /* Structs and classes that free OpenGL resources within their destructor
-     * should be non-copyable to prevent bad stuff from happening
+
+    /**
+     * Send the icons appended since the last upload to the GPU, growing the instance buffer if neccessary.
      */
-    TextLabels(const TextLabels &) = delete;
-    ~TextLabels()
+    void uploadInstances()
     {
-        // delete mesh resources
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glDeleteBuffers(1, &ibo_handle);
+        reserveBuffer(instance_buffer_handle, instance_capacity, uploaded_instance_cnt, instances.size(), sizeof(IconInstance));
+
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(IconInstance) * uploaded_instance_cnt,
+                        sizeof(IconInstance) * (instances.size() - uploaded_instance_cnt), &instances[uploaded_instance_cnt]);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDeleteBuffers(1, &vbo_handle);
-        glBindVertexArray(0);
-        glDeleteVertexArrays(1, &va_handle);
 
-        // delete GLSL program
-        glDeleteProgram(prgm_handle);
+        uploaded_instance_cnt = instances.size();
+    }
 
-        // delete font atlas
-        glDeleteTextures(1, &font_atlas_handle);
+    /**
+     * Bring the visible instance buffer in line with the visible icon list. Only dirty slots are sent
+     * unless the buffer is stale, in which case all visible instances are gathered and sent.
+     */
+    void uploadVisibleInstances()
+    {
+        if (visible_buffer_valid && dirty_slots.empty() && uploaded_visible_cnt == visible_icons.size())
+            return;
 
-        for (GLuint tx_handle : text_texture_handles)
-            glDeleteTextures(1, &tx_handle);
-    }
+        if (visible_buffer_valid)
+        {
+            reserveBuffer(visible_instance_buffer_handle, visible_capacity, std::min(uploaded_visible_cnt, visible_icons.size()),
+                          visible_icons.size(), sizeof(IconInstance));
 
-    GLuint va_handle;
+            // Dirty slots are sent as contiguous ranges, slots beyond the end of the list belonged to icons hidden afterwards
+            // and sort last
+            std::sort(dirty_slots.begin(), dirty_slots.end());
+            std::vector<IconInstance> range_instances;
 
-    GLuint vbo_handle;
+            glBindBuffer(GL_ARRAY_BUFFER, visible_instance_buffer_handle);
+            size_t i = 0;
+            while (i < dirty_slots.size() && dirty_slots[i] < visible_icons.size())
+            {
+                uint32_t first = dirty_slots[i];
+                uint32_t last = first;
+                for (; i < dirty_slots.size() && dirty_slots[i] < visible_icons.size() && dirty_slots[i] <= last + DIRTY_GAP; i++)
+                    last = dirty_slots[i];
+
+                range_instances.clear();
+                for (uint32_t slot = first; slot <= last; slot++)
+                    range_instances.push_back(instances[visible_icons[slot]]);
+                glBufferSubData(GL_ARRAY_BUFFER, sizeof(IconInstance) * first, sizeof(IconInstance) * range_instances.size(), range_instances.data());
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        else
+        {
+            std::vector<IconInstance> visible_instances(visible_icons.size());
+            for (size_t i = 0; i < visible_icons.size(); i++)
+                visible_instances[i] = instances[visible_icons[i]];
 
-    GLuint ibo_handle;
+            reserveBuffer(visible_instance_buffer_handle, visible_capacity, 0, visible_instances.size(), sizeof(IconInstance));
 
-    GLuint prgm_handle;
+            glBindBuffer(GL_ARRAY_BUFFER, visible_instance_buffer_handle);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(IconInstance) * visible_instances.size(), visible_instances.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
 
-    GLuint font_atlas_handle;
+        uploaded_visible_cnt = visible_icons.size();
+        dirty_slots.clear();
+        visible_buffer_valid = true;
+    }
+};
 
-    /** Total number of labels */
-    uint num_labels = 0;
+constexpr float Icons::ICON_HALF_WIDTH;
+constexpr uint32_t Icons::NOT_VISIBLE;
+constexpr uint32_t Icons::DIRTY_GAP;
 
-    /** Geo-Cooridnates of each label */
-    std::vector<float> geoCoordinates;
-    /** String of each label encoded as look-up-texture for font altas */
-    std::vector<GLuint> text_texture_handles;
-    /** Number of characters of each label */
-    std::vector<unsigned int> lengths;
-    /** Relative scale of each label */
-    std::vector<float> scales;
-    /** Visibility of each label i.e. rendered or not */
-    std::vector<bool> visibility;
-    /** Index array offset to beginning of label */
-    std::vector<size_t> offsets;
+/**
+ * Hierarchical grid over geo-coordinates. Level l has 2^(l + 1) columns and 2^l rows of cells that are 180 / 2^l
+ * degrees wide. Cells are identified by the Z-order code of their column and row, so the code of a cell on a coarser
+ * level is its code on a finer level shifted right, and the cells within a coarser cell are consecutive in code order.
+ */
+namespace GeoGrid
+{
+    /** The finest level uses 16 bits for the column and 15 bits for the row */
+    constexpr int LEVEL_CNT = 16;
 
-    void addLabel(std::string label_text, float latitude, float longitude, float scale)
+    /**
+     * Code of the cell containing the geo-coordinates on the finest level.
+     */
+    uint32_t cellCode(float latitude, float longitude)
     {
-        if (num_labels < 10000)
-        {
+        uint16_t x = (uint16_t)std::max(0.0f, std::min(65535.0f, (longitude + 180.0f) * (65536.0f / 360.0f)));
+        uint16_t y = (uint16_t)std::max(0.0f, std::min(32767.0f, (latitude + 90.0f) * (32768.0f / 180.0f)));
+        return Math::mortonCode(x, y);
+    }
 
-            num_labels++;
+    /**
+     * Right shift turning the code of a cell on the finest level into the code of its cell on the given level.
+     */
+    uint shift(int level)
+    {
+        return 2 * (LEVEL_CNT - 1 - level);
+    }
 
-            // Create basic quad mesh for rendering characters
-            float x_min = (-0.03f * label_text.length());
-            float x_max = (0.03f * label_text.length());
-            std::array<float, 16> vertex_array = {{x_min, -0.1f, 0.0f, 0.0f,
-                                                   x_min, 0.1f, 0.0f, 1.0f,
-                                                   x_max, 0.1f, 1.0f, 1.0f,
-                                                   x_max, -0.1f, 1.0f, 0.0f}};
-            uint offset = num_labels * 4;
-            std::array<GLuint, 6> index_array = {{offset + 0, offset + 2, offset + 1, offset + 2, offset + 0, offset + 3}};
+    /**
+     * Level whose cells split the visible part of the earth into about cells_per_view rows. Exceeds the finest
+     * level when the camera is close to the ground.
+     */
+    int level(const OrbitalCamera &camera, float cells_per_view)
+    {
+        // angular size of the visible part of the earth, whole hemisphere once the camera is far enough away
+        float view_extent = std::min(180.0f, (camera.orbit - 1.0f) * 2.0f * std::tan(camera.fovy / 2.0f) * (180.0f / PI));
+        float cell_size = view_extent / cells_per_view;
 
-            glBindVertexArray(va_handle);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-            // each label uses vertex data worth 16 floats
-            glBufferSubData(GL_ARRAY_BUFFER, num_labels * sizeof(vertex_array), sizeof(vertex_array), vertex_array.data());
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
-            // each label uses 6 indices
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, num_labels * sizeof(index_array), sizeof(index_array), index_array.data());
-            glBindVertexArray(0);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        return std::max(0, (int)std::floor(std::log2(180.0f / cell_size)));
+    }
 
-            offsets.push_back(num_labels * sizeof(index_array));
+    /**
+     * Column and row range (min col, min row, max col, max row) of the cells of a level overlapping the bounds.
+     * Columns may lie outside of the grid and have to be wrapped around the antimeridian.
+     */
+    std::array<int, 4> cellRange(const GeoBoundingBox &bounds, int level)
+    {
+        float cell_size = 180.0f / (1 << level);
+        int row_cnt = 1 << level;
+        int col_cnt = 2 << level;
 
-            geoCoordinates.push_back(longitude);
-            geoCoordinates.push_back(latitude);
+        int min_col = (int)std::floor((bounds.min_longitude + 180.0f) / cell_size);
+        int max_col = std::min(min_col + col_cnt - 1, (int)std::floor((bounds.max_longitude + 180.0f) / cell_size));
+        int min_row = std::max(0, (int)std::floor((bounds.min_latitude + 90.0f) / cell_size));
+        int max_row = std::min(row_cnt - 1, (int)std::floor((bounds.max_latitude + 90.0f) / cell_size));
 
-            // convert string to text texture (i.e. character to uv position in texture atlas)
-            float *data = new float[label_text.length() * 2];
-            // for (size_t i = 0; i < label_text.length(); i++)
-            // {
-            //     std::cout << "Char: " << label_text[i] << " Code: " << (uint)label_text[i]
-            //               << " u: " << u[(int)label_text[i]] << " v: " << v[(int)label_text[i]] << std::endl;
-            //     data[i * 2] = u[label_text[i]];
-            //     data[i * 2 + 1] = v[label_text[i]];
-            // }
+        return {{min_col, min_row, max_col, max_row}};
+    }
 
-            std::vector<uint16_t> u16_label_text = toUnicodePoints(label_text);
+    size_t cellCount(const std::array<int, 4> &range)
+    {
+        return (size_t)(range[2] - range[0] + 1) * (size_t)(range[3] - range[1] + 1);
+    }
 
-            uint i = 0;
-            for (auto &c : u16_label_text)
+    /**
+     * Call function(code) for each cell of a level within a cell range.
+     */
+    template <typename Function>
+    void forEachCell(const std::array<int, 4> &range, int level, Function function)
+    {
+        int col_cnt = 2 << level;
+        for (int row = range[1]; row <= range[3]; row++)
+        {
+            for (int col = range[0]; col <= range[2]; col++)
             {
-                // std::cout << "Char: " << c << " Code: " << (int)c << " u: " << u[c] << " v: " << v[c] << std::endl;
-
-                data[i++] = u[c];
-                data[i++] = v[c];
+                // wrap around the antimeridian
+                uint16_t x = (uint16_t)((col % col_cnt + col_cnt) % col_cnt);
+                function(Math::mortonCode(x, (uint16_t)row));
             }
+        }
+    }
+}
 
-            GLuint texture_handle = 0;
-            glGenTextures(1, &texture_handle);
-            // assert(font_atlas_handle > 0);
-            glBindTexture(GL_TEXTURE_2D, texture_handle);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, label_text.length(), 1, 0, GL_RG, GL_FLOAT, data);
-            glBindTexture(GL_TEXTURE_2D, 0);
+/**
+ * Hierarchical grid clustering of icons. Level l groups the icons in cells of 180 / 2^l degrees,
+ * every cell of a level is split into four cells of the next level. Depending on the camera orbit,
+ * the clusters of one level are drawn instead of the icons as a single badge per cluster, showing
+ * the most common icon type of the cluster and the number of icons in it.
+ */
+struct IconClusters
+{
+    struct Cluster
+    {
+        /** Z-order code of the cell of the cluster on its level */
+        uint32_t cell;
+        float latitude;
+        float longitude;
+        uint32_t count;
+        Icons::Icon icon;
+    };
 
-            text_texture_handles.push_back(texture_handle);
+    /** Clusters of each level, levels that would mostly consist of single icons are not built */
+    std::vector<std::vector<Cluster>> levels;
 
-            lengths.push_back(label_text.length());
-            scales.push_back(scale);
-            visibility.push_back(true);
-        }
-    }
+    /** Number of cells the visible part of the earth is split into vertically */
+    float cells_per_view = 8.0f;
 
-    void draw(OrbitalCamera &camera)
+    IconClusters() {}
+    IconClusters(const IconClusters &) = delete;
+
+    /**
+     * (Re-)Build the cluster levels of a set of icons, replacing the current ones.
+     */
+    void build(const Icons &icons, uint num_threads = 0)
     {
-        glUseProgram(prgm_handle);
+        levels.clear();
+        level_offsets.clear();
+        badge_labels.clear();
+        shown_badges.clear();
 
-        // bind font atlas texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, font_atlas_handle);
-        int zero = 0;
-        glUniform1iv(glGetUniformLocation(prgm_handle, "fontAtlas_tx2D"), 1, &zero);
+        const size_t icon_cnt = icons.instances.size();
+        if (icon_cnt == 0)
+            return;
 
-        // set label independent uniforms
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        // Key each icon by its cell on the finest level, Z-order keeps the cells of a parent cell consecutive
+        std::vector<uint32_t> keys(icon_cnt);
+        auto keyRange = [&icons, &keys](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                keys[i] = GeoGrid::cellCode(icons.instances[i].anchor[1], icons.instances[i].anchor[0]);
+        };
+        parallelFor(icon_cnt, keyRange, num_threads);
 
-        glBindVertexArray(va_handle);
+        std::vector<uint32_t> order(icon_cnt);
+        for (uint32_t i = 0; i < icon_cnt; i++)
+            order[i] = i;
+        parallelSort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; }, num_threads);
 
-        for (size_t i = 0; i < visibility.size(); i++)
-        {
-            if (visibility[i])
+        // Count the clusters of each level to find the first level that is mostly single icons
+        std::vector<size_t> cluster_cnts(GeoGrid::LEVEL_CNT);
+        auto countRange = [&keys, &order, &cluster_cnts](size_t begin, size_t end) {
+            for (size_t level = begin; level < end; level++)
             {
-                glUniform2fv(glGetUniformLocation(prgm_handle, "label_geoCoords"), 1, &geoCoordinates[i * 2]);
-                float charCount = (float)lengths[i];
-                glUniform1fv(glGetUniformLocation(prgm_handle, "label_charCount"), 1, &charCount);
-                glUniform1fv(glGetUniformLocation(prgm_handle, "label_scale"), 1, &scales[i]);
+                uint shift = GeoGrid::shift(level);
+                size_t cnt = 1;
+                for (size_t i = 1; i < order.size(); i++)
+                {
+                    if ((keys[order[i]] >> shift) != (keys[order[i - 1]] >> shift))
+                        cnt++;
+                }
+                cluster_cnts[level] = cnt;
+            }
+        };
+        parallelFor(GeoGrid::LEVEL_CNT, countRange, num_threads);
 
-                // bind content texture
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, text_texture_handles[i]);
-                int one = 1;
-                glUniform1iv(glGetUniformLocation(prgm_handle, "label_text_tx2D"), 1, &one);
+        size_t level_cnt = 0;
+        while (level_cnt < GeoGrid::LEVEL_CNT && cluster_cnts[level_cnt] <= icon_cnt / 2)
+            level_cnt++;
 
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void *)offsets[i]);
+        levels.resize(level_cnt);
+        auto clusterRange = [&icons, &keys, &order, this](size_t begin, size_t end) {
+            for (size_t level = begin; level < end; level++)
+            {
+                uint shift = GeoGrid::shift(level);
+                for (size_t first = 0; first < order.size();)
+                {
+                    uint32_t cell = keys[order[first]] >> shift;
+                    std::array<uint32_t, Icons::THEATER + 1> type_cnts{};
+                    double lat_sum = 0.0;
+                    double lon_sum = 0.0;
+                    size_t last = first;
+                    for (; last < order.size() && (keys[order[last]] >> shift) == cell; last++)
+                    {
+                        const Icons::IconInstance &instance = icons.instances[order[last]];
+                        lon_sum += instance.anchor[0];
+                        lat_sum += instance.anchor[1];
+                        type_cnts[icons.types[order[last]]]++;
+                    }
+
+                    Cluster cluster;
+                    cluster.cell = cell;
+                    cluster.count = (uint32_t)(last - first);
+                    cluster.latitude = (float)(lat_sum / cluster.count);
+                    cluster.longitude = (float)(lon_sum / cluster.count);
+                    cluster.icon = (Icons::Icon)(std::max_element(type_cnts.begin(), type_cnts.end()) - type_cnts.begin());
+                    levels[level].push_back(cluster);
+
+                    first = last;
+                }
+            }
+        };
+        parallelFor(level_cnt, clusterRange, num_threads);
+
+        // Add the badges of all levels at once and only show those of the active level
+        std::vector<Icons::Icon> badge_types;
+        std::vector<float> badge_lats, badge_lons, badge_scales;
+        std::vector<std::string> count_texts;
+        std::vector<float> count_lats, count_lons, count_scales, count_priorities;
+        for (auto &level : levels)
+        {
+            level_offsets.push_back(badge_types.size());
+            for (auto &cluster : level)
+            {
+                // badges grow slowly with the number of icons they stand for
+                float scale = BADGE_SCALE * std::min(2.0f, 1.0f + 0.1f * std::log2((float)cluster.count));
+                badge_types.push_back(cluster.icon);
+                badge_lats.push_back(cluster.latitude);
+                badge_lons.push_back(cluster.longitude);
+                badge_scales.push_back(scale);
+                badge_labels.push_back(cluster.count > 1 ? (uint32_t)count_texts.size() : NO_LABEL);
+
+                if (cluster.count > 1)
+                {
+                    // below the badge, the quads of icons and glyphs both are 0.2 * 0.25 * scale high in view space
+                    count_texts.push_back(std::to_string(cluster.count));
+                    count_lats.push_back(std::max(-90.0f, cluster.latitude - 0.05f * scale * (180.0f / PI)));
+                    count_lons.push_back(cluster.longitude);
+                    count_scales.push_back(scale);
+                    count_priorities.push_back((float)cluster.count);
+                }
             }
         }
+
+        badges.reset(new Icons());
+        counts.reset(new TextLabels());
+        badges->addIcons(badge_types, badge_lats, badge_lons, badge_scales);
+        counts->addLabels(count_texts, count_lats, count_lons, count_scales, count_priorities);
+        for (size_t i = 0; i < badge_types.size(); i++)
+            badges->setVisibility(i, false);
+        for (size_t i = 0; i < count_texts.size(); i++)
+            counts->setVisibility(i, false);
     }
-};
 
-struct Icons
-{
-    enum Icon
+    /**
+     * Level whose clusters are drawn at the camera's orbit, or -1 if the icons should be drawn individually.
+     */
+    int level(const OrbitalCamera &camera) const
     {
-        ATM2,
-        BUS,
-        INFORMATION,
-        PARKINGGARAGE,
-        RESTAURANT,
-        SIGHT2,
-        TAXI,
-        TELEPHONE,
-        TOILETS,
-        TOOLS,
-        TRASH,
-        WIFI,
-        HOSPITAL,
-        CINEMA,
-        THEATER
-    };
+        int level = GeoGrid::level(camera, cells_per_view);
+        return (level < (int)levels.size()) ? level : -1;
+    }
 
-    std::array<float, 255> u;
-    std::array<float, 255> v;
+    /**
+     * Draw the clusters of the level matching the camera orbit that lie in view. Returns false if the icons
+     * should be drawn individually instead.
+     */
+    bool draw(OrbitalCamera &camera, int width, int height)
+    {
+        int active_level = level(camera);
+
+        std::vector<uint32_t> shown;
+        if (active_level >= 0)
+            collectClustersInView(camera, active_level, shown);
+        std::sort(shown.begin(), shown.end());
+
+        // only touch the badges entering or leaving the view
+        std::vector<uint32_t> changed;
+        std::set_difference(shown_badges.begin(), shown_badges.end(), shown.begin(), shown.end(), std::back_inserter(changed));
+        for (auto badge : changed)
+            setBadgeVisibility(badge, false);
+        changed.clear();
+        std::set_difference(shown.begin(), shown.end(), shown_badges.begin(), shown_badges.end(), std::back_inserter(changed));
+        for (auto badge : changed)
+            setBadgeVisibility(badge, true);
+        shown_badges.swap(shown);
+
+        if (active_level < 0)
+            return false;
 
-    GLuint va_handle;
-    GLuint vbo_handle;
-    GLuint ibo_handle;
+        badges->draw(camera);
+        counts->declutter(camera, width, height);
+        counts->draw(camera);
+        return true;
+    }
 
-    GLuint prgm_handle;
+private:
+    static constexpr float BADGE_SCALE = 0.25f;
+    static constexpr uint32_t NO_LABEL = std::numeric_limits<uint32_t>::max();
+
+    /** Badge of each cluster of all levels */
+    std::unique_ptr<Icons> badges;
+    /** Icon count of each cluster with more than one icon of all levels */
+    std::unique_ptr<TextLabels> counts;
+    /** Index of the first badge of each level */
+    std::vector<size_t> level_offsets;
+    /** Count label of each badge, or NO_LABEL for clusters of a single icon */
+    std::vector<uint32_t> badge_labels;
+    /** Currently visible badges, sorted */
+    std::vector<uint32_t> shown_badges;
+
+    void setBadgeVisibility(uint32_t badge, bool visible)
+    {
+        badges->setVisibility(badge, visible);
+        if (badge_labels[badge] != NO_LABEL)
+            counts->setVisibility(badge_labels[badge], visible);
+    }
 
-    GLuint icon_atlas_handle;
+    /**
+     * Badges of the clusters of a level whose cells overlap the spherical cap seen by the camera.
+     * The number of cells looked up only depends on the cells per view, not on the number of icons.
+     */
+    void collectClustersInView(const OrbitalCamera &camera, int level, std::vector<uint32_t> &shown) const
+    {
+        const std::vector<Cluster> &clusters = levels[level];
+        std::array<int, 4> range = GeoGrid::cellRange(camera.computeVisibleBounds(), level);
 
-    /** Total number of labels */
-    uint icon_cnt = 0;
+        // fall back to all clusters of the level when they are fewer than the cells in view
+        if (GeoGrid::cellCount(range) >= clusters.size())
+        {
+            for (size_t i = 0; i < clusters.size(); i++)
+                shown.push_back(level_offsets[level] + i);
+            return;
+        }
 
-    /** Geo-Cooridnates of each label */
-    std::vector<float> geoCoordinates;
-    /** Relative scale of each icon */
-    std::vector<float> scales;
-    /** Visibility of each icon i.e. rendered or not */
-    std::vector<bool> visibility;
-    /** */
-    std::vector<float> atlas_uv;
+        // clusters are sorted by the Z-order code of their cell
+        GeoGrid::forEachCell(range, level, [&](uint32_t cell) {
+            auto it = std::lower_bound(clusters.begin(), clusters.end(), cell, [](const Cluster &c, uint32_t code) { return c.cell < code; });
+            if (it != clusters.end() && it->cell == cell)
+                shown.push_back(level_offsets[level] + (it - clusters.begin()));
+        });
+    }
+};
 
-    Icons()
+constexpr float IconClusters::BADGE_SCALE;
+constexpr uint32_t IconClusters::NO_LABEL;
+
+/**
+ * Spatial index over points of interest, which feeds the icons and labels of the points in view to its own
+ * renderers. For each level of the GeoGrid down to the first one holding at most MAX_POINTS_PER_CELL points in
+ * every cell, the index keeps the points of highest priority per cell. Finer levels read all points of a cell
+ * from the points sorted by cell. Points are only sent to the GPU once they come into view for the first time.
+ */
+struct PoiLayer
+{
+    /** Number of cells the visible part of the earth is split into vertically */
+    float cells_per_view = 8.0f;
+
+    PoiLayer(const PoiStore &poi_store, uint num_threads = 0) : pois(poi_store)
     {
-        // Load text label shader program
-        prgm_handle = createShaderProgram("../src/icon_v.glsl", "../src/icon_f.glsl", {"v_position", "v_uv"});
+        const size_t point_cnt = pois.size();
 
-        // Load icon atlas
-        unsigned long begin_pos;
-        int x_dim, y_dim;
-        char *img_data;
-        ResourceLoader::readPpmHeader("../resources/icon_atlas.ppm", begin_pos, x_dim, y_dim);
-        img_data = new char[x_dim * y_dim * 3];
-        ResourceLoader::readPpmData("../resources/icon_atlas.ppm", img_data, begin_pos, x_dim, y_dim);
+        cells.resize(point_cnt);
+        auto cellRange = [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                cells[i] = GeoGrid::cellCode(pois.latitudes[i], pois.longitudes[i]);
+        };
+        parallelFor(point_cnt, cellRange, num_threads);
+
+        order.resize(point_cnt);
+        for (uint32_t i = 0; i < point_cnt; i++)
+            order[i] = i;
+        const std::vector<uint32_t> &point_cells = cells;
+        parallelSort(order.begin(), order.end(), [&point_cells](uint32_t a, uint32_t b) { return point_cells[a] < point_cells[b]; }, num_threads);
+        gathered_cells.resize(point_cnt);
+        for (size_t i = 0; i < point_cnt; i++)
+            gathered_cells[i] = cells[order[i]];
+
+        // Find the first level on which no cell holds more points than are shown per cell
+        std::vector<size_t> max_points(GeoGrid::LEVEL_CNT);
+        auto maxRange = [this, &max_points](size_t begin, size_t end) {
+            for (size_t level = begin; level < end; level++)
+            {
+                uint shift = GeoGrid::shift(level);
+                size_t max_cnt = 0;
+                for (size_t first = 0, last = 0; first < gathered_cells.size(); first = last)
+                {
+                    for (last = first + 1; last < gathered_cells.size() && (gathered_cells[last] >> shift) == (gathered_cells[first] >> shift); last++)
+                        ;
+                    max_cnt = std::max(max_cnt, last - first);
+                }
+                max_points[level] = max_cnt;
+            }
+        };
+        parallelFor(GeoGrid::LEVEL_CNT, maxRange, num_threads);
 
-        glGenTextures(1, &icon_atlas_handle);
-        // assert(font_atlas_handle > 0);
-        glBindTexture(GL_TEXTURE_2D, icon_atlas_handle);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, x_dim, y_dim, 0, GL_RGB, GL_UNSIGNED_BYTE, img_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        size_t level_cnt = 0;
+        while (level_cnt < (size_t)GeoGrid::LEVEL_CNT && max_points[level_cnt] > MAX_POINTS_PER_CELL)
+            level_cnt++;
 
-        // Create proxy geometry for icons
-        float x_min = -0.086f;
-        float x_max = 0.086f;
-        std::array<float, 16> vertex_array = {{x_min, -0.1f, 0.0f, 0.0f,
-                                               x_min, 0.1f, 0.0f, 1.0f,
-                                               x_max, 0.1f, 1.0f, 1.0f,
-                                               x_max, -0.1f, 1.0f, 0.0f}};
-        std::array<GLuint, 6> index_array = {{0, 2, 1, 2, 0, 3}};
+        levels.resize(level_cnt);
+        const std::vector<float> &priorities = pois.priorities;
+        auto levelRange = [this, &priorities](size_t begin, size_t end) {
+            for (size_t level = begin; level < end; level++)
+            {
+                uint shift = GeoGrid::shift(level);
+                Level &index = levels[level];
+                index.offsets.push_back(0);
+                for (size_t first = 0, last = 0; first < order.size(); first = last)
+                {
+                    uint32_t cell = gathered_cells[first] >> shift;
+                    for (last = first + 1; last < order.size() && (gathered_cells[last] >> shift) == cell; last++)
+                        ;
+
+                    // keep the points of highest priority, ties are broken by file order
+                    std::vector<uint32_t> points(order.begin() + first, order.begin() + last);
+                    size_t kept = std::min(points.size(), MAX_POINTS_PER_CELL);
+                    std::partial_sort(points.begin(), points.begin() + kept, points.end(), [&priorities](uint32_t a, uint32_t b) {
+                        return (priorities[a] != priorities[b]) ? priorities[a] > priorities[b] : a < b;
+                    });
+
+                    index.cells.push_back(cell);
+                    index.points.insert(index.points.end(), points.begin(), points.begin() + kept);
+                    index.offsets.push_back(index.points.size());
+                }
+            }
+        };
+        parallelFor(level_cnt, levelRange, num_threads);
 
-        glGenVertexArrays(1, &va_handle);
-        glGenBuffers(1, &vbo_handle);
-        glGenBuffers(1, &ibo_handle);
+        icon_slots.assign(point_cnt, NO_SLOT);
+        label_slots.assign(point_cnt, NO_SLOT);
+    }
+    PoiLayer(const PoiLayer &) = delete;
 
-        glBindVertexArray(va_handle);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_handle);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 16, vertex_array.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 6, index_array.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(GL_FLOAT) * 4, 0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(GL_FLOAT) * 4, (GLvoid *)(sizeof(GL_FLOAT) * 2));
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    /**
+     * Show the icons and labels of the points in view at the current zoom, hide all others and draw them.
+     * Points leaving the view stay in the renderers until they outnumber the points in view, then the renderers
+     * are refilled with the points in view only. Thus the work per frame, e.g. decluttering the labels, is bounded
+     * by the number of points in view rather than by all points ever seen.
+     */
+    void draw(OrbitalCamera &camera, int width, int height)
+    {
+        std::vector<uint32_t> shown;
+        collectPointsInView(camera, shown);
+        std::sort(shown.begin(), shown.end());
+
+        if (added_points.size() > 2 * shown.size() + MIN_RENDERED_POINTS)
+            clearRenderers();
+
+        // only touch the points entering or leaving the view
+        std::vector<uint32_t> changed;
+        std::set_difference(shown_points.begin(), shown_points.end(), shown.begin(), shown.end(), std::back_inserter(changed));
+        for (auto point : changed)
+            setPointVisibility(point, false);
+        changed.clear();
+        std::set_difference(shown.begin(), shown.end(), shown_points.begin(), shown_points.end(), std::back_inserter(changed));
+        addPoints(changed);
+        shown_points.swap(shown);
+
+        icons.draw(camera);
+        labels.declutter(camera, width, height);
+        labels.draw(camera);
     }
 
-    ~Icons()
+private:
+    /** Number of points shown per cell of the grid level matching the zoom */
+    static constexpr size_t MAX_POINTS_PER_CELL = 16;
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+    static constexpr float POI_SCALE = 0.25f;
+    /** Hidden points are kept in the renderers as long as there are at most this many points in them */
+    static constexpr size_t MIN_RENDERED_POINTS = 4096;
+
+    /** Points of highest priority of each occupied cell of a level */
+    struct Level
     {
+        /** Codes of the occupied cells in ascending order */
+        std::vector<uint32_t> cells;
+        /** Points of cell i are points[offsets[i], offsets[i + 1]) */
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> points;
+    };
+
+    const PoiStore &pois;
+
+    /** Cell of each point on the finest level */
+    std::vector<uint32_t> cells;
+    /** Points in ascending order of their cell */
+    std::vector<uint32_t> order;
+    /** Cell of each point of order */
+    std::vector<uint32_t> gathered_cells;
+    std::vector<Level> levels;
+
+    Icons icons;
+    TextLabels labels;
+    /** Icon and label of each point in the renderers, NO_SLOT unless the point is in them */
+    std::vector<uint32_t> icon_slots;
+    std::vector<uint32_t> label_slots;
+    /** Points in the renderers, either shown or hidden */
+    std::vector<uint32_t> added_points;
+    /** Currently visible points, sorted */
+    std::vector<uint32_t> shown_points;
+
+    void clearRenderers()
+    {
+        for (auto point : added_points)
+        {
+            icon_slots[point] = NO_SLOT;
+            label_slots[point] = NO_SLOT;
+        }
+        added_points.clear();
+        shown_points.clear();
+
+        icons.clear();
+        labels.clear();
     }
 
-    void addIcon(Icon icon, float latitude, float longitude, float scale)
+    void setPointVisibility(uint32_t point, bool visible)
     {
-        icon_cnt++;
+        if (icon_slots[point] != NO_SLOT)
+            icons.setVisibility(icon_slots[point], visible);
+        if (label_slots[point] != NO_SLOT)
+            labels.setVisibility(label_slots[point], visible);
+    }
 
-        geoCoordinates.push_back(longitude);
-        geoCoordinates.push_back(latitude);
+    /**
+     * Show points entering the view, appending those that aren't in the renderers yet.
+     */
+    void addPoints(const std::vector<uint32_t> &points)
+    {
+        std::vector<Icons::Icon> icon_types;
+        std::vector<float> icon_lats, icon_lons;
+        std::vector<std::string> texts;
+        std::vector<float> label_lats, label_lons, label_priorities;
+        for (auto point : points)
+        {
+            // points already in the renderers either have an icon or a label
+            if (icon_slots[point] != NO_SLOT || label_slots[point] != NO_SLOT)
+            {
+                setPointVisibility(point, true);
+                continue;
+            }
 
-        float uv_x = (1.0f / 9.0f) + 2.0f * (1.0f / 9.0f) * (icon % 4);
-        float uv_y = (1.0f / 9.0f) + 2.0f * (1.0f / 9.0f) * std::floor(icon / 4.0f);
+            int8_t icon = pois.icons[point];
+            bool has_icon = (icon >= 0 && icon <= Icons::THEATER);
+            if (has_icon)
+            {
+                icon_slots[point] = icons.icon_cnt + icon_types.size();
+                icon_types.push_back((Icons::Icon)icon);
+                icon_lats.push_back(pois.latitudes[point]);
+                icon_lons.push_back(pois.longitudes[point]);
+            }
 
-        atlas_uv.push_back(uv_x);
-        atlas_uv.push_back(uv_y);
+            if (pois.label_offsets[point + 1] > pois.label_offsets[point])
+            {
+                // below the icon, the quads of icons and glyphs both are 0.2 * 0.25 * scale high in view space
+                float lat = pois.latitudes[point];
+                if (has_icon)
+                    lat = std::max(-90.0f, lat - 0.05f * POI_SCALE * (180.0f / PI));
+
+                label_slots[point] = labels.num_labels + texts.size();
+                texts.push_back(pois.label(point));
+                label_lats.push_back(lat);
+                label_lons.push_back(pois.longitudes[point]);
+                label_priorities.push_back(pois.priorities[point]);
+            }
 
-        scales.push_back(scale);
+            if (icon_slots[point] != NO_SLOT || label_slots[point] != NO_SLOT)
+                added_points.push_back(point);
+        }
 
-        visibility.push_back(true);
+        if (!icon_types.empty())
+            icons.addIcons(icon_types, icon_lats, icon_lons, std::vector<float>(icon_types.size(), POI_SCALE));
+        if (!texts.empty())
+            labels.addLabels(texts, label_lats, label_lons, std::vector<float>(texts.size(), POI_SCALE), label_priorities);
     }
 
-    void draw(OrbitalCamera &camera)
+    /**
+     * Points in cells overlapping the part of the earth seen by the camera, limited to the points of highest
+     * priority per cell on levels coarser than the zoom.
+     */
+    void collectPointsInView(const OrbitalCamera &camera, std::vector<uint32_t> &shown) const
     {
-        glUseProgram(prgm_handle);
-
-        // bind font atlas texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, icon_atlas_handle);
-        int zero = 0;
-        glUniform1iv(glGetUniformLocation(prgm_handle, "iconAtlas_tx2D"), 1, &zero);
-
-        // set label independent uniforms
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "view_matrix"), 1, GL_FALSE, camera.view_matrix.data.data());
-        glUniformMatrix4fv(glGetUniformLocation(prgm_handle, "projection_matrix"), 1, GL_FALSE, camera.projection_matrix.data.data());
+        if (order.empty())
+            return;
 
-        glBindVertexArray(va_handle);
+        int level = std::min(GeoGrid::level(camera, cells_per_view), GeoGrid::LEVEL_CNT - 1);
+        std::array<int, 4> range = GeoGrid::cellRange(camera.computeVisibleBounds(), level);
 
-        for (size_t i = 0; i < visibility.size(); i++)
+        if (level < (int)levels.size())
         {
-            if (visibility[i])
-            {
-                glUniform2fv(glGetUniformLocation(prgm_handle, "icon_geoCoords"), 1, &geoCoordinates[i * 2]);
-                glUniform1fv(glGetUniformLocation(prgm_handle, "icon_scale"), 1, &scales[i]);
-                glUniform2fv(glGetUniformLocation(prgm_handle, "icon_atlasUV"), 1, &atlas_uv[i * 2]);
+            const Level &index = levels[level];
 
-                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            // fall back to all cells of the level when they are fewer than the cells in view
+            if (GeoGrid::cellCount(range) >= index.cells.size())
+            {
+                shown = index.points;
+                return;
             }
+
+            GeoGrid::forEachCell(range, level, [&](uint32_t cell) {
+                auto it = std::lower_bound(index.cells.begin(), index.cells.end(), cell);
+                if (it != index.cells.end() && *it == cell)
+                {
+                    size_t i = it - index.cells.begin();
+                    shown.insert(shown.end(), index.points.begin() + index.offsets[i], index.points.begin() + index.offsets[i + 1]);
+                }
+            });
+            return;
         }
+
+        // all points of the cells in view, the cells within a cell are consecutive in the sorted points
+        uint shift = GeoGrid::shift(level);
+        GeoGrid::forEachCell(range, level, [&](uint32_t cell) {
+            auto first = std::lower_bound(gathered_cells.begin(), gathered_cells.end(), cell << shift);
+            auto last = std::lower_bound(first, gathered_cells.end(), (uint64_t)(cell + 1) << shift);
+            shown.insert(shown.end(), order.begin() + (first - gathered_cells.begin()), order.begin() + (last - gathered_cells.begin()));
+        });
     }
 };
 
+constexpr size_t PoiLayer::MAX_POINTS_PER_CELL;
+constexpr uint32_t PoiLayer::NO_SLOT;
+constexpr float PoiLayer::POI_SCALE;
+constexpr size_t PoiLayer::MIN_RENDERED_POINTS;
+
 /**
  * Collection of polygons on the map.
  */
@@ -3090,9 +9019,61 @@ namespace Controls
     {
         std::array<float, 2> latest_cursor_position = {{0.0, 0.0}};
 
-        TriangleGraph *active_triangleGraph;
+        TriangleGraph *active_triangleGraph = nullptr;
 
         CollisionSpheres *active_collisionSpheres = nullptr;
+
+        RouteOverlay *active_routeOverlay = nullptr;
+
+        IsochroneOverlay *active_isochroneOverlay = nullptr;
+
+        ComponentOverlay *active_componentOverlay = nullptr;
+
+        TextLabels *active_textLabels = nullptr;
+
+        Graph *active_filteredGraph = nullptr;
+        uint active_filteredSubgraph = 0;
+        const std::vector<EdgeFilter> *active_edgeFilters = nullptr;
+        /* 0 shows all edges, i > 0 applies filter i - 1 */
+        size_t active_edgeFilter = 0;
+
+        void applyEdgeFilter(size_t filter)
+        {
+            active_edgeFilter = filter;
+            Subgraph &subgraph = active_filteredGraph->getSubgraph(active_filteredSubgraph);
+            size_t edge_cnt = subgraph.edge_count;
+
+            if (filter == 0)
+            {
+                active_filteredGraph->clearEdgeFilter(active_filteredSubgraph);
+                std::cout << "Edge filter off: " << edge_cnt << " edges" << std::endl;
+            }
+            else if (active_filteredGraph->setEdgeFilter(active_filteredSubgraph, (*active_edgeFilters)[filter - 1]))
+            {
+                std::cout << "Edge filter \"" << (*active_edgeFilters)[filter - 1].expression << "\": "
+                          << subgraph.visibleEdgeCount() << " of " << edge_cnt << " edges" << std::endl;
+            }
+        }
+
+        /**
+         * Geo coordinates of the point on the globe under the cursor.
+         * \return False if the cursor isn't over the globe
+         */
+        bool cursorToGeo(GLFWwindow *window, float &lon, float &lat)
+        {
+            OrbitalCamera *active_camera = reinterpret_cast<OrbitalCamera *>(glfwGetWindowUserPointer(window));
+
+            int window_width, window_height;
+            glfwGetWindowSize(window, &window_width, &window_height);
+
+            double pos_x, pos_y;
+            glfwGetCursorPos(window, &pos_x, &pos_y);
+
+            float ndc_x = (float)(2.0 * pos_x / (double)window_width - 1.0);
+            float ndc_y = (float)(1.0 - 2.0 * pos_y / (double)window_height);
+
+            return active_camera->screenToGeo(ndc_x, ndc_y, lon, lat);
+        }
     }
 
     void mouseScrollFeedback(GLFWwindow *window, double x_offset, double y_offset)
@@ -3125,27 +9106,22 @@ namespace Controls
     {
         if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_RELEASE)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            int width, height;
-            glfwGetFramebufferSize(window, &width, &height);
-
-            double pos_x, pos_y;
-            glfwGetCursorPos(window, &pos_x, &pos_y);
-
-            double pos_x_normalized = (pos_x / (double)width);
-            double pos_y_normalized = (pos_y / (double)height);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, active_triangleGraph->picking_fbo_handle);
-            GLfloat *data = new GLfloat[1];
-            data[0] = -1;
-            glReadBuffer(GL_COLOR_ATTACHMENT0);
-            glReadPixels((GLint)(pos_x_normalized * 1600.0), (GLint)(900.0 - pos_y_normalized * 900.0), 1, 1, GL_RED_INTEGER, GL_INT, data);
+            float lon, lat;
+            bool on_globe = cursorToGeo(window, lon, lat);
+            bool shift = (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS);
 
-            // std::cout << "Id: " << (int)*data << std::endl;
-
-            active_triangleGraph->placeSphere((int)*data);
+            if (active_triangleGraph != nullptr)
+            {
+                if (!on_globe)
+                    active_triangleGraph->placeSphere(-1);
+                else if (shift)
+                    active_triangleGraph->insertPoint(lon, lat);
+                else
+                    active_triangleGraph->pick(lon, lat);
+            }
 
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (active_routeOverlay != nullptr && on_globe && !shift)
+                active_routeOverlay->click(lon, lat);
         }
     }
 
@@ -3159,6 +9135,31 @@ namespace Controls
         case GLFW_KEY_C:
             if (action == GLFW_PRESS)
                 collisionSphere_mode = (collisionSphere_mode == 0) ? 1 : 0;
+            break;
+        case GLFW_KEY_V:
+            if (action == GLFW_PRESS && active_triangleGraph != nullptr)
+                active_triangleGraph->highlightDelaunayViolations();
+            break;
+        case GLFW_KEY_D:
+            if (action == GLFW_PRESS && active_triangleGraph != nullptr)
+                active_triangleGraph->toggleVoronoiDiagram();
+            break;
+        case GLFW_KEY_I:
+            if (action == GLFW_PRESS && active_isochroneOverlay != nullptr)
+                active_isochroneOverlay->clear();
+            break;
+        case GLFW_KEY_K:
+            if (action == GLFW_PRESS && active_componentOverlay != nullptr)
+                active_componentOverlay->nextMode();
+            break;
+        case GLFW_KEY_F:
+            if (action == GLFW_PRESS && active_edgeFilters != nullptr)
+                applyEdgeFilter((active_edgeFilter + 1) % (active_edgeFilters->size() + 1));
+            break;
+        case GLFW_KEY_L:
+            if (action == GLFW_PRESS && active_textLabels != nullptr)
+                active_textLabels->toggleDecluttering();
+            break;
         default:
             break;
         }
@@ -3196,6 +9197,52 @@ namespace Controls
     {
         active_collisionSpheres = cs;
     }
+
+    void setActiveRouteOverlay(RouteOverlay *ro)
+    {
+        active_routeOverlay = ro;
+    }
+
+    void setActiveIsochroneOverlay(IsochroneOverlay *io)
+    {
+        active_isochroneOverlay = io;
+    }
+
+    void setActiveComponentOverlay(ComponentOverlay *co)
+    {
+        active_componentOverlay = co;
+    }
+
+    void setActiveTextLabels(TextLabels *tl)
+    {
+        active_textLabels = tl;
+    }
+
+    /**
+     * Set the filters that F cycles through for a subgraph and apply the first one.
+     */
+    void setActiveEdgeFilters(Graph *graph, uint subgraph, const std::vector<EdgeFilter> *filters)
+    {
+        active_filteredGraph = graph;
+        active_filteredSubgraph = subgraph;
+        active_edgeFilters = filters;
+        applyEdgeFilter(1);
+    }
+
+    /**
+     * Move the source of the isochrone to the cursor while shift and the left mouse button are held down.
+     */
+    void updateIsochrone(GLFWwindow *window)
+    {
+        if (active_isochroneOverlay == nullptr ||
+            glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) != GLFW_PRESS ||
+            glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) != GLFW_PRESS)
+            return;
+
+        float lon, lat;
+        if (cursorToGeo(window, lon, lat))
+            active_isochroneOverlay->setSource(lon, lat);
+    }
 }
 
 void help(std::ostream &out)
@@ -3209,6 +9256,26 @@ void help(std::ostream &out)
            "\t-bg float float float float\n"
            "\t\t\t  set the background color\n"
            "\t-opengl3\t  use opengl 3 instead of 4\n"
+           "\t--reorder curve\t  curve=[hilbert, morton] stores the nodes of a .gl graph\n"
+           "\t\t\t  along a space-filling curve after loading\n"
+           "\t--routing\t  prepare shortest route queries on a .gl graph, the\n"
+           "\t\t\t  preprocessing is cached in <graph.gl>.ch\n"
+           "\t--isochrone km\t  colour the edges of a .gl graph by distance from a node\n"
+           "\t\t\t  up to the given cutoff\n"
+           "\t--components n\t  find the connected components of a .gl graph and highlight\n"
+           "\t\t\t  those with fewer than n nodes\n"
+           "\t--filter expr\t  only draw the edges of a .gl graph matching expr, e.g.\n"
+           "\t\t\t  \"width>=3\", \"color=2-3,5\" or \"width!=1 color<4\".\n"
+           "\t\t\t  May be given several times (OpenGL 4.3)\n"
+           "\t--palette file\t  colours of the edge classes of a .gl graph, one line\n"
+           "\t\t\t  \"class r g b [a]\" per changed class, a = 0 hides it\n"
+           "\t--poi file\t  show points of interest, one line \"lat lon icon priority\n"
+           "\t\t\t  label\" per point with icon -1 for none, or the binary\n"
+           "\t\t\t  format written by --poi-bin\n"
+           "\t--poi-bin file\t  write the points of interest loaded by --poi in binary\n"
+           "\t\t\t  format, which loads faster\n"
+           "\t--heatmap orbit\t  show the density of the edges of a .gl graph instead of\n"
+           "\t\t\t  the edges while the camera orbit is above the given one\n"
            "\t--debug\t\t  enable some debugging output\n"
            "\t--no-bg-sphere\t  disable the background sphere\n"
            "\t--no-angle-labels\n"
@@ -3219,6 +9286,21 @@ void help(std::ostream &out)
            "\t\t\t  and orbit is the zoom: 0 = max zoom-in and 3 = whole earth.\n"
            "\t\t\t  May be changed later by zooming and right-click drag-and-drop\n"
            "\n"
+           "KEYS:\n"
+           "\tclick\t\t  show the circumsphere of the triangle under the cursor\n"
+           "\tshift+click\t  insert a node into the triangulation\n"
+           "\tclick, click\t  show the shortest route between two nodes (--routing)\n"
+           "\tshift+drag\t  show distances from the node under the cursor (--isochrone)\n"
+           "\tI\t\t  clear the isochrone\n"
+           "\tK\t\t  cycle through edge colours, small components and all\n"
+           "\t\t\t  components (--components)\n"
+           "\tF\t\t  cycle through the edge filters and all edges (--filter)\n"
+           "\tL\t\t  toggle hiding labels that overlap labels of higher priority\n"
+           "\tC\t\t  toggle the collision sphere mode\n"
+           "\tV\t\t  highlight triangles violating the Delaunay property\n"
+           "\tD\t\t  toggle the Voronoi diagram dual to the triangulation\n"
+           "\tESC\t\t  quit\n"
+           "\n"
         << std::flush;
 }
 
@@ -3244,6 +9326,15 @@ int main(const int argc, char *argv[])
     bool disableBgSphere = false;
     bool angleLabels = true;
     GraphFileFormat gff = GFF_INVALID;
+    SpatialOrder::Curve nodeOrder = SpatialOrder::NONE;
+    bool routing = false;
+    float isochroneCutoff = 0.0f;
+    uint componentMinSize = 0;
+    std::vector<EdgeFilter> edgeFilters;
+    float heatmapOrbit = 0.0f;
+    std::string palettePath;
+    std::string poiPath;
+    std::string poiBinPath;
 
     /* Create a orbital camera */
     OrbitalCamera configCamera;
@@ -3347,6 +9438,143 @@ int main(const int argc, char *argv[])
                 return -1;
             }
         }
+        else if (argv[i] == (std::string) "--reorder")
+        {
+            i++;
+            if (i < argc)
+            {
+                std::string token(argv[i]);
+                i++;
+                if (token == "hilbert")
+                {
+                    nodeOrder = SpatialOrder::HILBERT;
+                }
+                else if (token == "morton")
+                {
+                    nodeOrder = SpatialOrder::MORTON;
+                }
+                else
+                {
+                    std::cerr << "Unkown space-filling curve: " << token << std::endl;
+                    return -1;
+                }
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --reorder" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--routing")
+        {
+            i++;
+            routing = true;
+        }
+        else if (argv[i] == (std::string) "--isochrone")
+        {
+            i++;
+            if (i < argc && argv[i][0] != '-')
+            {
+                isochroneCutoff = std::stof(argv[i]) * 1000.0f;
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --isochrone" << std::endl;
+                return -1;
+            }
+            // The cutoff is the upper end of the colormap, so it has to be a finite distance
+            if (!std::isfinite(isochroneCutoff) || isochroneCutoff <= 0.0f)
+            {
+                std::cerr << "Invalid parameter for --isochrone, expected a positive distance in km" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--components")
+        {
+            i++;
+            if (i < argc && argv[i][0] != '-')
+            {
+                componentMinSize = std::stoul(argv[i]);
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --components" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--filter")
+        {
+            i++;
+            EdgeFilter filter;
+            if (i < argc && EdgeFilter::parse(argv[i], filter))
+            {
+                edgeFilters.push_back(filter);
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing or invalid parameter for --filter" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--palette")
+        {
+            i++;
+            if (i < argc)
+            {
+                palettePath = argv[i];
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --palette" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--poi")
+        {
+            i++;
+            if (i < argc)
+            {
+                poiPath = argv[i];
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --poi" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--poi-bin")
+        {
+            i++;
+            if (i < argc)
+            {
+                poiBinPath = argv[i];
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --poi-bin" << std::endl;
+                return -1;
+            }
+        }
+        else if (argv[i] == (std::string) "--heatmap")
+        {
+            i++;
+            if (i < argc && argv[i][0] != '-')
+            {
+                heatmapOrbit = std::stof(argv[i]);
+                i++;
+            }
+            else
+            {
+                std::cerr << "Missing parameter for --heatmap" << std::endl;
+                return -1;
+            }
+        }
         else if (argv[i] == (std::string) "-opengl3")
         {
             ++i;
@@ -3448,12 +9676,13 @@ int main(const int argc, char *argv[])
     // Load graph data from file
     ////////////////////////////
 
-    std::vector<Node> nodes;
-    std::vector<Edge> edges;
-
-    std::vector<Node_RGB> nodes_rgb;
-    std::vector<Edge_RGB> edges_rgb;
-    std::vector<Triangle_RGB> triangles_rgb;
+    GraphStore graph;
+    /* Node ID in the graph file of each loaded .gl node, which differs from its index if the nodes are reordered */
+    std::vector<uint> nodeIds;
+    /* Picks the node under the cursor for routes and isochrones */
+    NodeGrid nodeGrid;
+    ContractionHierarchy hierarchy;
+    ConnectedComponents components;
 
     std::vector<CollisionSphere> cSpheres;
     std::map<uint, uint> idMap;
@@ -3476,10 +9705,55 @@ int main(const int argc, char *argv[])
     switch (gff)
     {
     case GFF_GL:
-        Parser::parseTxtGraphFile(filepath, nodes, edges);
+        Parser::parseTxtGraphFile(filepath, graph);
+        {
+            auto t_start = std::chrono::high_resolution_clock::now();
+            nodeIds = SpatialOrder::reorderNodes(graph, nodeOrder);
+            auto t_end = std::chrono::high_resolution_clock::now();
+            if (nodeOrder != SpatialOrder::NONE)
+                std::cout << "Reordered " << graph.nodeCount() << " nodes and " << graph.edgeCount() << " edges in "
+                          << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl;
+        }
+        if (routing || isochroneCutoff > 0.0f)
+            nodeGrid.build(graph);
+        if (routing && hierarchy.load(filepath + ".ch", graph))
+        {
+            std::cout << "Loaded " << hierarchy.arcs.size() << " upward and core arcs from " << filepath << ".ch" << std::endl;
+        }
+        else if (routing)
+        {
+            auto t_start = std::chrono::high_resolution_clock::now();
+            size_t core_cnt = hierarchy.build(graph);
+            auto t_end = std::chrono::high_resolution_clock::now();
+            std::cout << "Contracted " << graph.nodeCount() - core_cnt << " of " << graph.nodeCount() << " nodes in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms, "
+                      << hierarchy.arcs.size() << " upward and core arcs" << std::endl;
+
+            if (!hierarchy.save(filepath + ".ch", graph))
+                std::cerr << "Could not write " << filepath << ".ch" << std::endl;
+        }
+        if (componentMinSize > 0)
+        {
+            auto t_start = std::chrono::high_resolution_clock::now();
+            components.build(graph);
+            auto t_end = std::chrono::high_resolution_clock::now();
+
+            size_t small_cnt = 0;
+            size_t isolated_cnt = 0;
+            for (uint32_t size : components.sizes)
+            {
+                small_cnt += (size < componentMinSize);
+                isolated_cnt += (size == 1);
+            }
+            std::cout << "Found " << components.componentCount() << " connected components in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms, "
+                      << "largest has " << (components.sizes.empty() ? 0 : components.sizes[0]) << " nodes, "
+                      << small_cnt << " have fewer than " << componentMinSize << " nodes, "
+                      << isolated_cnt << " are isolated nodes" << std::endl;
+        }
         break;
     case GFF_SG:
-        Parser::parseTxtTriangleGraphFile(filepath, nodes_rgb, edges_rgb, triangles_rgb);
+        Parser::parseTxtTriangleGraphFile(filepath, graph);
         break;
     case GFF_RAW:
         Parser::parseTxtCollisionSpheresFile(filepath, cSpheres, idMap);
@@ -3489,6 +9763,23 @@ int main(const int argc, char *argv[])
         return -1;
     }
 
+    PoiStore pois;
+    if (!poiPath.empty())
+    {
+        auto t_start = std::chrono::high_resolution_clock::now();
+        if (!Parser::parsePoiFile(poiPath, pois))
+        {
+            std::cerr << "Could not read points of interest from " << poiPath << std::endl;
+            return -1;
+        }
+        auto t_end = std::chrono::high_resolution_clock::now();
+        std::cout << "Loaded " << pois.size() << " points of interest in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl;
+
+        if (!poiBinPath.empty() && !Parser::writeBinPoiFile(poiBinPath, pois))
+            std::cerr << "Could not write " << poiBinPath << std::endl;
+    }
+
     /////////////////////////////////////////////////////////////////////
     // Creation of graphics resources, i.e. shader programs, meshes, etc.
     /////////////////////////////////////////////////////////////////////
@@ -3507,14 +9798,68 @@ int main(const int argc, char *argv[])
 
         /* Create renderable graph (mesh) */
         Graph lineGraph;
+        uint graphSubgraph = 0;
         if (gff == GFF_GL)
-            lineGraph.addSubgraph(nodes, edges);
+            graphSubgraph = lineGraph.addSubgraph(graph);
+
+        /* Recolour the edge classes, which only replaces the palette texture */
+        if (gff == GFF_GL && !palettePath.empty())
+        {
+            EdgeStyle style;
+            if (Parser::parsePaletteFile(palettePath, style.colors))
+                lineGraph.getSubgraph(graphSubgraph).setStyle(style);
+            else
+                std::cerr << "Could not read palette " << palettePath << std::endl;
+        }
+
+        /* Create route overlay on top of the graph */
+        std::unique_ptr<RouteOverlay> routeOverlay;
+        if (gff == GFF_GL && routing)
+        {
+            routeOverlay.reset(new RouteOverlay(graph, nodeIds, nodeGrid, hierarchy, lineGraph));
+            Controls::setActiveRouteOverlay(routeOverlay.get());
+            glfwSetMouseButtonCallback(window, Controls::mouseButtonFeedback);
+        }
+
+        /* Create isochrone, which recolours the edges of the graph */
+        std::unique_ptr<IsochroneOverlay> isochroneOverlay;
+        if (gff == GFF_GL && isochroneCutoff > 0.0f)
+        {
+            isochroneOverlay.reset(new IsochroneOverlay(graph, nodeIds, nodeGrid, lineGraph.getSubgraph(graphSubgraph), isochroneCutoff));
+            Controls::setActiveIsochroneOverlay(isochroneOverlay.get());
+        }
+
+        /* Highlight small connected components, which recolours the edges of the graph */
+        std::unique_ptr<ComponentOverlay> componentOverlay;
+        if (gff == GFF_GL && componentMinSize > 0)
+        {
+            componentOverlay.reset(new ComponentOverlay(components, lineGraph.getSubgraph(graphSubgraph), componentMinSize));
+            componentOverlay->setMode(ComponentOverlay::SMALL_COMPONENTS);
+            Controls::setActiveComponentOverlay(componentOverlay.get());
+        }
+
+        /* Filter the edges of the graph on the GPU */
+        if (gff == GFF_GL && !edgeFilters.empty())
+            Controls::setActiveEdgeFilters(&lineGraph, graphSubgraph, &edgeFilters);
+
+        /* Create density heatmap, which replaces the graph when zoomed out */
+        std::unique_ptr<DensityHeatmap> heatmap;
+        if (gff == GFF_GL && heatmapOrbit > 0.0f)
+        {
+            auto t_start = std::chrono::high_resolution_clock::now();
+            heatmap.reset(new DensityHeatmap);
+            heatmap->accumulate(lineGraph.getSubgraph(graphSubgraph));
+            glFinish();
+            auto t_end = std::chrono::high_resolution_clock::now();
+            std::cout << "Accumulated edge density in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << "ms" << std::endl;
+        }
 
         /* Create renderable simple graph (mesh) */
         TriangleGraph simpleColouredGraph;
         if (gff == GFF_SG)
         {
-            simpleColouredGraph.loadGraphData(nodes_rgb, edges_rgb, triangles_rgb);
+            simpleColouredGraph.loadGraphData(std::move(graph));
             Controls::setActiveTriangleGraph(&simpleColouredGraph);
             glfwSetMouseButtonCallback(window, Controls::mouseButtonFeedback);
         }
@@ -3551,6 +9896,7 @@ int main(const int argc, char *argv[])
 
         /* Create text labels */
         TextLabels labels;
+        Controls::setActiveTextLabels(&labels);
 
         /* Create icons */
         Icons icons;
@@ -3561,11 +9907,25 @@ int main(const int argc, char *argv[])
 
         if (angleLabels)
         {
+            std::vector<std::string> texts;
+            std::vector<float> latitudes;
+            std::vector<float> longitudes;
+
             for (int lon = -180; lon <= 180; lon++)
-                labels.addLabel(std::to_string(lon), 0.0, (float)lon, 0.25);
+            {
+                texts.push_back(std::to_string(lon));
+                latitudes.push_back(0.0f);
+                longitudes.push_back((float)lon);
+            }
 
             for (int lat = -90; lat <= 90; lat++)
-                labels.addLabel(std::to_string(lat), (float)lat, 0.0, 0.25);
+            {
+                texts.push_back(std::to_string(lat));
+                latitudes.push_back((float)lat);
+                longitudes.push_back(0.0f);
+            }
+
+            labels.addLabels(texts, latitudes, longitudes, std::vector<float>(texts.size(), 0.25f));
         }
         if (debugMode)
         {
@@ -3587,6 +9947,15 @@ int main(const int argc, char *argv[])
             icons.addIcon(Icons::THEATER, 48.0, 12.5, 0.25);
         }
 
+        /* Cluster icons for views from far away */
+        IconClusters iconClusters;
+        iconClusters.build(icons);
+
+        /* Index points of interest, only those in view are drawn */
+        std::unique_ptr<PoiLayer> poiLayer;
+        if (pois.size() > 0)
+            poiLayer.reset(new PoiLayer(pois));
+
         /* Create the debug sphere */
         DebugSphere db_sphere;
 
@@ -3603,6 +9972,7 @@ int main(const int argc, char *argv[])
         while (!glfwWindowShouldClose(window))
         {
             Controls::updateOrbitalCamera(window);
+            Controls::updateIsochrone(window);
 
             /* update near/far clipping plane based on camera orbit */
             camera.near = 0.0001f * pow(camera.orbit, 2.0f);
@@ -3630,12 +10000,13 @@ int main(const int argc, char *argv[])
             /* Draw edges (i.e. streets) */
             float scale = std::min((0.0025f / (camera.orbit - 1.0f)), 2.0f);
 
-            if (gff == GFF_GL)
+            if (gff == GFF_GL && heatmap && camera.orbit > heatmapOrbit)
+                heatmap->draw(camera);
+            else if (gff == GFF_GL)
                 lineGraph.draw(camera, scale);
             else if (gff == GFF_SG)
             {
                 simpleColouredGraph.draw(camera, trianlge_transparency);
-                simpleColouredGraph.pickingPass(camera);
             }
             else if (gff == GFF_RAW)
             {
@@ -3648,10 +10019,16 @@ int main(const int argc, char *argv[])
             glViewport(0, 0, width, height);
 
             /* Draw labels */
+            labels.declutter(camera, width, height);
             labels.draw(camera);
 
-            /* Draw icons */
-            icons.draw(camera);
+            /* Draw icons, or clusters of them when zoomed out */
+            if (!iconClusters.draw(camera, width, height))
+                icons.draw(camera);
+
+            /* Draw points of interest */
+            if (poiLayer)
+                poiLayer->draw(camera, width, height);
 
             // GeoBoundingBox bbox = camera.computeVisibleArea();
             // std::cout << std::fixed;
@@ -5,23 +5,25 @@
 uniform mat4 view_matrix;
 uniform mat4 projection_matrix;
 
-uniform vec2 label_geoCoords;
-uniform float label_scale;
-uniform float label_charCount;
+in vec2 v_corner;
 
-in vec2 v_position;
-in vec2 v_uv;
+// per glyph instance attributes
+in vec2 g_anchor;
+in vec2 g_offset;
+in vec2 g_atlasUV;
+in float g_scale;
 
 out vec2 uv;
+flat out vec2 atlasUV;
 
 void main()
 {	
 	// compute label position on unit sphere
-	float lat_sin = sin( (PI/180.0) * label_geoCoords.y);
-	float lon_sin = sin( (PI/180.0) * label_geoCoords.x);
+	float lat_sin = sin( (PI/180.0) * g_anchor.y);
+	float lon_sin = sin( (PI/180.0) * g_anchor.x);
 	
-	float lat_cos = cos( (PI/180.0) * label_geoCoords.y);
-	float lon_cos = cos( (PI/180.0) * label_geoCoords.x);
+	float lat_cos = cos( (PI/180.0) * g_anchor.y);
+	float lon_cos = cos( (PI/180.0) * g_anchor.x);
 	
 	float r = 1.0; //6378137.0;
 	
@@ -43,15 +45,19 @@ void main()
 	// transform vertex position in DCS to match character position
 	float ccs_scale = 0.25;
 	
+	// place the unit quad at the glyph's position within the label
+	vec2 v_position = vec2(g_offset.x + 0.06*v_corner.x, mix(-0.1,0.1,v_corner.y));
+	
 	vec4 ccs_position = view_matrix * vec4(world_position,1.0);
 	// build base quad for each character in NDCS and add horizontal offset of char position in string
-	ccs_position += vec4(v_position*label_scale*ccs_scale,0.0,0.0);
+	ccs_position += vec4(v_position*g_scale*ccs_scale,0.0,0.0);
 
-	ccs_position.xy -= max(-1.0,min(1.0,ccs_position.x)) * label_scale*ccs_scale*vec2(0.03*label_charCount,0.0);
+	ccs_position.xy -= max(-1.0,min(1.0,ccs_position.x)) * g_scale*ccs_scale*vec2(g_offset.y,0.0);
 	
 	vec4 dcs_position = projection_matrix * ccs_position;
 	
-	uv = v_uv;
+	uv = v_corner;
+	atlasUV = g_atlasUV;
 	
 	gl_Position = dcs_position;
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 130
+
+uniform sampler2D accumColour_tx2D;
+uniform sampler2D accumWeight_tx2D;
+uniform sampler2D opaque_tx2D;
+
+out vec4 fragColour;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    vec4 accum = texelFetch(accumColour_tx2D, texel, 0);
+    float revealage = accum.a;
+    float weight = texelFetch(accumWeight_tx2D, texel, 0).r;
+    vec4 opaque = texelFetch(opaque_tx2D, texel, 0);
+
+    vec3 transparent_colour = accum.rgb / max(weight, 1e-5);
+
+    // Opaque nodes and edges are put over the background first, then the transparent triangles
+    // on top of both. The destination (i.e. background) is scaled by alpha via the blend function.
+    fragColour = vec4(transparent_colour * (1.0 - revealage) + revealage * opaque.a * opaque.rgb,
+                      revealage * (1.0 - opaque.a));
+}
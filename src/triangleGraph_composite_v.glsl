@@ -0,0 +1,9 @@
+#version 130
+
+void main()
+{
+    // Fullscreen triangle generated from the vertex id, no vertex data required
+    vec2 position = vec2( float((gl_VertexID << 1) & 2), float(gl_VertexID & 2) );
+
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330
+
+uniform samplerBuffer colour_tx;
+uniform float transparency;
+uniform float depth_range;
+
+in float view_depth;
+
+layout(location = 0) out vec4 accumColour;
+layout(location = 1) out vec4 accumWeight;
+
+void main()
+{
+    vec4 colour = texelFetch(colour_tx, gl_PrimitiveID);
+    float alpha = colour[3]*transparency;
+
+    // Weighted blended order-independent transparency (McGuire & Bavoil 2013, eq. 9).
+    // View depth is rescaled to the depth range the weight function was tuned for.
+    float z = 500.0 * view_depth / depth_range;
+    float weight = alpha * clamp(0.03 / (1e-5 + pow(z/200.0, 4.0)), 1e-2, 3e3);
+
+    // rgb is summed up, alpha is multiplied into the revealage (see blend function setup)
+    accumColour = vec4(colour.rgb * alpha * weight, alpha);
+    accumWeight = vec4(alpha * weight);
+}
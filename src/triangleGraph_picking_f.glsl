@@ -1,10 +0,0 @@
-#version 130
-
-flat in int id;
-
-out int fragColour;
-
-void main()
-{
-    fragColour = id;
-}
\ No newline at end of file
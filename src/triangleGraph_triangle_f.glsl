@@ -1,12 +1,14 @@
-#version 130
+#version 330
 
+uniform samplerBuffer colour_tx;
 uniform float transparency;
 
-in vec4 colour;
-
 out vec4 fragColour;
 
 void main()
 {
+    // Triangles share their vertices, so the colour is looked up per triangle
+    vec4 colour = texelFetch(colour_tx, gl_PrimitiveID);
+
     fragColour = vec4(colour[0], colour[1], colour[2], colour[3]*transparency);
 }
\ No newline at end of file
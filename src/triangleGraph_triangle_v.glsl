@@ -1,4 +1,4 @@
-#version 130
+#version 330
 
 #define PI 3.141592653589793238462643383279502884197169399375105820
 
@@ -6,15 +6,11 @@ uniform mat4 view_matrix;
 uniform mat4 projection_matrix;
 
 in vec2 v_geoCoords;
-in int v_id;
-in vec4 v_colour;
 
-out vec4 colour;
+out float view_depth;
 
 void main()
 {
-    colour = v_colour;
-
     float lat_sin = sin( (PI/180.0) * v_geoCoords.y);
 	float lon_sin = sin( (PI/180.0) * v_geoCoords.x);
 	
@@ -27,5 +23,8 @@ void main()
 								lat_sin * r,
 								lat_cos * lon_cos * r );
 								
-	gl_Position = projection_matrix * view_matrix * vec4(world_position,1.0);
+	vec4 view_position = view_matrix * vec4(world_position,1.0);
+	view_depth = -view_position.z;
+
+	gl_Position = projection_matrix * view_position;
 }
\ No newline at end of file